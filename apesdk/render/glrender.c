@@ -47,11 +47,15 @@ typedef struct {
     n_vect2 end;
     GLR_COLOR color;
     n_byte thickness;
+    n_byte detail;
+    n_int stamp; // the group it is drawn with, -1 for none
 } glr_line;
 
 typedef struct {
     n_vect2 points[4];
     GLR_COLOR color;
+    n_byte detail;
+    n_int stamp;
 } glr_quad;
 
 typedef struct {
@@ -61,6 +65,107 @@ typedef struct {
 
 #define MULTIPLE_CHECK (1000)
 
+// The display list is bucketed by world-space cells so each frame only visits the cells in view
+#define GLR_CULL_CELL   (1024)
+#define GLR_CULL_MARGIN (4) // screen pixels, wide lines draw a pixel either side and the transform rounds
+
+// Below this scale the near detail of the display list gives way to the far detail. Each set of details
+// has its own cull so the frame doesn't visit what it leaves out.
+#define GLR_DETAIL_SCALE (32)
+#define GLR_CULL_NEAR    (0)
+#define GLR_CULL_FAR     (1)
+
+// Each primitive is in the cell of its lowest corner and reaches at most into the next cell. Larger
+// primitives are kept apart and always visited. Indices are ascending in each cell.
+typedef struct {
+    n_int low_x, low_y;
+    n_int cells_x, cells_y;
+    n_int *start;
+    n_int *items;
+    n_int *large;
+    n_int large_count;
+    n_byte skip; // the detail left out
+} glr_cull;
+
+typedef struct {
+    n_int *next;
+    n_int *end;
+} glr_cursor;
+
+// An optional cache of the display list drawn into world-space tiles at several levels, each level
+// halves the detail of the one before. Frames then only sample the tiles in view.
+#define GLR_TILE_SHIFT   (8)
+#define GLR_TILE_SIZE    (1 << GLR_TILE_SHIFT)
+#define GLR_TILE_LEVELS  (8)
+#define GLR_TILE_BLOCK   (32)
+#define GLR_TILE_BUCKETS (1024)
+#define GLR_TILE_BYTES   (GLR_TILE_SIZE * GLR_TILE_SIZE * 4)
+
+typedef struct {
+    n_int level;
+    n_int tile_x, tile_y;
+    n_uint used; // the frame the tile was last sampled in, zero for an empty slot
+    n_int next;  // the next slot in the bucket
+    n_byte *pixels;
+} glr_tile;
+
+// Large frames are split into bands of rows that are drawn on separate threads. Each band draws into
+// its own rows with a row either side, as lines color the rows next to them, then keeps its own rows.
+#define GLR_BAND_ROWS   (64)
+#define GLR_BAND_PIXELS (1920 * 1080) // smaller frames are drawn on the calling thread
+
+typedef struct {
+    n_vect2 points[4]; // in screen pixels
+    n_int low_y, high_y; // the rows it can color
+    n_byte quad;         // a filled quad with its outline, otherwise a line
+    n_byte thickness;
+    n_byte color;
+    n_int stamp;         // the group whose runs are copied to the first point, -1 for a line or quad
+} glr_band_item;
+
+typedef struct {
+    n_byte *output;
+    n_byte *scratch;
+    n_int top, bottom;     // the rows of the output the band keeps
+    n_int origin, height;  // the rows of the output in the scratch
+    n_int first, count;    // the band's items in band_order
+} glr_band;
+
+// A group of display lines and quads, such as a tree, is drawn together the first time the frame visits
+// one of its quads. Once the group is drawn twice at the same scale and turn its pixels are kept as runs,
+// and later frames copy the runs to wherever the group's first corner lands. The corners round apart,
+// so a kept group can sit a pixel away from where drawing it would have put it.
+#define GLR_STAMP_MARGIN (2)   // thick lines color a pixel either side
+#define GLR_STAMP_SIZE   (256) // larger groups are always drawn
+#define GLR_STAMP_BYTES  (16 * 1024 * 1024)
+
+typedef struct {
+    n_int first_line, end_line;  // the group's lines and quads in the display list
+    n_int first_quad, end_quad;
+    n_uint drawn;                // the frame the group was last drawn in
+    n_int seen_scale, seen_turn; // the view the group was last drawn at
+    n_int scale, turn, bytes;    // the view the runs are from, no runs while bytes is zero
+    n_vect2 offset;              // the runs from the screen location of the first corner
+    n_vect2 size;
+    n_int run_count;
+    n_int *runs;                 // the row, first column and length of each run
+    n_byte *pixels;              // the pixels of the runs one after another
+    n_uint kept_bytes;
+} glr_stamp;
+
+// The display list's corners, each point kept once however many lines and quads share it. The screen
+// locations are worked out the first time a frame needs them.
+typedef struct {
+    n_int count;
+    n_int *x, *y;               // in the world
+    n_int *screen_x, *screen_y;
+    n_uint *frame;              // the frame the screen location is from
+    n_int *lines;               // two corners a display line
+    n_int *quads;               // four corners a display quad
+} glr_vertices;
+
+typedef void (glr_render_item)(n_byte *output, memory_list *list, n_int index, n_vect2 *direction_vector);
+
 typedef enum {
     GRAPHICS_CASE_ACTIVE = 0,
     GRAPHICS_CASE_DISPLAY = 1,
@@ -75,7 +180,48 @@ static memory_list *display_lines = NULL;
 static memory_list *active_lines = NULL;
 static memory_list *text_lines = NULL;
 
+static glr_cull display_lines_cull[2] = {{0}};
+static glr_cull display_quads_cull[2] = {{0}};
+static n_byte display_cull_dirty = 1;
+static glr_cursor *cull_cursors = NULL;
+static n_int cull_cursors_max = 0;
+
+static glr_vertices display_vertices = {0};
+static n_uint vertex_frame = 0;
+
+static memory_list *band_items = NULL;
+static n_int *band_order = NULL;
+static n_int band_order_max = 0;
+static glr_band *bands = NULL;
+static n_int bands_max = 0;
+static n_byte *band_scratch = NULL;
+static n_uint band_scratch_bytes = 0;
+
+static memory_list *display_stamps = NULL;
+static n_int current_stamp = -1; // the group being added to the display list
+static n_byte *stamp_scratch = NULL;
+static n_uint stamp_bytes = 0;   // kept across the groups
+
+static glr_tile *tiles = NULL;
+static n_int tiles_max = 0;
+static n_int tile_buckets[GLR_TILE_BUCKETS];
+static n_uint tile_frame = 0;
+static n_int tile_target_level = -1; // drawing into a tile at this level rather than to the screen
+static n_vect2 tile_target_origin = {0};
+
+static n_byte *frame_static = NULL;      // the last frame before the active lines were drawn
+static n_uint frame_static_bytes = 0;
+static n_byte *frame_output = NULL;      // where the last frame went
+static memory_list *frame_active = NULL; // the active lines in the last frame
+static n_vect2 frame_size = {0};
+static n_vect2 frame_center = {0};
+static n_vect2 frame_location = {0};
+static n_int frame_turn = 0;
+static n_int frame_scale = 0;
+static n_byte frame_dirty = 1;
+
 static GLR_COLOR current_color = GLR_GREEN;
+static GLR_DETAIL current_detail = GLR_DETAIL_ALL;
 static n_byte current_thickness = 1;
 
 static n_vect2 current_center = {0};
@@ -149,6 +295,7 @@ void glrender_color_map_replace(n_byte4 *replace) {
     for (n_int loop = 0; loop < 8; loop++) {
         color_map[loop].thirtytwo = replace[loop];
     }
+    frame_dirty = 1;
 }
 
 static n_byte4 glrender_color_switch(n_int value) {
@@ -171,65 +318,1187 @@ void glrender_color_map(n_byte2 *value) {
 }
 
 n_int glrender_scene_done(void) {
-    return (draw_scene_not_done < 2);
+    return (draw_scene_not_done < 1);
 }
 
 void glrender_color(const GLR_COLOR color) {
     current_color = color;
 }
 
+// The lines and quads that follow in the display list are only drawn near or far, or always
+void glrender_detail(const GLR_DETAIL detail) {
+    current_detail = detail;
+}
+
 void glrender_translate(n_vect2 *input, n_vect2 *output, n_vect2 *direction_vector) {
-    vect2_subtract(output, input, &current_location);
-    vect2_add(output, output, &current_center);
-    vect2_scalar_multiply(output, current_scale);
-    vect2_scalar_bitshiftdown(output, 7);
-    vect2_rotation_bitshift(output, direction_vector);
-    vect2_subtract(output, output, &current_center);
+    if (tile_target_level != -1) {
+        output->x = (input->x - tile_target_origin.x) >> tile_target_level;
+        output->y = (input->y - tile_target_origin.y) >> tile_target_level;
+        return;
+    }
+    {
+        n_int px = ((input->x - current_location.x + current_center.x) * current_scale) >> 7;
+        n_int py = ((input->y - current_location.y + current_center.y) * current_scale) >> 7;
+        output->x = (((px * direction_vector->x) + (py * direction_vector->y)) >> 15) - current_center.x;
+        output->y = (((px * direction_vector->y) - (py * direction_vector->x)) >> 15) - current_center.y;
+    }
 }
 
 void glrender_render_erase(n_byte *output) {
     graph_erase(output, &graph_size, (n_rgba32 *)&color_map[GLR_GREEN]);
 }
 
-void glrender_render_quads(n_byte *output, memory_list *quads) {
-    n_vect2 direction_vector;
-    vect2_direction(&direction_vector, 255 - current_turn, 1);
-    glr_quad *display_quad_list = (glr_quad *)quads->data;
+static void glrender_draw_quad(n_byte *output, n_vect2 *corners, GLR_COLOR color) {
+    n_rgba32 *local_color = (n_rgba32 *)&color_map[color];
 
-    for (n_int loop = 0; loop < quads->count; loop++) {
-        glr_quad *quad_from_array = &display_quad_list[loop];
-        n_vect2 local_coordinate_quad[4];
-        n_rgba32 *local_color = (n_rgba32 *)&color_map[quad_from_array->color];
+    graph_fill_polygon(corners, 4, local_color, 0, output, &graph_size);
+
+    for (n_int i = 0; i < 4; i++) {
+        graph_line(output, &graph_size, &corners[i], &corners[(i + 1) % 4], local_color, 3);
+    }
+}
+
+static void glrender_draw_line(n_byte *output, n_vect2 *start, n_vect2 *end, GLR_COLOR color, n_byte thickness) {
+    if ((start->x < 0 && end->x < 0) || (start->y < 0 && end->y < 0) ||
+        (start->x > (graph_size.x - 1) && end->x > (graph_size.x - 1)) ||
+        (start->y > (graph_size.y - 1) && end->y > (graph_size.y - 1))) {
+        return;
+    }
+
+    graph_line(output, &graph_size, start, end, (n_rgba32 *)&color_map[color], thickness);
+}
+
+static void glrender_render_quad(n_byte *output, memory_list *quads, n_int index, n_vect2 *direction_vector) {
+    glr_quad *quad_from_array = &((glr_quad *)quads->data)[index];
+    n_vect2 local_coordinate_quad[4];
+
+    for (n_int i = 0; i < 4; i++) {
+        glrender_translate(&quad_from_array->points[i], &local_coordinate_quad[i], direction_vector);
+    }
+    glrender_draw_quad(output, local_coordinate_quad, quad_from_array->color);
+}
+
+static void glrender_render_line(n_byte *output, memory_list *lines, n_int index, n_vect2 *direction_vector) {
+    glr_line *line = &((glr_line *)lines->data)[index];
+    n_vect2 reset_start, reset_end;
+    glrender_translate(&line->start, &reset_start, direction_vector);
+    glrender_translate(&line->end, &reset_end, direction_vector);
+    glrender_draw_line(output, &reset_start, &reset_end, line->color, line->thickness);
+}
+
+static void glrender_vertices_free(void) {
+    memory_free((void **)&display_vertices.x);
+    memory_free((void **)&display_vertices.y);
+    memory_free((void **)&display_vertices.screen_x);
+    memory_free((void **)&display_vertices.screen_y);
+    memory_free((void **)&display_vertices.frame);
+    memory_free((void **)&display_vertices.lines);
+    memory_free((void **)&display_vertices.quads);
+    display_vertices.count = 0;
+}
 
+static n_int glrender_vertex_add(n_int *slots, n_int mask, n_vect2 *point) {
+    n_uint hash = ((n_uint)point->x * 73856093) ^ ((n_uint)point->y * 19349663);
+    n_int slot = (n_int)(hash & (n_uint)mask);
+    while (slots[slot] != -1) {
+        n_int vertex = slots[slot];
+        if ((display_vertices.x[vertex] == point->x) && (display_vertices.y[vertex] == point->y)) {
+            return vertex;
+        }
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = display_vertices.count;
+    display_vertices.x[display_vertices.count] = point->x;
+    display_vertices.y[display_vertices.count] = point->y;
+    return display_vertices.count++;
+}
+
+// Gathers the corners of the display lines and quads, the same point is the same corner
+static n_int glrender_vertices_build(void) {
+    n_int line_count = (n_int)display_lines->count;
+    n_int quad_count = (n_int)display_quads->count;
+    n_int most = (line_count * 2) + (quad_count * 4);
+    n_int size = 256, loop;
+    n_int *slots;
+
+    glrender_vertices_free();
+    while (size < (most * 2)) {
+        size *= 2;
+    }
+    slots = memory_new(sizeof(n_int) * (n_uint)size);
+    display_vertices.x = memory_new(sizeof(n_int) * (n_uint)(most + 1));
+    display_vertices.y = memory_new(sizeof(n_int) * (n_uint)(most + 1));
+    display_vertices.lines = memory_new(sizeof(n_int) * (n_uint)((line_count * 2) + 1));
+    display_vertices.quads = memory_new(sizeof(n_int) * (n_uint)((quad_count * 4) + 1));
+    if ((slots == 0L) || (display_vertices.x == 0L) || (display_vertices.y == 0L) ||
+        (display_vertices.lines == 0L) || (display_vertices.quads == 0L)) {
+        memory_free((void **)&slots);
+        glrender_vertices_free();
+        return SHOW_ERROR("Display vertices not allocated");
+    }
+    for (loop = 0; loop < size; loop++) {
+        slots[loop] = -1;
+    }
+    for (loop = 0; loop < line_count; loop++) {
+        glr_line *line = &((glr_line *)display_lines->data)[loop];
+        display_vertices.lines[(loop * 2)] = glrender_vertex_add(slots, size - 1, &line->start);
+        display_vertices.lines[(loop * 2) + 1] = glrender_vertex_add(slots, size - 1, &line->end);
+    }
+    for (loop = 0; loop < quad_count; loop++) {
+        glr_quad *quad = &((glr_quad *)display_quads->data)[loop];
         for (n_int i = 0; i < 4; i++) {
-            glrender_translate(&quad_from_array->points[i], &local_coordinate_quad[i], &direction_vector);
+            display_vertices.quads[(loop * 4) + i] = glrender_vertex_add(slots, size - 1, &quad->points[i]);
         }
+    }
+    memory_free((void **)&slots);
+
+    display_vertices.screen_x = memory_new(sizeof(n_int) * (n_uint)(display_vertices.count + 1));
+    display_vertices.screen_y = memory_new(sizeof(n_int) * (n_uint)(display_vertices.count + 1));
+    display_vertices.frame = memory_new(sizeof(n_uint) * (n_uint)(display_vertices.count + 1));
+    if ((display_vertices.screen_x == 0L) || (display_vertices.screen_y == 0L) || (display_vertices.frame == 0L)) {
+        glrender_vertices_free();
+        return SHOW_ERROR("Display vertices not allocated");
+    }
+    memory_erase((n_byte *)display_vertices.frame, sizeof(n_uint) * (n_uint)(display_vertices.count + 1));
+    vertex_frame = 0;
+    return 0;
+}
 
-        graph_fill_polygon((n_vect2 *)&local_coordinate_quad, 4, local_color, 0, output, &graph_size);
+// The screen locations of a display line's or quad's corners, each corner is translated once a frame
+static void glrender_display_corners(memory_list *list, n_int index, n_int number, n_vect2 *direction_vector,
+                                     n_vect2 *corners) {
+    n_int *vertices;
+    if (display_vertices.count == 0) {
+        n_vect2 *points = (n_vect2 *)&list->data[(n_uint)index * list->unit_size];
+        for (n_int i = 0; i < number; i++) {
+            glrender_translate(&points[i], &corners[i], direction_vector);
+        }
+        return;
+    }
+    vertices = (list == display_lines) ? &display_vertices.lines[index * 2] : &display_vertices.quads[index * 4];
+    for (n_int i = 0; i < number; i++) {
+        n_int vertex = vertices[i];
+        if (display_vertices.frame[vertex] != vertex_frame) {
+            n_vect2 point;
+            point.x = display_vertices.x[vertex];
+            point.y = display_vertices.y[vertex];
+            glrender_translate(&point, &corners[i], direction_vector);
+            display_vertices.screen_x[vertex] = corners[i].x;
+            display_vertices.screen_y[vertex] = corners[i].y;
+            display_vertices.frame[vertex] = vertex_frame;
+        } else {
+            corners[i].x = display_vertices.screen_x[vertex];
+            corners[i].y = display_vertices.screen_y[vertex];
+        }
+    }
+}
 
-        for (n_int i = 0; i < 4; i++) {
-            graph_line(output, &graph_size, &local_coordinate_quad[i], &local_coordinate_quad[(i + 1) % 4], local_color, 3);
+static void glrender_stamp_free(glr_stamp *stamp) {
+    memory_free((void **)&stamp->runs);
+    memory_free((void **)&stamp->pixels);
+    stamp_bytes -= stamp->kept_bytes;
+    stamp->kept_bytes = 0;
+    stamp->run_count = 0;
+    stamp->bytes = 0;
+}
+
+static void glrender_stamps_free(void) {
+    if (display_stamps == NULL) {
+        return;
+    }
+    for (n_int loop = 0; loop < (n_int)display_stamps->count; loop++) {
+        glrender_stamp_free(&((glr_stamp *)display_stamps->data)[loop]);
+    }
+}
+
+// Draws the group's lines and then its quads, the corners less the origin
+static void glrender_stamp_items(n_byte *output, glr_stamp *stamp, n_vect2 *direction_vector, n_vect2 *origin) {
+    n_vect2 corners[4];
+    n_int loop, i;
+    for (loop = stamp->first_line; loop < stamp->end_line; loop++) {
+        glr_line *line = &((glr_line *)display_lines->data)[loop];
+        glrender_display_corners(display_lines, loop, 2, direction_vector, corners);
+        for (i = 0; i < 2; i++) {
+            vect2_subtract(&corners[i], &corners[i], origin);
+        }
+        glrender_draw_line(output, &corners[0], &corners[1], line->color, line->thickness);
+    }
+    for (loop = stamp->first_quad; loop < stamp->end_quad; loop++) {
+        glrender_display_corners(display_quads, loop, 4, direction_vector, corners);
+        for (i = 0; i < 4; i++) {
+            vect2_subtract(&corners[i], &corners[i], origin);
+        }
+        glrender_draw_quad(output, corners, ((glr_quad *)display_quads->data)[loop].color);
+    }
+}
+
+static void glrender_stamp_bounds(glr_stamp *stamp, n_vect2 *direction_vector, n_vect2 *low, n_vect2 *high) {
+    n_vect2 corners[4];
+    n_int loop, i;
+    glrender_display_corners(display_quads, stamp->first_quad, 1, direction_vector, low);
+    *high = *low;
+    for (loop = stamp->first_line; loop < stamp->end_line; loop++) {
+        glrender_display_corners(display_lines, loop, 2, direction_vector, corners);
+        for (i = 0; i < 2; i++) {
+            if (corners[i].x < low->x) low->x = corners[i].x;
+            if (corners[i].y < low->y) low->y = corners[i].y;
+            if (corners[i].x > high->x) high->x = corners[i].x;
+            if (corners[i].y > high->y) high->y = corners[i].y;
+        }
+    }
+    for (loop = stamp->first_quad; loop < stamp->end_quad; loop++) {
+        glrender_display_corners(display_quads, loop, 4, direction_vector, corners);
+        for (i = 0; i < 4; i++) {
+            if (corners[i].x < low->x) low->x = corners[i].x;
+            if (corners[i].y < low->y) low->y = corners[i].y;
+            if (corners[i].x > high->x) high->x = corners[i].x;
+            if (corners[i].y > high->y) high->y = corners[i].y;
+        }
+    }
+}
+
+static n_byte glrender_stamp_pixel(n_byte *first, n_byte *second, n_int bytes) {
+    if (bytes == 4) {
+        return *(n_byte4 *)first == *(n_byte4 *)second;
+    }
+    for (n_int loop = 0; loop < bytes; loop++) {
+        if (first[loop] != second[loop]) {
+            return 0;
         }
     }
+    return 1;
+}
+
+// Keeps the runs of the group's pixels, the group is drawn over two backgrounds and the pixels that
+// match are the group's. Returns -1 when the group is too large or the budget is used.
+static n_int glrender_stamp_build(glr_stamp *stamp, n_vect2 *direction_vector, n_vect2 *anchor) {
+    n_int bytes = graph_bytes_per_unit();
+    n_vect2 low, high, size, saved_size = graph_size;
+    n_rgba32 clear;
+    n_byte *first, *second;
+    n_int row, column, run_count = 0, *runs;
+    n_uint pixel_bytes = 0, kept_bytes;
+    n_byte *pixels;
+
+    glrender_stamp_bounds(stamp, direction_vector, &low, &high);
+    low.x -= GLR_STAMP_MARGIN;
+    low.y -= GLR_STAMP_MARGIN;
+    size.x = (high.x + GLR_STAMP_MARGIN + 1) - low.x;
+    size.y = (high.y + GLR_STAMP_MARGIN + 1) - low.y;
+    if ((size.x > GLR_STAMP_SIZE) || (size.y > GLR_STAMP_SIZE)) {
+        return -1;
+    }
+    if (stamp_scratch == NULL) {
+        stamp_scratch = memory_new(GLR_STAMP_SIZE * GLR_STAMP_SIZE * 4 * 2);
+        if (stamp_scratch == NULL) {
+            return -1;
+        }
+    }
+    first = stamp_scratch;
+    second = &stamp_scratch[size.x * size.y * bytes];
+
+    graph_size = size;
+    clear.thirtytwo = 0;
+    graph_erase(first, &graph_size, &clear);
+    glrender_stamp_items(first, stamp, direction_vector, &low);
+    clear.thirtytwo = 0xffffffff;
+    graph_erase(second, &graph_size, &clear);
+    glrender_stamp_items(second, stamp, direction_vector, &low);
+    graph_size = saved_size;
+
+    for (row = 0; row < size.y; row++) {
+        n_int offset = row * size.x * bytes;
+        column = 0;
+        while (column < size.x) {
+            if (glrender_stamp_pixel(&first[offset + (column * bytes)], &second[offset + (column * bytes)], bytes)) {
+                n_int start = column;
+                while ((column < size.x) &&
+                       glrender_stamp_pixel(&first[offset + (column * bytes)], &second[offset + (column * bytes)], bytes)) {
+                    column++;
+                }
+                run_count++;
+                pixel_bytes += (n_uint)((column - start) * bytes);
+            } else {
+                column++;
+            }
+        }
+    }
+
+    kept_bytes = pixel_bytes + (sizeof(n_int) * 3 * (n_uint)run_count);
+    if ((stamp_bytes + kept_bytes) > GLR_STAMP_BYTES) {
+        // the groups the frame hasn't drawn make way
+        for (n_int loop = 0; loop < (n_int)display_stamps->count; loop++) {
+            glr_stamp *other = &((glr_stamp *)display_stamps->data)[loop];
+            if (other->drawn != vertex_frame) {
+                glrender_stamp_free(other);
+            }
+        }
+        if ((stamp_bytes + kept_bytes) > GLR_STAMP_BYTES) {
+            return -1;
+        }
+    }
+    stamp->runs = memory_new(sizeof(n_int) * 3 * (n_uint)(run_count + 1));
+    stamp->pixels = memory_new(pixel_bytes + 1);
+    if ((stamp->runs == NULL) || (stamp->pixels == NULL)) {
+        memory_free((void **)&stamp->runs);
+        memory_free((void **)&stamp->pixels);
+        return -1;
+    }
+
+    runs = stamp->runs;
+    pixels = stamp->pixels;
+    for (row = 0; row < size.y; row++) {
+        n_int offset = row * size.x * bytes;
+        column = 0;
+        while (column < size.x) {
+            if (glrender_stamp_pixel(&first[offset + (column * bytes)], &second[offset + (column * bytes)], bytes)) {
+                n_int start = column;
+                while ((column < size.x) &&
+                       glrender_stamp_pixel(&first[offset + (column * bytes)], &second[offset + (column * bytes)], bytes)) {
+                    column++;
+                }
+                runs[0] = row;
+                runs[1] = start;
+                runs[2] = column - start;
+                memory_copy(&first[offset + (start * bytes)], pixels, (n_uint)(runs[2] * bytes));
+                pixels += runs[2] * bytes;
+                runs += 3;
+            } else {
+                column++;
+            }
+        }
+    }
+    stamp->run_count = run_count;
+    stamp->kept_bytes = kept_bytes;
+    stamp->scale = current_scale;
+    stamp->turn = current_turn;
+    stamp->bytes = bytes;
+    stamp->size = size;
+    vect2_subtract(&stamp->offset, &low, anchor);
+    stamp_bytes += kept_bytes;
+    return 0;
+}
+
+static void glrender_stamp_copy(n_byte *output, n_vect2 *size, glr_stamp *stamp, n_vect2 *anchor) {
+    n_int bytes = stamp->bytes;
+    n_int *runs = stamp->runs;
+    n_byte *pixels = stamp->pixels;
+    for (n_int loop = 0; loop < stamp->run_count; loop++) {
+        n_int y = anchor->y + stamp->offset.y + runs[0];
+        n_int x = anchor->x + stamp->offset.x + runs[1];
+        n_int length = runs[2];
+        n_byte *from = pixels;
+        pixels += length * bytes;
+        runs += 3;
+        if ((y < 0) || (y >= size->y)) {
+            continue;
+        }
+        if (x < 0) {
+            from -= x * bytes;
+            length += x;
+            x = 0;
+        }
+        if ((x + length) > size->x) {
+            length = size->x - x;
+        }
+        if (length > 0) {
+            memory_copy(from, &output[((y * size->x) + x) * bytes], (n_uint)(length * bytes));
+        }
+    }
+}
+
+// Whether the group's runs fit the view, the runs are kept when the group is drawn a second time at the
+// same scale and turn. The anchor is the screen location of the group's first corner.
+static n_byte glrender_stamp_ready(glr_stamp *stamp, n_vect2 *direction_vector, n_vect2 *anchor) {
+    glrender_display_corners(display_quads, stamp->first_quad, 1, direction_vector, anchor);
+    if ((stamp->bytes == graph_bytes_per_unit()) && (stamp->scale == current_scale) && (stamp->turn == current_turn)) {
+        return 1;
+    }
+    glrender_stamp_free(stamp);
+    if ((stamp->seen_scale == current_scale) && (stamp->seen_turn == current_turn) &&
+        (glrender_stamp_build(stamp, direction_vector, anchor) == 0)) {
+        return 1;
+    }
+    stamp->seen_scale = current_scale;
+    stamp->seen_turn = current_turn;
+    return 0;
+}
+
+// Draws the group the first time in the frame one of its quads is visited
+static void glrender_stamp_draw(n_byte *output, n_int index, n_vect2 *direction_vector) {
+    glr_stamp *stamp = &((glr_stamp *)display_stamps->data)[index];
+    n_vect2 anchor, origin = {0};
+
+    if (stamp->drawn == vertex_frame) {
+        return;
+    }
+    stamp->drawn = vertex_frame;
+    if (glrender_stamp_ready(stamp, direction_vector, &anchor)) {
+        glrender_stamp_copy(output, &graph_size, stamp, &anchor);
+    } else {
+        glrender_stamp_items(output, stamp, direction_vector, &origin);
+    }
+}
+
+static void glrender_render_display_quad(n_byte *output, memory_list *quads, n_int index, n_vect2 *direction_vector) {
+    n_vect2 corners[4];
+    if (((glr_quad *)quads->data)[index].stamp != -1) {
+        glrender_stamp_draw(output, ((glr_quad *)quads->data)[index].stamp, direction_vector);
+        return;
+    }
+    glrender_display_corners(quads, index, 4, direction_vector, corners);
+    glrender_draw_quad(output, corners, ((glr_quad *)quads->data)[index].color);
+}
+
+static void glrender_render_display_line(n_byte *output, memory_list *lines, n_int index, n_vect2 *direction_vector) {
+    glr_line *line = &((glr_line *)lines->data)[index];
+    n_vect2 corners[2];
+    if (line->stamp != -1) {
+        return; // drawn with its group's quads
+    }
+    glrender_display_corners(lines, index, 2, direction_vector, corners);
+    glrender_draw_line(output, &corners[0], &corners[1], line->color, line->thickness);
+}
+
+void glrender_render_quads(n_byte *output, memory_list *quads) {
+    n_vect2 direction_vector;
+    vect2_direction(&direction_vector, 255 - current_turn, 1);
+
+    for (n_int loop = 0; loop < quads->count; loop++) {
+        glrender_render_quad(output, quads, loop, &direction_vector);
+    }
 }
 
 void glrender_render_lines(n_byte *output, memory_list *lines) {
     n_vect2 direction_vector;
     vect2_direction(&direction_vector, 255 - current_turn, 1);
-    glr_line *active_list = (glr_line *)lines->data;
 
     for (n_int loop = 0; loop < lines->count; loop++) {
-        n_vect2 reset_start, reset_end;
-        glrender_translate(&active_list[loop].start, &reset_start, &direction_vector);
-        glrender_translate(&active_list[loop].end, &reset_end, &direction_vector);
+        glrender_render_line(output, lines, loop, &direction_vector);
+    }
+}
+
+static n_int glrender_cull_cell(n_int value) {
+    if (value < 0) {
+        return ((value + 1) / GLR_CULL_CELL) - 1;
+    }
+    return value / GLR_CULL_CELL;
+}
+
+static void glrender_cull_free(glr_cull *cull) {
+    memory_free((void **)&cull->start);
+    memory_free((void **)&cull->items);
+    memory_free((void **)&cull->large);
+    cull->cells_x = 0;
+    cull->cells_y = 0;
+    cull->large_count = 0;
+}
+
+// The world-space bounds of a primitive, lines and quads both start with their points
+static void glrender_cull_bounds(memory_list *list, n_int index, n_int number, n_vect2 *low, n_vect2 *high) {
+    n_vect2 *points = (n_vect2 *)&list->data[(n_uint)index * list->unit_size];
+    *low = points[0];
+    *high = points[0];
+    for (n_int loop = 1; loop < number; loop++) {
+        if (points[loop].x < low->x) low->x = points[loop].x;
+        if (points[loop].y < low->y) low->y = points[loop].y;
+        if (points[loop].x > high->x) high->x = points[loop].x;
+        if (points[loop].y > high->y) high->y = points[loop].y;
+    }
+}
+
+// The set of details drawn at the scale
+static n_int glrender_detail_set(n_int scale) {
+    return (scale < GLR_DETAIL_SCALE) ? GLR_CULL_FAR : GLR_CULL_NEAR;
+}
+
+static n_byte glrender_item_detail(memory_list *list, n_int index) {
+    if (list == display_lines) {
+        return ((glr_line *)list->data)[index].detail;
+    }
+    return ((glr_quad *)list->data)[index].detail;
+}
+
+// Buckets the primitives by cell with a counting sort, so each cell keeps the list order. The
+// primitives with the skipped detail are left out.
+static n_int glrender_cull_build(glr_cull *cull, memory_list *list, n_int number, n_byte skip) {
+    n_int count = (n_int)list->count;
+    n_int high_x = 0, high_y = 0, cells, loop;
+    n_byte found = 0;
+    n_int *cell_of;
+
+    glrender_cull_free(cull);
+    cull->skip = skip;
+    if (count == 0) {
+        return 0;
+    }
+    cell_of = memory_new(sizeof(n_int) * (n_uint)count);
+    cull->large = memory_new(sizeof(n_int) * (n_uint)count);
+    if ((cell_of == 0L) || (cull->large == 0L)) {
+        memory_free((void **)&cell_of);
+        glrender_cull_free(cull);
+        return SHOW_ERROR("Display cull not allocated");
+    }
 
-        if ((reset_start.x < 0 && reset_end.x < 0) || (reset_start.y < 0 && reset_end.y < 0) ||
-            (reset_start.x > (graph_size.x - 1) && reset_end.x > (graph_size.x - 1)) ||
-            (reset_start.y > (graph_size.y - 1) && reset_end.y > (graph_size.y - 1))) {
+    cull->low_x = 0;
+    cull->low_y = 0;
+    for (loop = 0; loop < count; loop++) {
+        n_vect2 low, high;
+        if (glrender_item_detail(list, loop) == skip) {
+            cell_of[loop] = -2;
             continue;
         }
+        glrender_cull_bounds(list, loop, number, &low, &high);
+        if (((high.x - low.x) > GLR_CULL_CELL) || ((high.y - low.y) > GLR_CULL_CELL)) {
+            cull->large[cull->large_count++] = loop;
+            cell_of[loop] = -1;
+            continue;
+        }
+        low.x = glrender_cull_cell(low.x);
+        low.y = glrender_cull_cell(low.y);
+        if ((found == 0) || (low.x < cull->low_x)) cull->low_x = low.x;
+        if ((found == 0) || (low.y < cull->low_y)) cull->low_y = low.y;
+        if ((found == 0) || (low.x > high_x)) high_x = low.x;
+        if ((found == 0) || (low.y > high_y)) high_y = low.y;
+        cell_of[loop] = 0;
+        found = 1;
+    }
+
+    if (found) {
+        cull->cells_x = (high_x - cull->low_x) + 1;
+        cull->cells_y = (high_y - cull->low_y) + 1;
+    }
+    cells = cull->cells_x * cull->cells_y;
+    cull->start = memory_new(sizeof(n_int) * (n_uint)(cells + 1));
+    cull->items = memory_new(sizeof(n_int) * (n_uint)(count - cull->large_count + 1));
+    if ((cull->start == 0L) || (cull->items == 0L)) {
+        memory_free((void **)&cell_of);
+        glrender_cull_free(cull);
+        return SHOW_ERROR("Display cull not allocated");
+    }
+    memory_erase((n_byte *)cull->start, sizeof(n_int) * (n_uint)(cells + 1));
+
+    for (loop = 0; loop < count; loop++) {
+        if (cell_of[loop] >= 0) {
+            n_vect2 low, high;
+            glrender_cull_bounds(list, loop, number, &low, &high);
+            cell_of[loop] = ((glrender_cull_cell(low.y) - cull->low_y) * cull->cells_x) + (glrender_cull_cell(low.x) - cull->low_x);
+            cull->start[cell_of[loop] + 1]++;
+        }
+    }
+    for (loop = 0; loop < cells; loop++) {
+        cull->start[loop + 1] += cull->start[loop];
+    }
+    for (loop = 0; loop < count; loop++) {
+        if (cell_of[loop] >= 0) {
+            cull->items[cull->start[cell_of[loop]]++] = loop;
+        }
+    }
+    // the starts were moved on to the ends while filling
+    for (loop = cells; loop > 0; loop--) {
+        cull->start[loop] = cull->start[loop - 1];
+    }
+    cull->start[0] = 0;
+    memory_free((void **)&cell_of);
+    return 0;
+}
 
-        graph_line(output, &graph_size, &reset_start, &reset_end, (n_rgba32 *)&color_map[active_list[loop].color], active_list[loop].thickness);
+// Takes a screen location back through the translation to the world. Returns 0 when the translation
+// can't be undone.
+static n_byte glrender_screen_world(n_vect2 *direction_vector, n_double sx, n_double sy, n_double *wx, n_double *wy) {
+    n_double length = (n_double)((direction_vector->x * direction_vector->x) + (direction_vector->y * direction_vector->y));
+    n_double px = sx + current_center.x;
+    n_double py = sy + current_center.y;
+    n_double qx, qy;
+
+    if ((length == 0) || (current_scale < 1)) {
+        return 0;
+    }
+    // the rotation is its own inverse apart from the length of the direction
+    qx = ((direction_vector->x * px) + (direction_vector->y * py)) * 32768.0 / length;
+    qy = ((direction_vector->y * px) - (direction_vector->x * py)) * 32768.0 / length;
+    *wx = ((qx * 128.0) / (n_double)current_scale) + current_location.x - current_center.x;
+    *wy = ((qy * 128.0) / (n_double)current_scale) + current_location.y - current_center.y;
+    return 1;
+}
+
+// The world-space box around the screen, found by taking the screen corners back through the
+// translation. Returns 0 when the translation can't be undone.
+static n_byte glrender_cull_view(n_vect2 *direction_vector, n_vect2 *low, n_vect2 *high) {
+    n_int loop = 0;
+
+    while (loop < 4) {
+        n_double world_x, world_y;
+        n_int wx, wy;
+        if (glrender_screen_world(direction_vector,
+                                  (loop & 1) ? (graph_size.x + GLR_CULL_MARGIN) : (0 - GLR_CULL_MARGIN),
+                                  (loop & 2) ? (graph_size.y + GLR_CULL_MARGIN) : (0 - GLR_CULL_MARGIN),
+                                  &world_x, &world_y) == 0) {
+            return 0;
+        }
+        wx = (n_int)world_x;
+        wy = (n_int)world_y;
+        if ((loop == 0) || (wx < low->x)) low->x = wx;
+        if ((loop == 0) || (wy < low->y)) low->y = wy;
+        if ((loop == 0) || (wx > high->x)) high->x = wx;
+        if ((loop == 0) || (wy > high->y)) high->y = wy;
+        loop++;
+    }
+    // a pixel of the scale in world units either side covers the rounding
+    low->x -= (256 / current_scale) + 2;
+    low->y -= (256 / current_scale) + 2;
+    high->x += (256 / current_scale) + 2;
+    high->y += (256 / current_scale) + 2;
+    return 1;
+}
+
+static void glrender_cursor_down(glr_cursor *heap, n_int count, n_int location) {
+    while (1) {
+        n_int smallest = location;
+        n_int left = (location * 2) + 1;
+        n_int right = left + 1;
+        if ((left < count) && (*heap[left].next < *heap[smallest].next)) smallest = left;
+        if ((right < count) && (*heap[right].next < *heap[smallest].next)) smallest = right;
+        if (smallest == location) {
+            return;
+        }
+        {
+            glr_cursor temp = heap[location];
+            heap[location] = heap[smallest];
+            heap[smallest] = temp;
+        }
+        location = smallest;
+    }
+}
+
+static n_int glrender_cursor_add(n_int count, n_int *next, n_int *end) {
+    if (next == end) {
+        return count;
+    }
+    if (count == cull_cursors_max) {
+        n_int size = cull_cursors_max ? (cull_cursors_max * 2) : 256;
+        glr_cursor *larger = memory_new(sizeof(glr_cursor) * (n_uint)size);
+        if (larger == 0L) {
+            return -1;
+        }
+        if (cull_cursors) {
+            memory_copy((n_byte *)cull_cursors, (n_byte *)larger, sizeof(glr_cursor) * (n_uint)count);
+            memory_free((void **)&cull_cursors);
+        }
+        cull_cursors = larger;
+        cull_cursors_max = size;
+    }
+    cull_cursors[count].next = next;
+    cull_cursors[count].end = end;
+    return count + 1;
+}
+
+// Renders the primitives of the cells under the world box in list order, the cells are merged by
+// index so the overlaps come out the same as drawing the whole list
+static void glrender_render_box(n_byte *output, memory_list *list, glr_cull *cull, glr_render_item *render,
+                                n_vect2 *direction_vector, n_vect2 *low, n_vect2 *high) {
+    n_int count = 0, cell_x, cell_y, end_x, end_y, loop;
+
+    count = glrender_cursor_add(count, cull->large, cull->large + cull->large_count);
+
+    // primitives reach into the next cell so the cell before the box is visited too
+    cell_x = glrender_cull_cell(low->x) - 1 - cull->low_x;
+    cell_y = glrender_cull_cell(low->y) - 1 - cull->low_y;
+    end_x = glrender_cull_cell(high->x) - cull->low_x;
+    end_y = glrender_cull_cell(high->y) - cull->low_y;
+    if (cell_x < 0) cell_x = 0;
+    if (cell_y < 0) cell_y = 0;
+    if (end_x >= cull->cells_x) end_x = cull->cells_x - 1;
+    if (end_y >= cull->cells_y) end_y = cull->cells_y - 1;
+
+    while ((count != -1) && (cell_y <= end_y)) {
+        n_int *row = &cull->start[cell_y * cull->cells_x];
+        loop = cell_x;
+        while ((count != -1) && (loop <= end_x)) {
+            count = glrender_cursor_add(count, &cull->items[row[loop]], &cull->items[row[loop + 1]]);
+            loop++;
+        }
+        cell_y++;
+    }
+
+    if (count == -1) {
+        (void)SHOW_ERROR("Display cull cursors not allocated");
+        return;
+    }
+
+    // a k-way merge of the cells by index
+    loop = count / 2;
+    while (loop > 0) {
+        glrender_cursor_down(cull_cursors, count, --loop);
+    }
+    while (count) {
+        render(output, list, *cull_cursors[0].next, direction_vector);
+        cull_cursors[0].next++;
+        if (cull_cursors[0].next == cull_cursors[0].end) {
+            cull_cursors[0] = cull_cursors[--count];
+        }
+        glrender_cursor_down(cull_cursors, count, 0);
+    }
+}
+
+static void glrender_render_culled(n_byte *output, memory_list *list, glr_cull *cull, glr_render_item *render,
+                                   n_vect2 *direction_vector) {
+    n_vect2 low, high;
+
+    if (glrender_cull_view(direction_vector, &low, &high) == 0) {
+        for (n_int loop = 0; loop < (n_int)list->count; loop++) {
+            if (glrender_item_detail(list, loop) != cull->skip) {
+                render(output, list, loop, direction_vector);
+            }
+        }
+        return;
+    }
+    glrender_render_box(output, list, cull, render, direction_vector, &low, &high);
+}
+
+// Keeps a visible line in screen pixels for the bands, in the order it would have been drawn
+static void glrender_band_add_line(n_vect2 *corners, GLR_COLOR color, n_byte thickness) {
+    glr_band_item item;
+    item.points[0] = corners[0];
+    item.points[1] = corners[1];
+
+    if ((item.points[0].x < 0 && item.points[1].x < 0) || (item.points[0].y < 0 && item.points[1].y < 0) ||
+        (item.points[0].x > (graph_size.x - 1) && item.points[1].x > (graph_size.x - 1)) ||
+        (item.points[0].y > (graph_size.y - 1) && item.points[1].y > (graph_size.y - 1))) {
+        return;
+    }
+    item.low_y = ((item.points[0].y < item.points[1].y) ? item.points[0].y : item.points[1].y) - 1;
+    item.high_y = ((item.points[0].y > item.points[1].y) ? item.points[0].y : item.points[1].y) + 1;
+    item.quad = 0;
+    item.thickness = thickness;
+    item.color = (n_byte)color;
+    item.stamp = -1;
+    memory_list_copy(band_items, (n_byte *)&item, sizeof(item));
+}
+
+static void glrender_band_add_quad(n_vect2 *corners, GLR_COLOR color) {
+    glr_band_item item;
+    for (n_int i = 0; i < 4; i++) {
+        item.points[i] = corners[i];
+        if ((i == 0) || (item.points[i].y < item.low_y)) item.low_y = item.points[i].y;
+        if ((i == 0) || (item.points[i].y > item.high_y)) item.high_y = item.points[i].y;
+    }
+    item.low_y--;
+    item.high_y++;
+    if ((item.high_y < 0) || (item.low_y > (graph_size.y - 1))) {
+        return;
+    }
+    item.quad = 1;
+    item.thickness = 3;
+    item.color = (n_byte)color;
+    item.stamp = -1;
+    memory_list_copy(band_items, (n_byte *)&item, sizeof(item));
+}
+
+// Keeps a group for the bands the first time in the frame one of its quads is visited, as its runs
+// when they fit the view and otherwise as its lines and quads
+static void glrender_band_stamp(n_int index, n_vect2 *direction_vector) {
+    glr_stamp *stamp = &((glr_stamp *)display_stamps->data)[index];
+    glr_band_item item;
+    n_vect2 corners[4];
+    n_int loop;
+
+    if (stamp->drawn == vertex_frame) {
+        return;
+    }
+    stamp->drawn = vertex_frame;
+    if (glrender_stamp_ready(stamp, direction_vector, &item.points[0])) {
+        item.low_y = item.points[0].y + stamp->offset.y;
+        item.high_y = item.low_y + stamp->size.y - 1;
+        if ((item.high_y < 0) || (item.low_y > (graph_size.y - 1))) {
+            return;
+        }
+        item.quad = 0;
+        item.thickness = 0;
+        item.color = 0;
+        item.stamp = index;
+        memory_list_copy(band_items, (n_byte *)&item, sizeof(item));
+        return;
+    }
+    for (loop = stamp->first_line; loop < stamp->end_line; loop++) {
+        glr_line *line = &((glr_line *)display_lines->data)[loop];
+        glrender_display_corners(display_lines, loop, 2, direction_vector, corners);
+        glrender_band_add_line(corners, line->color, line->thickness);
+    }
+    for (loop = stamp->first_quad; loop < stamp->end_quad; loop++) {
+        glrender_display_corners(display_quads, loop, 4, direction_vector, corners);
+        glrender_band_add_quad(corners, ((glr_quad *)display_quads->data)[loop].color);
+    }
+}
+
+static void glrender_band_line(n_byte *output, memory_list *lines, n_int index, n_vect2 *direction_vector) {
+    glr_line *line = &((glr_line *)lines->data)[index];
+    n_vect2 corners[2];
+    if (line->stamp != -1) {
+        return; // kept with its group's quads
+    }
+    glrender_display_corners(lines, index, 2, direction_vector, corners);
+    glrender_band_add_line(corners, line->color, line->thickness);
+}
+
+static void glrender_band_quad(n_byte *output, memory_list *quads, n_int index, n_vect2 *direction_vector) {
+    glr_quad *quad = &((glr_quad *)quads->data)[index];
+    n_vect2 corners[4];
+    if (quad->stamp != -1) {
+        glrender_band_stamp(quad->stamp, direction_vector);
+        return;
+    }
+    glrender_display_corners(quads, index, 4, direction_vector, corners);
+    glrender_band_add_quad(corners, quad->color);
+}
+
+static n_int glrender_band_execute(void *general_data, void *read_data, void *write_data) {
+    glr_band *band = (glr_band *)read_data;
+    glr_band_item *items = (glr_band_item *)band_items->data;
+    n_uint row_bytes = (n_uint)(graph_size.x * graph_bytes_per_unit());
+    n_vect2 size;
+    n_int loop = 0;
+
+    size.x = graph_size.x;
+    size.y = band->height;
+    graph_erase(band->scratch, &size, (n_rgba32 *)&color_map[GLR_GREEN]);
+
+    while (loop < band->count) {
+        glr_band_item *item = &items[band_order[band->first + loop]];
+        n_rgba32 *color = (n_rgba32 *)&color_map[item->color];
+        n_vect2 points[4];
+        n_int number = item->quad ? 4 : 2;
+        if (item->stamp != -1) {
+            points[0].x = item->points[0].x;
+            points[0].y = item->points[0].y - band->origin;
+            glrender_stamp_copy(band->scratch, &size, &((glr_stamp *)display_stamps->data)[item->stamp], &points[0]);
+            loop++;
+            continue;
+        }
+        for (n_int i = 0; i < number; i++) {
+            points[i].x = item->points[i].x;
+            points[i].y = item->points[i].y - band->origin;
+        }
+        if (item->quad) {
+            graph_fill_polygon(points, 4, color, 0, band->scratch, &size);
+            for (n_int i = 0; i < 4; i++) {
+                graph_line(band->scratch, &size, &points[i], &points[(i + 1) % 4], color, item->thickness);
+            }
+        } else {
+            graph_line(band->scratch, &size, &points[0], &points[1], color, item->thickness);
+        }
+        loop++;
+    }
+    memory_copy(&band->scratch[(n_uint)(band->top - band->origin) * row_bytes],
+                &band->output[(n_uint)band->top * row_bytes],
+                (n_uint)(band->bottom - band->top) * row_bytes);
+    return 0;
+}
+
+// Draws the visible display list across the bands. Returns -1 without drawing when the bands can't be
+// allocated.
+static n_int glrender_render_bands(n_byte *output, n_vect2 *direction_vector, n_int set) {
+    n_int count = (graph_size.y + GLR_BAND_ROWS - 1) / GLR_BAND_ROWS;
+    n_uint row_bytes = (n_uint)(graph_size.x * graph_bytes_per_unit());
+    n_uint scratch_bytes = row_bytes * (n_uint)(graph_size.y + (count * 2));
+    glr_band_item *items;
+    n_int loop, total = 0, offset = 0;
+
+    if (band_items == NULL) {
+        band_items = memory_list_new(sizeof(glr_band_item), 2000 * MULTIPLE_CHECK);
+        if (band_items == NULL) {
+            return -1;
+        }
+    }
+    if (count > bands_max) {
+        memory_free((void **)&bands);
+        bands_max = 0;
+        bands = memory_new(sizeof(glr_band) * (n_uint)count);
+        if (bands == NULL) {
+            return -1;
+        }
+        bands_max = count;
+    }
+    if (scratch_bytes > band_scratch_bytes) {
+        memory_free((void **)&band_scratch);
+        band_scratch_bytes = 0;
+        band_scratch = memory_new(scratch_bytes);
+        if (band_scratch == NULL) {
+            return -1;
+        }
+        band_scratch_bytes = scratch_bytes;
+    }
+
+    band_items->count = 0;
+    glrender_render_culled(output, display_lines, &display_lines_cull[set], glrender_band_line, direction_vector);
+    glrender_render_culled(output, display_quads, &display_quads_cull[set], glrender_band_quad, direction_vector);
+    items = (glr_band_item *)band_items->data;
+
+    // a counting sort of the items into the bands they reach, keeping the drawing order
+    for (loop = 0; loop < count; loop++) {
+        bands[loop].count = 0;
+    }
+    for (loop = 0; loop < (n_int)band_items->count; loop++) {
+        n_int low = (items[loop].low_y < 0) ? 0 : (items[loop].low_y / GLR_BAND_ROWS);
+        n_int high = (items[loop].high_y > (graph_size.y - 1)) ? (count - 1) : (items[loop].high_y / GLR_BAND_ROWS);
+        while (low <= high) {
+            bands[low++].count++;
+            total++;
+        }
+    }
+    if (total > band_order_max) {
+        memory_free((void **)&band_order);
+        band_order_max = 0;
+        band_order = memory_new(sizeof(n_int) * (n_uint)total);
+        if (band_order == NULL) {
+            return -1;
+        }
+        band_order_max = total;
+    }
+    for (loop = 0; loop < count; loop++) {
+        glr_band *band = &bands[loop];
+        band->output = output;
+        band->top = loop * GLR_BAND_ROWS;
+        band->bottom = band->top + GLR_BAND_ROWS;
+        if (band->bottom > graph_size.y) {
+            band->bottom = graph_size.y;
+        }
+        band->origin = (band->top > 0) ? (band->top - 1) : 0;
+        band->height = ((band->bottom < graph_size.y) ? (band->bottom + 1) : band->bottom) - band->origin;
+        band->scratch = &band_scratch[(n_uint)(band->top + (loop * 2)) * row_bytes];
+        band->first = offset;
+        offset += band->count;
+        band->count = 0;
+    }
+    for (loop = 0; loop < (n_int)band_items->count; loop++) {
+        n_int low = (items[loop].low_y < 0) ? 0 : (items[loop].low_y / GLR_BAND_ROWS);
+        n_int high = (items[loop].high_y > (graph_size.y - 1)) ? (count - 1) : (items[loop].high_y / GLR_BAND_ROWS);
+        while (low <= high) {
+            glr_band *band = &bands[low++];
+            band_order[band->first + band->count++] = loop;
+        }
+    }
+
+    execute_group(glrender_band_execute, 0L, bands, count, sizeof(glr_band));
+    return 0;
+}
+
+static void glrender_tile_flush(void) {
+    for (n_int loop = 0; loop < GLR_TILE_BUCKETS; loop++) {
+        tile_buckets[loop] = -1;
+    }
+    for (n_int loop = 0; loop < tiles_max; loop++) {
+        tiles[loop].used = 0;
+    }
+    tile_frame = 0;
+}
+
+static void glrender_tile_free(void) {
+    for (n_int loop = 0; loop < tiles_max; loop++) {
+        memory_free((void **)&tiles[loop].pixels);
+    }
+    memory_free((void **)&tiles);
+    tiles_max = 0;
+}
+
+// Tiles are only kept when there is a budget for them, which is zero by default. The budget is in
+// bytes, each tile takes 256KB.
+void glrender_tile_budget(n_uint budget) {
+    n_int count = (n_int)(budget / GLR_TILE_BYTES);
+    glrender_tile_free();
+    frame_dirty = 1;
+    if (budget == 0) {
+        return;
+    }
+    if (count < 4) {
+        count = 4;
+    }
+    tiles = memory_new(sizeof(glr_tile) * (n_uint)count);
+    if (tiles == 0L) {
+        (void)SHOW_ERROR("Display tiles not allocated");
+        return;
+    }
+    memory_erase((n_byte *)tiles, sizeof(glr_tile) * (n_uint)count);
+    tiles_max = count;
+    glrender_tile_flush();
+}
+
+static n_int glrender_tile_bucket(n_int level, n_int tile_x, n_int tile_y) {
+    n_uint hash = ((n_uint)tile_x * 73856093) ^ ((n_uint)tile_y * 19349663) ^ ((n_uint)level * 83492791);
+    return (n_int)(hash & (GLR_TILE_BUCKETS - 1));
+}
+
+// Draws the display list into the tile through the same culled path as the screen
+static void glrender_tile_draw(glr_tile *tile) {
+    n_vect2 saved_size = graph_size;
+    n_int margin = GLR_CULL_MARGIN << tile->level;
+    n_int set = glrender_detail_set(128 >> tile->level);
+    n_vect2 low, high;
+
+    tile_target_level = tile->level;
+    tile_target_origin.x = (tile->tile_x << GLR_TILE_SHIFT) << tile->level;
+    tile_target_origin.y = (tile->tile_y << GLR_TILE_SHIFT) << tile->level;
+    graph_size.x = GLR_TILE_SIZE;
+    graph_size.y = GLR_TILE_SIZE;
+
+    low.x = tile_target_origin.x - margin;
+    low.y = tile_target_origin.y - margin;
+    high.x = tile_target_origin.x + (GLR_TILE_SIZE << tile->level) + margin;
+    high.y = tile_target_origin.y + (GLR_TILE_SIZE << tile->level) + margin;
+
+    glrender_render_erase(tile->pixels);
+    glrender_render_box(tile->pixels, display_lines, &display_lines_cull[set], glrender_render_line, 0L, &low, &high);
+    glrender_render_box(tile->pixels, display_quads, &display_quads_cull[set], glrender_render_quad, 0L, &low, &high);
+
+    graph_size = saved_size;
+    tile_target_level = -1;
+}
+
+// The tile, drawn if it isn't kept. The least recently sampled tile makes way when the budget is used.
+static glr_tile *glrender_tile(n_int level, n_int tile_x, n_int tile_y) {
+    n_int bucket = glrender_tile_bucket(level, tile_x, tile_y);
+    n_int slot = tile_buckets[bucket];
+    n_int loop = 0;
+    glr_tile *tile;
+
+    while (slot != -1) {
+        tile = &tiles[slot];
+        if ((tile->level == level) && (tile->tile_x == tile_x) && (tile->tile_y == tile_y)) {
+            tile->used = tile_frame;
+            return tile;
+        }
+        slot = tile->next;
+    }
+
+    slot = 0;
+    while (loop < tiles_max) {
+        if (tiles[loop].used < tiles[slot].used) {
+            slot = loop;
+        }
+        loop++;
+    }
+    tile = &tiles[slot];
+
+    if (tile->used) {
+        n_int *link = &tile_buckets[glrender_tile_bucket(tile->level, tile->tile_x, tile->tile_y)];
+        while (*link != slot) {
+            link = &tiles[*link].next;
+        }
+        *link = tile->next;
+    }
+    if (tile->pixels == 0L) {
+        tile->pixels = memory_new(GLR_TILE_BYTES);
+        if (tile->pixels == 0L) {
+            tile->used = 0;
+            return 0L;
+        }
+    }
+    tile->level = level;
+    tile->tile_x = tile_x;
+    tile->tile_y = tile_y;
+    tile->used = tile_frame;
+    tile->next = tile_buckets[bucket];
+    tile_buckets[bucket] = slot;
+
+    glrender_tile_draw(tile);
+    return tile;
+}
+
+// Samples the tiles under each screen pixel, stepping through the world in fixed point along each row.
+// The level is the most detailed one that isn't finer than the screen.
+static n_int glrender_render_tiles(n_byte *output, n_vect2 *direction_vector) {
+    n_int bytes = graph_bytes_per_unit();
+    n_double origin_x, origin_y, across_x, across_y, down_x, down_y, pixel_squared;
+    n_int step_x, step_y, down_step_x, down_step_y, start_x, start_y, shift;
+    n_int last_x = 0, last_y = 0;
+    n_byte *pixels = 0L;
+    n_int level = 0, py = 0;
+
+    if ((glrender_screen_world(direction_vector, 0, 0, &origin_x, &origin_y) == 0) ||
+        (glrender_screen_world(direction_vector, 1, 0, &across_x, &across_y) == 0) ||
+        (glrender_screen_world(direction_vector, 0, 1, &down_x, &down_y) == 0)) {
+        return -1;
+    }
+    across_x -= origin_x;
+    across_y -= origin_y;
+    down_x -= origin_x;
+    down_y -= origin_y;
+
+    pixel_squared = (across_x * across_x) + (across_y * across_y);
+    while ((level < (GLR_TILE_LEVELS - 1)) && ((n_double)((2 << level) * (2 << level)) <= pixel_squared)) {
+        level++;
+    }
+    shift = 16 + level;
+
+    tile_frame++;
+    step_x = (n_int)(across_x * 65536.0);
+    step_y = (n_int)(across_y * 65536.0);
+    down_step_x = (n_int)(down_x * 65536.0);
+    down_step_y = (n_int)(down_y * 65536.0);
+    // the middle of the first pixel
+    start_x = (n_int)((origin_x + ((across_x + down_x) / 2)) * 65536.0);
+    start_y = (n_int)((origin_y + ((across_y + down_y) / 2)) * 65536.0);
+
+    // screen blocks keep the reads within a few tile rows whatever the turn
+    while (py < graph_size.y) {
+        n_int block_y = py + GLR_TILE_BLOCK;
+        n_int block_px = 0;
+        if (block_y > graph_size.y) {
+            block_y = graph_size.y;
+        }
+        while (block_px < graph_size.x) {
+            n_int block_x = block_px + GLR_TILE_BLOCK;
+            n_int row = py;
+            if (block_x > graph_size.x) {
+                block_x = graph_size.x;
+            }
+            while (row < block_y) {
+                n_byte *out = &output[((row * graph_size.x) + block_px) * bytes];
+                n_int world_x = start_x + (down_step_x * row) + (step_x * block_px);
+                n_int world_y = start_y + (down_step_y * row) + (step_y * block_px);
+                n_int px = block_px;
+                while (px < block_x) {
+                    n_int level_x = world_x >> shift;
+                    n_int level_y = world_y >> shift;
+                    n_int tile_x = level_x >> GLR_TILE_SHIFT;
+                    n_int tile_y = level_y >> GLR_TILE_SHIFT;
+                    n_byte *in;
+                    if ((pixels == 0L) || (tile_x != last_x) || (tile_y != last_y)) {
+                        glr_tile *tile = glrender_tile(level, tile_x, tile_y);
+                        if (tile == 0L) {
+                            return -1;
+                        }
+                        pixels = tile->pixels;
+                        last_x = tile_x;
+                        last_y = tile_y;
+                    }
+                    in = &pixels[(((level_y & (GLR_TILE_SIZE - 1)) << GLR_TILE_SHIFT) + (level_x & (GLR_TILE_SIZE - 1))) * bytes];
+                    if (bytes == 4) {
+                        *(n_byte4 *)out = *(n_byte4 *)in;
+                    } else {
+                        memory_copy(in, out, (n_uint)bytes);
+                    }
+                    out += bytes;
+                    world_x += step_x;
+                    world_y += step_y;
+                    px++;
+                }
+                row++;
+            }
+            block_px = block_x;
+        }
+        py = block_y;
+    }
+    return 0;
+}
+
+// The frames count again from the display list's new corners
+static void glrender_stamps_restart(void) {
+    if (display_stamps == NULL) {
+        return;
+    }
+    for (n_int loop = 0; loop < (n_int)display_stamps->count; loop++) {
+        ((glr_stamp *)display_stamps->data)[loop].drawn = 0;
     }
 }
 
@@ -242,9 +1511,147 @@ void glrender_render_active(n_byte *output) {
 }
 
 void glrender_render_display(n_byte *output) {
+    n_int set = glrender_detail_set(current_scale);
+    n_vect2 direction_vector;
+    vect2_direction(&direction_vector, 255 - current_turn, 1);
+
+    if ((display_lines == NULL) || (display_quads == NULL)) {
+        glrender_render_erase(output);
+        return;
+    }
+    if (display_cull_dirty) {
+        if ((glrender_cull_build(&display_lines_cull[GLR_CULL_NEAR], display_lines, 2, GLR_DETAIL_FAR) != 0) ||
+            (glrender_cull_build(&display_quads_cull[GLR_CULL_NEAR], display_quads, 4, GLR_DETAIL_FAR) != 0) ||
+            (glrender_cull_build(&display_lines_cull[GLR_CULL_FAR], display_lines, 2, GLR_DETAIL_NEAR) != 0) ||
+            (glrender_cull_build(&display_quads_cull[GLR_CULL_FAR], display_quads, 4, GLR_DETAIL_NEAR) != 0)) {
+            glrender_render_erase(output);
+            glrender_render_lines(output, display_lines);
+            glrender_render_quads(output, display_quads);
+            return;
+        }
+        (void)glrender_vertices_build();
+        glrender_stamps_restart();
+        glrender_tile_flush();
+        display_cull_dirty = 0;
+    }
+    vertex_frame++;
+    if (tiles_max && (glrender_render_tiles(output, &direction_vector) == 0)) {
+        return;
+    }
+    if (((graph_size.x * graph_size.y) >= GLR_BAND_PIXELS) && (glrender_render_bands(output, &direction_vector, set) == 0)) {
+        return;
+    }
     glrender_render_erase(output);
-    glrender_render_lines(output, display_lines);
-    glrender_render_quads(output, display_quads);
+    glrender_render_culled(output, display_lines, &display_lines_cull[set], glrender_render_display_line, &direction_vector);
+    glrender_render_culled(output, display_quads, &display_quads_cull[set], glrender_render_display_quad, &direction_vector);
+}
+
+// Puts the last frame's static pixels back under each of its active lines. A line only colors the
+// pixels within a pixel of the box around its ends.
+static void glrender_frame_restore(n_byte *output, n_vect2 *direction_vector) {
+    n_int bytes = graph_bytes_per_unit();
+    for (n_int loop = 0; loop < (n_int)frame_active->count; loop++) {
+        glr_line *line = &((glr_line *)frame_active->data)[loop];
+        n_vect2 start, end, low, high;
+        glrender_translate(&line->start, &start, direction_vector);
+        glrender_translate(&line->end, &end, direction_vector);
+        low.x = ((start.x < end.x) ? start.x : end.x) - 1;
+        low.y = ((start.y < end.y) ? start.y : end.y) - 1;
+        high.x = ((start.x > end.x) ? start.x : end.x) + 1;
+        high.y = ((start.y > end.y) ? start.y : end.y) + 1;
+        if (low.x < 0) low.x = 0;
+        if (low.y < 0) low.y = 0;
+        if (high.x > (graph_size.x - 1)) high.x = graph_size.x - 1;
+        if (high.y > (graph_size.y - 1)) high.y = graph_size.y - 1;
+        while (low.y <= high.y && low.x <= high.x) {
+            n_uint offset = (n_uint)(((low.y * graph_size.x) + low.x) * bytes);
+            memory_copy(&frame_static[offset], &output[offset], (n_uint)((high.x - low.x + 1) * bytes));
+            low.y++;
+        }
+    }
+}
+
+static n_int glrender_frame_same_active(void) {
+    glr_line *before, *now;
+    if ((frame_active == NULL) || (active_lines == NULL) || (frame_active->count != active_lines->count)) {
+        return 0;
+    }
+    before = (glr_line *)frame_active->data;
+    now = (glr_line *)active_lines->data;
+    for (n_int loop = 0; loop < (n_int)active_lines->count; loop++) {
+        if ((before[loop].start.x != now[loop].start.x) || (before[loop].start.y != now[loop].start.y) ||
+            (before[loop].end.x != now[loop].end.x) || (before[loop].end.y != now[loop].end.y) ||
+            (before[loop].color != now[loop].color) || (before[loop].thickness != now[loop].thickness)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void glrender_frame_keep_active(void) {
+    if (frame_active == NULL) {
+        frame_active = memory_list_new(sizeof(glr_line), 64 * MULTIPLE_CHECK);
+        if (frame_active == NULL) {
+            return;
+        }
+    }
+    frame_active->count = 0;
+    for (n_int loop = 0; loop < (n_int)active_lines->count; loop++) {
+        memory_list_copy(frame_active, &active_lines->data[(n_uint)loop * sizeof(glr_line)], sizeof(glr_line));
+    }
+}
+
+// The display list and then the active lines, drawn only as far as they changed since the last frame
+// into the same buffer. The display list's pixels are kept aside while the camera stays put, so moving
+// active lines only restores and redraws the pixels around them. Returns 0 when the buffer already
+// holds this frame.
+n_int glrender_render_frame(n_byte *output) {
+    n_uint bytes = (n_uint)(graph_size.x * graph_size.y * graph_bytes_per_unit());
+    n_vect2 direction_vector;
+
+    if (active_lines == NULL) {
+        glrender_render_display(output);
+        frame_dirty = 1;
+        return 1;
+    }
+    if ((frame_dirty == 0) && (frame_static != NULL) && (frame_active != NULL) && (output == frame_output) &&
+        (frame_size.x == graph_size.x) && (frame_size.y == graph_size.y) &&
+        (frame_center.x == current_center.x) && (frame_center.y == current_center.y) &&
+        (frame_location.x == current_location.x) && (frame_location.y == current_location.y) &&
+        (frame_turn == current_turn) && (frame_scale == current_scale)) {
+        if (glrender_frame_same_active()) {
+            return 0;
+        }
+        vect2_direction(&direction_vector, 255 - current_turn, 1);
+        glrender_frame_restore(output, &direction_vector);
+        glrender_render_lines(output, active_lines);
+        glrender_frame_keep_active();
+        return 1;
+    }
+
+    glrender_render_display(output);
+    frame_dirty = 1;
+    if (frame_static_bytes < bytes) {
+        memory_free((void **)&frame_static);
+        frame_static_bytes = 0;
+        frame_static = memory_new(bytes);
+        if (frame_static != NULL) {
+            frame_static_bytes = bytes;
+        }
+    }
+    if (frame_static != NULL) {
+        memory_copy(output, frame_static, bytes);
+        frame_output = output;
+        frame_size = graph_size;
+        frame_center = current_center;
+        frame_location = current_location;
+        frame_turn = current_turn;
+        frame_scale = current_scale;
+        frame_dirty = 0;
+    }
+    glrender_render_lines(output, active_lines);
+    glrender_frame_keep_active();
+    return 1;
 }
 
 void glrender_background_green(void) {
@@ -253,9 +1660,14 @@ void glrender_background_green(void) {
 
 void glrender_start_display_list(void) {
     current_case = GRAPHICS_CASE_DISPLAY;
+    current_detail = GLR_DETAIL_ALL;
+    current_stamp = -1;
     if (!display_quads) {
         display_quads = memory_list_new(sizeof(glr_quad), 500 * MULTIPLE_CHECK);
     }
+    if (!display_stamps) {
+        display_stamps = memory_list_new(sizeof(glr_stamp), 50 * MULTIPLE_CHECK);
+    }
     if (!display_lines) {
         display_lines = memory_list_new(sizeof(glr_line), 2000 * MULTIPLE_CHECK);
     }
@@ -267,6 +1679,8 @@ void glrender_end_display_list(void) {
 
 void glrender_start_active_list(void) {
     current_case = GRAPHICS_CASE_ACTIVE;
+    current_detail = GLR_DETAIL_ALL;
+    current_stamp = -1;
     if (!active_lines) {
         active_lines = memory_list_new(sizeof(glr_line), 64 * MULTIPLE_CHECK);
     } else {
@@ -280,6 +1694,8 @@ void glrender_end_active_list(void) {
 
 void glrender_start_text_list(void) {
     current_case = GRAPHICS_CASE_TEXT;
+    current_detail = GLR_DETAIL_ALL;
+    current_stamp = -1;
     if (!text_lines) {
         text_lines = memory_list_new(sizeof(glr_line), 64 * MULTIPLE_CHECK);
     } else {
@@ -304,7 +1720,9 @@ void glrender_line(n_vect2 *start, n_vect2 *end) {
         .start = *start,
         .end = *end,
         .color = current_color,
-        .thickness = current_thickness
+        .thickness = current_thickness,
+        .detail = (n_byte)current_detail,
+        .stamp = (current_case == GRAPHICS_CASE_DISPLAY) ? current_stamp : -1
     };
 
     switch (current_case) {
@@ -313,6 +1731,8 @@ void glrender_line(n_vect2 *start, n_vect2 *end) {
             break;
         case GRAPHICS_CASE_DISPLAY:
             memory_list_copy(display_lines, (n_byte *)&new_line, sizeof(new_line));
+            display_cull_dirty = 1;
+            frame_dirty = 1;
             break;
         case GRAPHICS_CASE_TEXT:
             memory_list_copy(text_lines, (n_byte *)&new_line, sizeof(new_line));
@@ -322,13 +1742,50 @@ void glrender_line(n_vect2 *start, n_vect2 *end) {
 
 void glrender_fill(n_vect2 *quads) {
     glr_quad new_quad = {
-        .color = current_color
+        .color = current_color,
+        .detail = (n_byte)current_detail,
+        .stamp = current_stamp
     };
     memory_copy((n_byte *)quads, (n_byte *)new_quad.points, sizeof(n_vect2) * 4);
 
     if (current_case == GRAPHICS_CASE_DISPLAY) { /* Information is needed on this FIX */
         memory_list_copy(display_quads, (n_byte *)&new_quad, sizeof(glr_quad));
+        display_cull_dirty = 1;
+        frame_dirty = 1;
+    }
+}
+
+// The display lines and quads until glrender_end_stamp are drawn as a group, placed by the first corner
+// of its first quad
+void glrender_start_stamp(void) {
+    glr_stamp new_stamp = {
+        .drawn = 0
+    };
+    if ((current_case != GRAPHICS_CASE_DISPLAY) || (display_stamps == NULL) || (current_stamp != -1)) {
+        return;
+    }
+    new_stamp.first_line = (n_int)display_lines->count;
+    new_stamp.first_quad = (n_int)display_quads->count;
+    current_stamp = (n_int)display_stamps->count;
+    memory_list_copy(display_stamps, (n_byte *)&new_stamp, sizeof(glr_stamp));
+}
+
+void glrender_end_stamp(void) {
+    glr_stamp *stamp;
+    if (current_stamp == -1) {
+        return;
+    }
+    stamp = &((glr_stamp *)display_stamps->data)[current_stamp];
+    stamp->end_line = (n_int)display_lines->count;
+    stamp->end_quad = (n_int)display_quads->count;
+    if (stamp->end_quad == stamp->first_quad) {
+        // without a quad the group has nowhere to be drawn, so its lines are drawn on their own
+        for (n_int loop = stamp->first_line; loop < stamp->end_line; loop++) {
+            ((glr_line *)display_lines->data)[loop].stamp = -1;
+        }
+        display_stamps->count--;
     }
+    current_stamp = -1;
 }
 
 void glrender_quads(n_vect2 *quads, n_byte filled) {
@@ -355,10 +1812,20 @@ void glrender_init(void) {
 }
 
 void glrender_reset(void) {
+    glrender_stamps_free();
+    if (display_stamps) display_stamps->count = 0;
+    current_stamp = -1;
     if (display_quads) display_quads->count = 0;
     if (display_lines) display_lines->count = 0;
     if (active_lines) active_lines->count = 0;
     if (text_lines) text_lines->count = 0;
+    display_cull_dirty = 1;
+    frame_dirty = 1;
+}
+
+void glrender_scene_reset(void) {
+    glrender_reset();
+    draw_scene_not_done = 0;
 }
 
 void glrender_close(void) {
@@ -366,4 +1833,28 @@ void glrender_close(void) {
     if (display_lines) memory_list_free(&display_lines);
     if (active_lines) memory_list_free(&active_lines);
     if (text_lines) memory_list_free(&text_lines);
+    glrender_stamps_free();
+    if (display_stamps) memory_list_free(&display_stamps);
+    memory_free((void **)&stamp_scratch);
+    glrender_cull_free(&display_lines_cull[GLR_CULL_NEAR]);
+    glrender_cull_free(&display_quads_cull[GLR_CULL_NEAR]);
+    glrender_cull_free(&display_lines_cull[GLR_CULL_FAR]);
+    glrender_cull_free(&display_quads_cull[GLR_CULL_FAR]);
+    memory_free((void **)&cull_cursors);
+    cull_cursors_max = 0;
+    glrender_tile_free();
+    glrender_vertices_free();
+    if (band_items) memory_list_free(&band_items);
+    memory_free((void **)&band_order);
+    memory_free((void **)&bands);
+    memory_free((void **)&band_scratch);
+    band_order_max = 0;
+    bands_max = 0;
+    band_scratch_bytes = 0;
+    if (frame_active) memory_list_free(&frame_active);
+    memory_free((void **)&frame_static);
+    frame_static_bytes = 0;
+    frame_output = NULL;
+    display_cull_dirty = 1;
+    frame_dirty = 1;
 }
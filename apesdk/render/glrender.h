@@ -54,6 +54,14 @@ typedef enum{
     GLR_BLACK = 7
 } GLR_COLOR;
 
+/* the display list detail that follows, near detail is left out when zoomed far out and far detail
+   otherwise */
+typedef enum{
+    GLR_DETAIL_ALL = 0,
+    GLR_DETAIL_NEAR = 1,
+    GLR_DETAIL_FAR = 2
+} GLR_DETAIL;
+
 
 void glrender_set_size(n_int size_x, n_int size_y);
 
@@ -65,6 +73,8 @@ void glrender_color_map_replace(n_byte4 * replace);
 
 void glrender_color(const GLR_COLOR color);
 
+void glrender_detail(const GLR_DETAIL detail);
+
 void glrender_background_green(void); /* */
 
 void glrender_start_text_list(void); /* */
@@ -83,6 +93,8 @@ void glrender_thin_line(void); /* */
 
 void glrender_line(n_vect2 * start, n_vect2 * end); /* */
 void glrender_quads(n_vect2 * quads, n_byte filled); /* */
+void glrender_start_stamp(void); /* */
+void glrender_end_stamp(void); /* */
 
 void glrender_delta_move(n_vect2 * center, n_vect2 * location, n_int turn, n_int scale); /* */
 
@@ -91,9 +103,13 @@ void glrender_render_lines(n_byte * output, memory_list *lines);
 void glrender_render_text(n_byte * output);
 void glrender_render_display(n_byte * output);
 void glrender_render_active(n_byte * output);
+n_int glrender_render_frame(n_byte * output);
+
+void glrender_tile_budget(n_uint budget);
 
 void glrender_init(void);
 void glrender_reset(void);
+void glrender_scene_reset(void);
 void glrender_close(void);
 
 #endif /* _glrender_h_ */
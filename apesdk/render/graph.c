@@ -41,9 +41,19 @@
 #include "graph.h"
 #include "toolkit.h"
 
+/* x86 builds with GCC or Clang check for SSSE3 when first converting pixels, others use the plain loops */
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define GRAPH_SSSE3
+#include <tmmintrin.h>
+#endif
+
 typedef void ( graph_func_set_color )( n_byte *buffer, n_rgba32 *color, n_int number );
 typedef void ( graph_func_set_color_transparency )( n_byte *buffer, n_rgba32 *color, n_int number, n_byte transparency );
 typedef n_int ( graph_func_bytes_per_unit )( void );
+typedef void ( graph_func_convert )( n_byte *from, n_byte *to, n_uint pixels );
+typedef void ( graph_func_line )( n_byte *buffer, n_vect2 *img, n_vect2 *start, n_vect2 *delta, n_int max,
+                                  n_int first, n_int last, n_rgba32 *color, n_byte thickness, n_byte edges );
+typedef void ( graph_func_span )( n_byte *buffer, n_int number, n_int count, n_rgba32 *color, n_byte transparency );
 
 void graph_four_set_color_transparency( n_byte *buffer, n_rgba32 *color, n_int number, n_byte transparency )
 {
@@ -102,9 +112,152 @@ n_int graph_one_bytes_per_unit( void )
     return 1;
 }
 
+/* A line kernel for each pixel size so the pixels are set in place. Each step along the line keeps its
+   whole and remainder parts, which gives the same pixels as dividing at every step. The thick line also
+   colors the four pixels around each step, those are only checked against the edges near the edges. */
+#define GRAPH_LINE_KERNEL( kernel_name, set_pixel )                                                     \
+static void kernel_name( n_byte *buffer, n_vect2 *img, n_vect2 *start, n_vect2 *delta, n_int max,      \
+                         n_int first, n_int last, n_rgba32 *color, n_byte thickness, n_byte edges )     \
+{                                                                                                       \
+    n_byte4 value = color->thirtytwo;                                                                   \
+    n_int   width = img->x;                                                                             \
+    n_int   ax = ( delta->x < 0 ) ? -delta->x : delta->x;                                               \
+    n_int   ay = ( delta->y < 0 ) ? -delta->y : delta->y;                                               \
+    n_int   sx = ( delta->x < 0 ) ? -1 : 1;                                                             \
+    n_int   sy = ( delta->y < 0 ) ? -width : width;                                                     \
+    n_int   qx = ( first * ax ) / max, rx = ( first * ax ) % max;                                       \
+    n_int   qy = ( first * ay ) / max, ry = ( first * ay ) % max;                                       \
+    n_int   xx = start->x + ( ( delta->x < 0 ) ? -qx : qx );                                            \
+    n_int   yy = start->y + ( ( delta->y < 0 ) ? -qy : qy );                                            \
+    n_int   n = ( yy * width ) + xx;                                                                    \
+    n_int   i = first;                                                                                  \
+    ( void )value;                                                                                      \
+    while ( i < last )                                                                                  \
+    {                                                                                                   \
+        set_pixel( n );                                                                                 \
+        if ( thickness > 2 )                                                                            \
+        {                                                                                               \
+            if ( ( edges == 0 ) || ( yy > 0 ) )                                                         \
+            {                                                                                           \
+                set_pixel( n - width );                                                                 \
+            }                                                                                           \
+            if ( ( edges == 0 ) || ( xx > 0 ) )                                                         \
+            {                                                                                           \
+                set_pixel( n - 1 );                                                                     \
+            }                                                                                           \
+            if ( ( edges == 0 ) || ( ( yy + 1 ) < img->y ) )                                            \
+            {                                                                                           \
+                set_pixel( n + width );                                                                 \
+            }                                                                                           \
+            if ( ( edges == 0 ) || ( ( xx + 1 ) < width ) )                                             \
+            {                                                                                           \
+                set_pixel( n + 1 );                                                                     \
+            }                                                                                           \
+        }                                                                                               \
+        rx += ax;                                                                                       \
+        if ( rx >= max )                                                                                \
+        {                                                                                               \
+            rx -= max;                                                                                  \
+            xx += sx;                                                                                   \
+            n += sx;                                                                                    \
+        }                                                                                               \
+        ry += ay;                                                                                       \
+        if ( ry >= max )                                                                                \
+        {                                                                                               \
+            ry -= max;                                                                                  \
+            yy += ( delta->y < 0 ) ? -1 : 1;                                                            \
+            n += sy;                                                                                    \
+        }                                                                                               \
+        i++;                                                                                            \
+    }                                                                                                   \
+}
+
+#define GRAPH_SET_ONE( number )   buffer[( number )] = color->rgba.b
+#define GRAPH_SET_THREE( number ) { n_byte *pixel = &buffer[( number ) * 3]; pixel[0] = color->rgba.b; pixel[1] = color->rgba.g; pixel[2] = color->rgba.r; }
+#define GRAPH_SET_FOUR( number )  ( ( n_byte4 * )buffer )[( number )] = value
+
+GRAPH_LINE_KERNEL( graph_line_one, GRAPH_SET_ONE )
+GRAPH_LINE_KERNEL( graph_line_three, GRAPH_SET_THREE )
+GRAPH_LINE_KERNEL( graph_line_four, GRAPH_SET_FOUR )
+
+/* Span kernels fill a run of pixels on one row, blending when there is transparency */
+static void graph_span_one( n_byte *buffer, n_int number, n_int count, n_rgba32 *color, n_byte transparency )
+{
+    n_byte *pixel = &buffer[number];
+    if ( transparency == 0 )
+    {
+        while ( count-- > 0 )
+        {
+            *pixel++ = color->rgba.b;
+        }
+        return;
+    }
+    while ( count-- > 0 )
+    {
+        *pixel = ( ( color->rgba.b * ( 255 - transparency ) ) + ( *pixel * transparency ) ) / 256;
+        pixel++;
+    }
+}
+
+static void graph_span_three( n_byte *buffer, n_int number, n_int count, n_rgba32 *color, n_byte transparency )
+{
+    n_byte *pixel = &buffer[number * 3];
+    if ( transparency == 0 )
+    {
+        while ( count-- > 0 )
+        {
+            pixel[0] = color->rgba.b;
+            pixel[1] = color->rgba.g;
+            pixel[2] = color->rgba.r;
+            pixel += 3;
+        }
+        return;
+    }
+    {
+        n_int opaque = 255 - transparency;
+        n_int b = color->rgba.b * opaque, g = color->rgba.g * opaque, r = color->rgba.r * opaque;
+        while ( count-- > 0 )
+        {
+            pixel[0] = ( b + ( pixel[0] * transparency ) ) / 256;
+            pixel[1] = ( g + ( pixel[1] * transparency ) ) / 256;
+            pixel[2] = ( r + ( pixel[2] * transparency ) ) / 256;
+            pixel += 3;
+        }
+    }
+}
+
+static void graph_span_four( n_byte *buffer, n_int number, n_int count, n_rgba32 *color, n_byte transparency )
+{
+    if ( transparency == 0 )
+    {
+        n_byte4 *pixel = &( ( n_byte4 * )buffer )[number];
+        n_byte4  value = color->thirtytwo;
+        while ( count-- > 0 )
+        {
+            *pixel++ = value;
+        }
+        return;
+    }
+    {
+        n_byte *pixel = &buffer[number * 4];
+        n_int opaque = 255 - transparency;
+        n_int b = color->rgba.b * opaque, g = color->rgba.g * opaque, r = color->rgba.r * opaque;
+        while ( count-- > 0 )
+        {
+            pixel[0] = ( b + ( pixel[0] * transparency ) ) / 256;
+            pixel[1] = ( g + ( pixel[1] * transparency ) ) / 256;
+            pixel[2] = ( r + ( pixel[2] * transparency ) ) / 256;
+            pixel[3] = 0;
+            pixel += 4;
+        }
+    }
+}
+
 static graph_func_set_color       *graph_local_set_color = &graph_one_set_color;
 static graph_func_bytes_per_unit *graph_local_bytes_per_unit = &graph_one_bytes_per_unit;
 static graph_func_set_color_transparency *graph_local_set_color_transparency = &graph_one_set_color_transparency;
+static graph_func_line           *graph_local_line = &graph_line_one;
+static graph_func_span           *graph_local_span = &graph_span_one;
 
 
 void graph_init( n_int four_byte_factory )
@@ -114,6 +267,8 @@ void graph_init( n_int four_byte_factory )
         graph_local_set_color = &graph_four_set_color;
         graph_local_bytes_per_unit = &graph_four_bytes_per_unit;
         graph_local_set_color_transparency = &graph_four_set_color_transparency;
+        graph_local_line = &graph_line_four;
+        graph_local_span = &graph_span_four;
     }
 }
 
@@ -122,21 +277,139 @@ void graph_init_three(void)
     graph_local_set_color = &graph_three_set_color;
     graph_local_bytes_per_unit = &graph_three_bytes_per_unit;
     graph_local_set_color_transparency = &graph_three_set_color_transparency;
+    graph_local_line = &graph_line_three;
+    graph_local_span = &graph_span_three;
+}
+
+n_int graph_bytes_per_unit( void )
+{
+    return graph_local_bytes_per_unit();
 }
 
 void graph_erase( n_byte *buffer, n_vect2 *img, n_rgba32 *color )
 {
-    n_int i = 0;
-    while ( i < img->x )
+    n_uint row = ( n_uint )( img->x * graph_local_bytes_per_unit() );
+    n_int  i = 1;
+
+    if ( img->y < 1 )
     {
-        graph_local_set_color( buffer, color, i++ );
+        return;
     }
-    i = 1;
+    graph_local_span( buffer, 0, img->x, color, 0 );
+
+    /* the first row stays in the cache while it is copied down */
     while ( i < img->y )
     {
-        n_int bytes_per_unit = graph_local_bytes_per_unit();
-        memory_copy( buffer, &buffer[ i++ * img->x * bytes_per_unit], ( n_uint )( img->x * bytes_per_unit ) );
+        memory_copy( buffer, &buffer[ ( n_uint )i * row ], row );
+        i++;
+    }
+}
+
+static void graph_plain_4_to_3( n_byte *from, n_byte *to, n_uint pixels )
+{
+    while ( pixels-- > 0 )
+    {
+        to[0] = from[1];
+        to[1] = from[2];
+        to[2] = from[3];
+        from += 4;
+        to += 3;
+    }
+}
+
+static void graph_plain_3_to_4( n_byte *from, n_byte *to, n_uint pixels )
+{
+    while ( pixels-- > 0 )
+    {
+        to[0] = 0;
+        to[1] = from[0];
+        to[2] = from[1];
+        to[3] = from[2];
+        from += 3;
+        to += 4;
+    }
+}
+
+#ifdef GRAPH_SSSE3
+
+/* four pixels a shuffle, each store writes four bytes past the pixels so six must be left */
+__attribute__( ( target( "ssse3" ) ) )
+static void graph_ssse3_4_to_3( n_byte *from, n_byte *to, n_uint pixels )
+{
+    __m128i order = _mm_setr_epi8( 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -128, -128, -128, -128 );
+    while ( pixels >= 6 )
+    {
+        __m128i four = _mm_loadu_si128( ( __m128i * )from );
+        _mm_storeu_si128( ( __m128i * )to, _mm_shuffle_epi8( four, order ) );
+        from += 16;
+        to += 12;
+        pixels -= 4;
+    }
+    graph_plain_4_to_3( from, to, pixels );
+}
+
+/* each load reads four bytes past the pixels so six must be left */
+__attribute__( ( target( "ssse3" ) ) )
+static void graph_ssse3_3_to_4( n_byte *from, n_byte *to, n_uint pixels )
+{
+    __m128i order = _mm_setr_epi8( -128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11 );
+    while ( pixels >= 6 )
+    {
+        __m128i three = _mm_loadu_si128( ( __m128i * )from );
+        _mm_storeu_si128( ( __m128i * )to, _mm_shuffle_epi8( three, order ) );
+        from += 12;
+        to += 16;
+        pixels -= 4;
     }
+    graph_plain_3_to_4( from, to, pixels );
+}
+
+#endif
+
+static graph_func_convert *graph_local_4_to_3 = 0L;
+static graph_func_convert *graph_local_3_to_4 = 0L;
+
+static void graph_convert_choose( void )
+{
+    graph_local_4_to_3 = &graph_plain_4_to_3;
+    graph_local_3_to_4 = &graph_plain_3_to_4;
+#ifdef GRAPH_SSSE3
+    if ( __builtin_cpu_supports( "ssse3" ) )
+    {
+        graph_local_4_to_3 = &graph_ssse3_4_to_3;
+        graph_local_3_to_4 = &graph_ssse3_3_to_4;
+    }
+#endif
+}
+
+/**
+ * @brief Packs four byte pixels into three bytes, leaving out the first byte of each
+ * @param from the four byte pixels
+ * @param to the three byte pixels, the caller's buffer of pixels * 3 bytes
+ * @param pixels the number of pixels
+ */
+void graph_convert_4_to_3( n_byte *from, n_byte *to, n_uint pixels )
+{
+    if ( graph_local_4_to_3 == 0L )
+    {
+        graph_convert_choose();
+    }
+    graph_local_4_to_3( from, to, pixels );
+}
+
+/**
+ * @brief Spreads three byte pixels into four bytes with a zero first byte
+ * @param from the three byte pixels
+ * @param to the four byte pixels, the caller's buffer of pixels * 4 bytes
+ * @param pixels the number of pixels
+ */
+void graph_convert_3_to_4( n_byte *from, n_byte *to, n_uint pixels )
+{
+    if ( graph_local_3_to_4 == 0L )
+    {
+        graph_convert_choose();
+    }
+    graph_local_3_to_4( from, to, pixels );
 }
 
 typedef struct{
@@ -203,6 +476,51 @@ void graph_line2( n_byte   *buffer,
 }
 
 
+/* the first step along a line at or past value, the steps are in order when delta is positive */
+static n_int graph_line_step( n_int start, n_int delta, n_int max, n_int value )
+{
+    n_int low = 0;
+    n_int high = max;
+    while ( low < high )
+    {
+        n_int middle = ( low + high ) / 2;
+        n_int location = start + ( middle * delta / max );
+        if ( ( delta < 0 ) ? ( location <= value ) : ( location >= value ) )
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/* narrows the steps along a line to those between low and high, the steps move one way so they are together */
+static void graph_line_steps( n_int start, n_int delta, n_int max, n_int low, n_int high, n_int *first, n_int *last )
+{
+    n_int from, to;
+    if ( delta < 0 )
+    {
+        from = graph_line_step( start, delta, max, high );
+        to = graph_line_step( start, delta, max, low - 1 );
+    }
+    else
+    {
+        from = graph_line_step( start, delta, max, low );
+        to = graph_line_step( start, delta, max, high + 1 );
+    }
+    if ( from > *first )
+    {
+        *first = from;
+    }
+    if ( to < *last )
+    {
+        *last = to;
+    }
+}
+
 /* draws a line */
 void graph_line( n_byte *buffer,
                  n_vect2 *img,
@@ -211,7 +529,7 @@ void graph_line( n_byte *buffer,
                  n_rgba32 *color,
                  n_byte thickness )
 {
-    n_int i, max;
+    n_int max, first, last, inner_first, inner_last;
     n_vect2 delta;
     n_vect2 absdelta;
 
@@ -234,43 +552,45 @@ void graph_line( n_byte *buffer,
         max = absdelta.y;
     }
 
-    for ( i = 0; i < max; i++ )
+    if ( max == 0 )
     {
-        n_int xx = previous->x + ( i * ( current->x - previous->x ) / max );
-        if ( ( xx > -1 ) && ( xx < img->x ) )
-        {
-            n_int yy = previous->y + ( i * ( current->y - previous->y ) / max );
-            if ( ( yy > -1 ) && ( yy < img->y ) )
-            {
-                n_int n = ( yy * img->x + xx );
-                graph_local_set_color( buffer, color, n );
-
-                if ( thickness > 2 )
-                {
-                    if ( yy > 0 )
-                    {
-                        n_int n = ( yy - 1 ) * img->x + xx;
-                        graph_local_set_color( buffer, color, n );
-                    }
-                    if ( xx > 0 )
-                    {
-                        n_int n = ( yy * img->x + xx - 1 );
-                        graph_local_set_color( buffer, color, n );
-                    }
-                    if ( ( yy + 1 ) < img->y )
-                    {
-                        n_int n = ( ( yy + 1 ) * img->x + xx );
-                        graph_local_set_color( buffer, color, n );
-                    }
-                    if ( ( xx + 1 ) < img->x )
-                    {
-                        n_int n = ( yy * img->x + xx + 1 );
-                        graph_local_set_color( buffer, color, n );
-                    }
-                }
+        return;
+    }
 
-            }
-        }
+    /* only the steps inside the image are visited */
+    first = 0;
+    last = max;
+    graph_line_steps( previous->x, delta.x, max, 0, img->x - 1, &first, &last );
+    graph_line_steps( previous->y, delta.y, max, 0, img->y - 1, &first, &last );
+    if ( first >= last )
+    {
+        return;
+    }
+
+    if ( thickness < 3 )
+    {
+        graph_local_line( buffer, img, previous, &delta, max, first, last, color, thickness, 0 );
+        return;
+    }
+
+    /* the thick steps away from the edges don't need their neighbors checked */
+    inner_first = first;
+    inner_last = last;
+    graph_line_steps( previous->x, delta.x, max, 1, img->x - 2, &inner_first, &inner_last );
+    graph_line_steps( previous->y, delta.y, max, 1, img->y - 2, &inner_first, &inner_last );
+    if ( inner_first >= inner_last )
+    {
+        graph_local_line( buffer, img, previous, &delta, max, first, last, color, thickness, 1 );
+        return;
+    }
+    if ( first < inner_first )
+    {
+        graph_local_line( buffer, img, previous, &delta, max, first, inner_first, color, thickness, 1 );
+    }
+    graph_local_line( buffer, img, previous, &delta, max, inner_first, inner_last, color, thickness, 0 );
+    if ( inner_last < last )
+    {
+        graph_local_line( buffer, img, previous, &delta, max, inner_last, last, color, thickness, 1 );
     }
 }
 
@@ -349,10 +669,163 @@ void graph_curve( n_byte *buffer,
 
 #define  MAX_POLYGON_CORNERS 1000
 
+typedef struct
+{
+    n_int low, high; /* the edge crosses the rows after low up to high */
+    n_int x, y;      /* the corner the crossing is measured from */
+    n_int dx, dy;
+} graph_edge;
+
+/* the crossing of an edge with a row, measured from the same corner as ever so the rounding is kept */
+#define GRAPH_EDGE_CROSSING( edge, row ) ( ( edge )->x + ( ( row ) - ( edge )->y ) * ( edge )->dx / ( edge )->dy )
+
+static void graph_edge_set( graph_edge *edge, n_vect2 *from, n_vect2 *to )
+{
+    edge->x = from->x;
+    edge->y = from->y;
+    edge->dx = to->x - from->x;
+    edge->dy = to->y - from->y;
+    edge->low = ( from->y < to->y ) ? from->y : to->y;
+    edge->high = ( from->y < to->y ) ? to->y : from->y;
+}
+
+/* fills between each pair of sorted crossings on a row, inside the polygon's box less its first column and last two */
+static void graph_fill_row( n_int *crossing, n_int nodes, n_int y, n_int min_x, n_int max_x,
+                            n_rgba32 *color, n_byte transparency, n_byte *buffer, n_vect2 *img )
+{
+    n_int i;
+    for ( i = 0; i < nodes; i += 2 )
+    {
+        n_int start = crossing[i];
+        n_int end = crossing[i + 1];
+        if ( start >= max_x )
+        {
+            break;
+        }
+        if ( end > min_x )
+        {
+            if ( start <= min_x )
+            {
+                start = min_x + 1;
+            }
+            if ( end >= max_x )
+            {
+                end = max_x - 1;
+            }
+            if ( start < end )
+            {
+                graph_local_span( buffer, ( y * img->x ) + start, end - start, color, transparency );
+            }
+        }
+    }
+}
+
+static void graph_sort_crossings( n_int *crossing, n_int nodes )
+{
+    n_int i = 1;
+    while ( i < nodes )
+    {
+        n_int value = crossing[i];
+        n_int j = i;
+        while ( ( j > 0 ) && ( crossing[j - 1] > value ) )
+        {
+            crossing[j] = crossing[j - 1];
+            j--;
+        }
+        crossing[j] = value;
+        i++;
+    }
+}
+
+/* the four edges of a quad are simply checked on each row */
+static void graph_fill_quad( n_vect2 *points, n_int min_x, n_int min_y, n_int max_x, n_int max_y,
+                             n_rgba32 *color, n_byte transparency, n_byte *buffer, n_vect2 *img )
+{
+    graph_edge edges[4];
+    n_int      i, y;
+
+    graph_edge_set( &edges[0], &points[0], &points[3] );
+    graph_edge_set( &edges[1], &points[1], &points[0] );
+    graph_edge_set( &edges[2], &points[2], &points[1] );
+    graph_edge_set( &edges[3], &points[3], &points[2] );
+
+    for ( y = min_y; y <= max_y; y++ )
+    {
+        n_int crossing[4];
+        n_int nodes = 0;
+        for ( i = 0; i < 4; i++ )
+        {
+            if ( ( edges[i].low < y ) && ( edges[i].high >= y ) )
+            {
+                crossing[nodes++] = GRAPH_EDGE_CROSSING( &edges[i], y );
+            }
+        }
+        graph_sort_crossings( crossing, nodes );
+        graph_fill_row( crossing, nodes, y, min_x, max_x, color, transparency, buffer, img );
+    }
+}
+
+/* The edges are taken in order of their top row. Each row adds the edges that start above it and drops
+   those that ended, only the edges left are crossed. */
+static void graph_fill_edges( n_vect2 *points, n_int no_of_points, n_int min_x, n_int min_y, n_int max_x, n_int max_y,
+                              n_rgba32 *color, n_byte transparency, n_byte *buffer, n_vect2 *img )
+{
+    graph_edge edges[MAX_POLYGON_CORNERS];
+    n_int      active[MAX_POLYGON_CORNERS];
+    n_int      crossing[MAX_POLYGON_CORNERS];
+    n_int      count = 0, active_count = 0, next = 0, i, j, y;
+
+    j = no_of_points - 1;
+    for ( i = 0; i < no_of_points; i++ )
+    {
+        if ( points[j].y != points[i].y )
+        {
+            graph_edge edge;
+            n_int      k = count;
+            graph_edge_set( &edge, &points[i], &points[j] );
+            while ( ( k > 0 ) && ( edges[k - 1].low > edge.low ) )
+            {
+                edges[k] = edges[k - 1];
+                k--;
+            }
+            edges[k] = edge;
+            count++;
+        }
+        j = i;
+    }
+
+    for ( y = min_y; y <= max_y; y++ )
+    {
+        n_int nodes = 0;
+        while ( ( next < count ) && ( edges[next].low < y ) )
+        {
+            active[active_count++] = next++;
+        }
+        i = 0;
+        while ( i < active_count )
+        {
+            graph_edge *edge = &edges[active[i]];
+            if ( edge->high < y )
+            {
+                active[i] = active[--active_count];
+                continue;
+            }
+            crossing[nodes++] = GRAPH_EDGE_CROSSING( edge, y );
+            i++;
+        }
+        if ( ( next == count ) && ( active_count == 0 ) )
+        {
+            return;
+        }
+        graph_sort_crossings( crossing, nodes );
+        graph_fill_row( crossing, nodes, y, min_x, max_x, color, transparency, buffer, img );
+    }
+}
+
 /**
  * @brief Draw a filled polygon
  * @param points Array containing 2D points
- * @param no_of_points The number of 2D points
+ * @param no_of_points The number of 2D points, at most MAX_POLYGON_CORNERS
  * @param color color of polygon
  * @param transparency Degree of transparency
  * @param buffer Image buffer (3 bytes per pixel)
@@ -362,10 +835,15 @@ void graph_fill_polygon( n_vect2 *points, n_int no_of_points,
                          n_rgba32 *color, n_byte transparency,
                          n_byte *buffer, n_vect2 *img )
 {
-    n_int nodes, nodeX[MAX_POLYGON_CORNERS] = {0}, i, j, swap, n, x, y;
+    n_int i, x, y;
     n_int min_x = 99999, min_y = 99999;
     n_int max_x = -99999, max_y = -99999;
 
+    if ( no_of_points > MAX_POLYGON_CORNERS )
+    {
+        no_of_points = MAX_POLYGON_CORNERS;
+    }
+
     for ( i = 0; i < no_of_points; i++ )
     {
         x = points[i].x;
@@ -408,86 +886,17 @@ void graph_fill_polygon( n_vect2 *points, n_int no_of_points,
     {
         max_y = img->y - 1;
     }
-
-    for ( y = min_y; y <= max_y; y++ )
+    if ( ( min_y > max_y ) || ( min_x > max_x ) )
     {
-        /**  Build a list of nodes */
-        nodes = 0;
-        j = no_of_points - 1;
-        for ( i = 0; i < no_of_points; i++ )
-        {
-            if ( ( ( points[i].y < y ) && ( points[j].y >= y ) ) ||
-                    ( ( points[j].y < y ) && ( points[i].y >= y ) ) )
-            {
-                if ( points[j].y - points[i].y )
-                {
-                    nodeX[nodes++] =
-                        points[i].x + ( y - points[i].y ) *
-                        ( points[j].x - points[i].x ) /
-                        ( points[j].y - points[i].y );
-                }
-            }
-            j = i;
-            if ( nodes == MAX_POLYGON_CORNERS )
-            {
-                break;
-            }
-        }
-
-        /**  Sort the nodes, via a simple “Bubble” sort */
-        i = 0;
-        while ( i < nodes - 1 )
-        {
-            if ( nodeX[i] > nodeX[i + 1] )
-            {
-                swap = nodeX[i];
-                nodeX[i] = nodeX[i + 1];
-                nodeX[i + 1] = swap;
-                if ( i )
-                {
-                    i--;
-                }
-            }
-            else
-            {
-                i++;
-            }
-        }
+        return;
+    }
 
-        /**  Fill the pixels between node pairs */
-        for ( i = 0; i < nodes; i += 2 )
-        {
-            if ( nodeX[i] >= max_x )
-            {
-                break;
-            }
-            if ( nodeX[i + 1] > min_x )
-            {
-                /** range check */
-                if ( nodeX[i] <= min_x )
-                {
-                    nodeX[i] = min_x + 1;
-                }
-                if ( nodeX[i + 1] >= max_x )
-                {
-                    nodeX[i + 1] = max_x - 1;
-                }
-
-                for ( x = nodeX[i]; x < nodeX[i + 1]; x++ )
-                {
-                    n = ( ( y * img->x ) + x );
-
-                    if ( transparency == 0 )
-                    {
-                        graph_local_set_color( buffer, color, n );
-                    }
-                    else
-                    {
-                        graph_local_set_color_transparency( buffer, color, n, transparency );
-                    }
-
-                }
-            }
-        }
+    if ( no_of_points == 4 )
+    {
+        graph_fill_quad( points, min_x, min_y, max_x, max_y, color, transparency, buffer, img );
+    }
+    else
+    {
+        graph_fill_edges( points, no_of_points, min_x, min_y, max_x, max_y, color, transparency, buffer, img );
     }
 }
@@ -41,9 +41,13 @@
 
 void graph_init( n_int four_byte_factory );
 void graph_init_three(void);
+n_int graph_bytes_per_unit( void );
 
 void graph_erase( n_byte *buffer, n_vect2 *img, n_rgba32 *color );
 
+void graph_convert_4_to_3( n_byte *from, n_byte *to, n_uint pixels );
+void graph_convert_3_to_4( n_byte *from, n_byte *to, n_uint pixels );
+
 /* draws a line */
 void graph_line( n_byte *buffer,
                  n_vect2 *img,
@@ -0,0 +1,246 @@
+/****************************************************************
+
+ execute.c
+
+ =============================================================
+
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+
+ ****************************************************************/
+
+/*! \file   execute.c
+ *  \brief  Covers the thread pool used to run groups of independent jobs.
+ */
+
+#include "toolkit.h"
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define EXECUTE_MAX_THREADS (64)
+
+static pthread_t       execute_thread[EXECUTE_MAX_THREADS];
+static pthread_mutex_t execute_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  execute_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  execute_finish = PTHREAD_COND_INITIALIZER;
+
+static n_int            execute_thread_count = -1;
+static n_int            execute_thread_running = 0;
+static n_int            execute_quit = 0;
+static n_uint           execute_generation = 0;
+static n_int            execute_busy = 0;
+
+static execute_function *execute_group_function;
+static void            *execute_group_general;
+static n_byte          *execute_group_read;
+static n_int            execute_group_count;
+static n_int            execute_group_size;
+static n_int            execute_group_next;
+static n_int            execute_group_done;
+
+/**
+ * Takes the next job from the current group and runs it. Called with the mutex locked
+ * and returns with the mutex locked.
+ * @return 1 if a job was run, 0 if the group has no jobs left.
+ */
+static n_int execute_group_step( void )
+{
+    n_int job;
+    if ( execute_group_next >= execute_group_count )
+    {
+        return 0;
+    }
+    job = execute_group_next++;
+    pthread_mutex_unlock( &execute_mutex );
+
+    ( void )execute_group_function( execute_group_general, &execute_group_read[job * execute_group_size], 0L );
+
+    pthread_mutex_lock( &execute_mutex );
+    execute_group_done++;
+    if ( execute_group_done == execute_group_count )
+    {
+        pthread_cond_broadcast( &execute_finish );
+    }
+    return 1;
+}
+
+static void *execute_thread_loop( void *unused )
+{
+    n_uint generation = 0;
+    pthread_mutex_lock( &execute_mutex );
+    while ( execute_quit == 0 )
+    {
+        while ( ( execute_quit == 0 ) && ( generation == execute_generation ) )
+        {
+            pthread_cond_wait( &execute_start, &execute_mutex );
+        }
+        generation = execute_generation;
+        while ( execute_group_step() )
+        {
+        }
+    }
+    pthread_mutex_unlock( &execute_mutex );
+    return 0L;
+}
+
+/**
+ * Starts the worker threads. The calling thread also works through each group so
+ * one less worker than the number of processors is started.
+ */
+static void execute_start_threads( void )
+{
+    n_int loop = 0;
+
+    if ( execute_thread_count < 0 )
+    {
+        execute_thread_count = ( n_int )sysconf( _SC_NPROCESSORS_ONLN ) - 1;
+    }
+    if ( execute_thread_count > EXECUTE_MAX_THREADS )
+    {
+        execute_thread_count = EXECUTE_MAX_THREADS;
+    }
+    while ( loop < execute_thread_count )
+    {
+        if ( pthread_create( &execute_thread[loop], 0L, execute_thread_loop, 0L ) != 0 )
+        {
+            break;
+        }
+        loop++;
+    }
+    execute_thread_running = loop;
+}
+
+/**
+ * Sets the number of threads used by execute_group. This must be called before the
+ * first group is run or after execute_close.
+ * @param threads total number of threads including the calling thread, 1 runs groups serially.
+ */
+void execute_threads( n_int threads )
+{
+    execute_close();
+    execute_thread_count = ( threads > 0 ) ? ( threads - 1 ) : -1;
+}
+
+/**
+ * Runs the function over each element of the read_data array across the thread pool.
+ * The call returns when every element has been processed.
+ * @param function the function run on each element.
+ * @param general_data data shared by all the elements.
+ * @param read_data the start of the element array.
+ * @param count the number of elements.
+ * @param size the size of each element in bytes.
+ */
+void execute_group( execute_function *function, void *general_data, void *read_data, n_int count, n_int size )
+{
+    pthread_mutex_lock( &execute_mutex );
+
+    if ( execute_busy || ( count < 2 ) )
+    {
+        n_int loop = 0;
+        pthread_mutex_unlock( &execute_mutex );
+        while ( loop < count )
+        {
+            ( void )function( general_data, &( ( n_byte * )read_data )[loop * size], 0L );
+            loop++;
+        }
+        return;
+    }
+
+    if ( ( execute_thread_running == 0 ) && ( execute_thread_count != 0 ) )
+    {
+        execute_start_threads();
+    }
+
+    execute_busy = 1;
+    execute_group_function = function;
+    execute_group_general = general_data;
+    execute_group_read = ( n_byte * )read_data;
+    execute_group_count = count;
+    execute_group_size = size;
+    execute_group_next = 0;
+    execute_group_done = 0;
+    execute_generation++;
+
+    pthread_cond_broadcast( &execute_start );
+
+    while ( execute_group_step() )
+    {
+    }
+    while ( execute_group_done < execute_group_count )
+    {
+        pthread_cond_wait( &execute_finish, &execute_mutex );
+    }
+    execute_busy = 0;
+    pthread_mutex_unlock( &execute_mutex );
+}
+
+/**
+ * Stops and joins the worker threads.
+ */
+void execute_close( void )
+{
+    n_int loop = 0;
+
+    pthread_mutex_lock( &execute_mutex );
+    execute_quit = 1;
+    pthread_cond_broadcast( &execute_start );
+    pthread_mutex_unlock( &execute_mutex );
+
+    while ( loop < execute_thread_running )
+    {
+        pthread_join( execute_thread[loop], 0L );
+        loop++;
+    }
+
+    execute_thread_running = 0;
+    execute_quit = 0;
+}
+
+#else
+
+void execute_threads( n_int threads )
+{
+}
+
+void execute_group( execute_function *function, void *general_data, void *read_data, n_int count, n_int size )
+{
+    n_int loop = 0;
+    while ( loop < count )
+    {
+        ( void )function( general_data, &( ( n_byte * )read_data )[loop * size], 0L );
+        loop++;
+    }
+}
+
+void execute_close( void )
+{
+}
+
+#endif
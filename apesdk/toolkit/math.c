@@ -41,6 +41,16 @@
 
 #include "toolkit.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define MATH_SEGMENTS_SSE2
+#endif
+
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#include <immintrin.h>
+#define MATH_SEGMENTS_AVX2
+#endif
+
 /**
  This is used to produce a series of steps between two points useful for drawing
  a line or a line of sight test.
@@ -569,3 +579,359 @@ n_byte math_do_intersect( n_vect2 *p1, n_vect2 *q1, n_vect2 *p2, n_vect2 *q2 )
 
     return 0; /* Doesn't fall in any of the above cases */
 }
+
+static void math_segments_default( void );
+
+/**
+ Creates a structure-of-arrays segment list. The first list chooses the kernel, so it is chosen
+ before the lists are tested from more than one thread.
+ @param max The initial number of segments allocated.
+ @return The segment list or 0L if it could not be allocated.
+ */
+n_segments *math_segments_new( n_int max )
+{
+    n_segments *segments = ( n_segments * )memory_new( sizeof( n_segments ) );
+    math_segments_default();
+    if ( segments == 0L )
+    {
+        return 0L;
+    }
+    if ( max < 4 )
+    {
+        max = 4;
+    }
+    segments->start_x = ( n_double * )memory_new( sizeof( n_double ) * ( n_uint )max );
+    segments->start_y = ( n_double * )memory_new( sizeof( n_double ) * ( n_uint )max );
+    segments->end_x = ( n_double * )memory_new( sizeof( n_double ) * ( n_uint )max );
+    segments->end_y = ( n_double * )memory_new( sizeof( n_double ) * ( n_uint )max );
+    segments->count = 0;
+    segments->max = max;
+
+    if ( ( segments->start_x == 0L ) || ( segments->start_y == 0L ) || ( segments->end_x == 0L ) || ( segments->end_y == 0L ) )
+    {
+        math_segments_free( &segments );
+    }
+    return segments;
+}
+
+static n_double *math_segments_grow( n_double *values, n_int count, n_int max )
+{
+    n_double *new_values = ( n_double * )memory_new( sizeof( n_double ) * ( n_uint )max );
+    if ( new_values == 0L )
+    {
+        return 0L;
+    }
+    memory_copy( ( n_byte * )values, ( n_byte * )new_values, sizeof( n_double ) * ( n_uint )count );
+    return new_values;
+}
+
+/**
+ Adds a segment to the end of the segment list, the list grows as needed. If the list can't
+ grow the segment isn't added and the list is unchanged.
+ @param segments The segment list.
+ @param start The start of the segment.
+ @param end The end of the segment.
+ */
+void math_segments_add( n_segments *segments, n_vect2 *start, n_vect2 *end )
+{
+    if ( segments->count == segments->max )
+    {
+        n_int new_max = segments->max * 2;
+        n_double *start_x = math_segments_grow( segments->start_x, segments->count, new_max );
+        n_double *start_y = math_segments_grow( segments->start_y, segments->count, new_max );
+        n_double *end_x = math_segments_grow( segments->end_x, segments->count, new_max );
+        n_double *end_y = math_segments_grow( segments->end_y, segments->count, new_max );
+
+        if ( ( start_x == 0L ) || ( start_y == 0L ) || ( end_x == 0L ) || ( end_y == 0L ) )
+        {
+            memory_free( ( void ** )&start_x );
+            memory_free( ( void ** )&start_y );
+            memory_free( ( void ** )&end_x );
+            memory_free( ( void ** )&end_y );
+            ( void )SHOW_ERROR( "Segments failed to allocate" );
+            return;
+        }
+        memory_free( ( void ** )&segments->start_x );
+        memory_free( ( void ** )&segments->start_y );
+        memory_free( ( void ** )&segments->end_x );
+        memory_free( ( void ** )&segments->end_y );
+        segments->start_x = start_x;
+        segments->start_y = start_y;
+        segments->end_x = end_x;
+        segments->end_y = end_y;
+        segments->max = new_max;
+    }
+    segments->start_x[segments->count] = ( n_double )start->x;
+    segments->start_y[segments->count] = ( n_double )start->y;
+    segments->end_x[segments->count] = ( n_double )end->x;
+    segments->end_y[segments->count] = ( n_double )end->y;
+    segments->count++;
+}
+
+void math_segments_free( n_segments **segments )
+{
+    if ( *segments == 0L )
+    {
+        return;
+    }
+    memory_free( ( void ** ) & ( ( *segments )->start_x ) );
+    memory_free( ( void ** ) & ( ( *segments )->start_y ) );
+    memory_free( ( void ** ) & ( ( *segments )->end_x ) );
+    memory_free( ( void ** ) & ( ( *segments )->end_y ) );
+    memory_free( ( void ** )segments );
+}
+
+/* The query segment p1q1 with the values shared by every test against it */
+typedef struct
+{
+    n_double px, py, qx, qy;
+    n_double dx, dy;
+    n_double min_x, max_x, min_y, max_y;
+} math_segments_query;
+
+typedef n_int ( math_segments_kernel )( n_segments *segments, math_segments_query *query, n_int from );
+
+/* The same tests as math_do_intersect, written without branches so each lane of the vector
+   versions does exactly this */
+static n_int math_segments_scalar( n_segments *segments, math_segments_query *query, n_int from )
+{
+    n_int loop = from;
+    while ( loop < segments->count )
+    {
+        n_double ax = segments->start_x[loop];
+        n_double ay = segments->start_y[loop];
+        n_double cx = segments->end_x[loop];
+        n_double cy = segments->end_y[loop];
+        n_double wx = cx - ax;
+        n_double wy = cy - ay;
+
+        n_double o1 = ( query->dy * ( ax - query->qx ) ) - ( query->dx * ( ay - query->qy ) );
+        n_double o2 = ( query->dy * ( cx - query->qx ) ) - ( query->dx * ( cy - query->qy ) );
+        n_double o3 = ( wy * ( query->px - cx ) ) - ( wx * ( query->py - cy ) );
+        n_double o4 = ( wy * ( query->qx - cx ) ) - ( wx * ( query->qy - cy ) );
+
+        n_int general = ( ( ( o1 > 0 ) != ( o2 > 0 ) ) || ( ( o1 < 0 ) != ( o2 < 0 ) ) ) &&
+                        ( ( ( o3 > 0 ) != ( o4 > 0 ) ) || ( ( o3 < 0 ) != ( o4 < 0 ) ) );
+
+        n_int special1 = ( o1 == 0 ) && ( ax >= query->min_x ) && ( ax <= query->max_x ) && ( ay >= query->min_y ) && ( ay <= query->max_y );
+        n_int special2 = ( o2 == 0 ) && ( cx >= query->min_x ) && ( cx <= query->max_x ) && ( cy >= query->min_y ) && ( cy <= query->max_y );
+        n_int special3 = ( o3 == 0 ) && ( query->px >= ( ( ax < cx ) ? ax : cx ) ) && ( query->px <= ( ( ax < cx ) ? cx : ax ) ) &&
+                         ( query->py >= ( ( ay < cy ) ? ay : cy ) ) && ( query->py <= ( ( ay < cy ) ? cy : ay ) );
+        n_int special4 = ( o4 == 0 ) && ( query->qx >= ( ( ax < cx ) ? ax : cx ) ) && ( query->qx <= ( ( ax < cx ) ? cx : ax ) ) &&
+                         ( query->qy >= ( ( ay < cy ) ? ay : cy ) ) && ( query->qy <= ( ( ay < cy ) ? cy : ay ) );
+
+        if ( general || special1 || special2 || special3 || special4 )
+        {
+            return loop;
+        }
+        loop++;
+    }
+    return -1;
+}
+
+#ifdef MATH_SEGMENTS_SSE2
+
+static n_int math_segments_sse2( n_segments *segments, math_segments_query *query, n_int from )
+{
+    __m128d px = _mm_set1_pd( query->px ), py = _mm_set1_pd( query->py );
+    __m128d qx = _mm_set1_pd( query->qx ), qy = _mm_set1_pd( query->qy );
+    __m128d dx = _mm_set1_pd( query->dx ), dy = _mm_set1_pd( query->dy );
+    __m128d min_x = _mm_set1_pd( query->min_x ), max_x = _mm_set1_pd( query->max_x );
+    __m128d min_y = _mm_set1_pd( query->min_y ), max_y = _mm_set1_pd( query->max_y );
+    __m128d zero = _mm_setzero_pd();
+    n_int loop = from;
+
+    while ( ( loop + 2 ) <= segments->count )
+    {
+        __m128d ax = _mm_loadu_pd( &segments->start_x[loop] );
+        __m128d ay = _mm_loadu_pd( &segments->start_y[loop] );
+        __m128d cx = _mm_loadu_pd( &segments->end_x[loop] );
+        __m128d cy = _mm_loadu_pd( &segments->end_y[loop] );
+        __m128d wx = _mm_sub_pd( cx, ax );
+        __m128d wy = _mm_sub_pd( cy, ay );
+        __m128d wmin_x = _mm_min_pd( ax, cx ), wmax_x = _mm_max_pd( ax, cx );
+        __m128d wmin_y = _mm_min_pd( ay, cy ), wmax_y = _mm_max_pd( ay, cy );
+
+        __m128d o1 = _mm_sub_pd( _mm_mul_pd( dy, _mm_sub_pd( ax, qx ) ), _mm_mul_pd( dx, _mm_sub_pd( ay, qy ) ) );
+        __m128d o2 = _mm_sub_pd( _mm_mul_pd( dy, _mm_sub_pd( cx, qx ) ), _mm_mul_pd( dx, _mm_sub_pd( cy, qy ) ) );
+        __m128d o3 = _mm_sub_pd( _mm_mul_pd( wy, _mm_sub_pd( px, cx ) ), _mm_mul_pd( wx, _mm_sub_pd( py, cy ) ) );
+        __m128d o4 = _mm_sub_pd( _mm_mul_pd( wy, _mm_sub_pd( qx, cx ) ), _mm_mul_pd( wx, _mm_sub_pd( qy, cy ) ) );
+
+        __m128d general = _mm_and_pd(
+                              _mm_or_pd( _mm_xor_pd( _mm_cmpgt_pd( o1, zero ), _mm_cmpgt_pd( o2, zero ) ),
+                                         _mm_xor_pd( _mm_cmplt_pd( o1, zero ), _mm_cmplt_pd( o2, zero ) ) ),
+                              _mm_or_pd( _mm_xor_pd( _mm_cmpgt_pd( o3, zero ), _mm_cmpgt_pd( o4, zero ) ),
+                                         _mm_xor_pd( _mm_cmplt_pd( o3, zero ), _mm_cmplt_pd( o4, zero ) ) ) );
+
+        __m128d special1 = _mm_and_pd( _mm_and_pd( _mm_cmpeq_pd( o1, zero ),
+                                                   _mm_and_pd( _mm_cmpge_pd( ax, min_x ), _mm_cmple_pd( ax, max_x ) ) ),
+                                       _mm_and_pd( _mm_cmpge_pd( ay, min_y ), _mm_cmple_pd( ay, max_y ) ) );
+        __m128d special2 = _mm_and_pd( _mm_and_pd( _mm_cmpeq_pd( o2, zero ),
+                                                   _mm_and_pd( _mm_cmpge_pd( cx, min_x ), _mm_cmple_pd( cx, max_x ) ) ),
+                                       _mm_and_pd( _mm_cmpge_pd( cy, min_y ), _mm_cmple_pd( cy, max_y ) ) );
+        __m128d special3 = _mm_and_pd( _mm_and_pd( _mm_cmpeq_pd( o3, zero ),
+                                                   _mm_and_pd( _mm_cmpge_pd( px, wmin_x ), _mm_cmple_pd( px, wmax_x ) ) ),
+                                       _mm_and_pd( _mm_cmpge_pd( py, wmin_y ), _mm_cmple_pd( py, wmax_y ) ) );
+        __m128d special4 = _mm_and_pd( _mm_and_pd( _mm_cmpeq_pd( o4, zero ),
+                                                   _mm_and_pd( _mm_cmpge_pd( qx, wmin_x ), _mm_cmple_pd( qx, wmax_x ) ) ),
+                                       _mm_and_pd( _mm_cmpge_pd( qy, wmin_y ), _mm_cmple_pd( qy, wmax_y ) ) );
+
+        int mask = _mm_movemask_pd( _mm_or_pd( _mm_or_pd( general, special1 ),
+                                               _mm_or_pd( _mm_or_pd( special2, special3 ), special4 ) ) );
+        if ( mask )
+        {
+            return loop + ( ( mask & 1 ) ? 0 : 1 );
+        }
+        loop += 2;
+    }
+    return math_segments_scalar( segments, query, loop );
+}
+
+#endif
+
+#ifdef MATH_SEGMENTS_AVX2
+
+__attribute__( ( target( "avx2" ) ) )
+static n_int math_segments_avx2( n_segments *segments, math_segments_query *query, n_int from )
+{
+    __m256d px = _mm256_set1_pd( query->px ), py = _mm256_set1_pd( query->py );
+    __m256d qx = _mm256_set1_pd( query->qx ), qy = _mm256_set1_pd( query->qy );
+    __m256d dx = _mm256_set1_pd( query->dx ), dy = _mm256_set1_pd( query->dy );
+    __m256d min_x = _mm256_set1_pd( query->min_x ), max_x = _mm256_set1_pd( query->max_x );
+    __m256d min_y = _mm256_set1_pd( query->min_y ), max_y = _mm256_set1_pd( query->max_y );
+    __m256d zero = _mm256_setzero_pd();
+    n_int loop = from;
+
+    while ( ( loop + 4 ) <= segments->count )
+    {
+        __m256d ax = _mm256_loadu_pd( &segments->start_x[loop] );
+        __m256d ay = _mm256_loadu_pd( &segments->start_y[loop] );
+        __m256d cx = _mm256_loadu_pd( &segments->end_x[loop] );
+        __m256d cy = _mm256_loadu_pd( &segments->end_y[loop] );
+        __m256d wx = _mm256_sub_pd( cx, ax );
+        __m256d wy = _mm256_sub_pd( cy, ay );
+        __m256d wmin_x = _mm256_min_pd( ax, cx ), wmax_x = _mm256_max_pd( ax, cx );
+        __m256d wmin_y = _mm256_min_pd( ay, cy ), wmax_y = _mm256_max_pd( ay, cy );
+
+        __m256d o1 = _mm256_sub_pd( _mm256_mul_pd( dy, _mm256_sub_pd( ax, qx ) ), _mm256_mul_pd( dx, _mm256_sub_pd( ay, qy ) ) );
+        __m256d o2 = _mm256_sub_pd( _mm256_mul_pd( dy, _mm256_sub_pd( cx, qx ) ), _mm256_mul_pd( dx, _mm256_sub_pd( cy, qy ) ) );
+        __m256d o3 = _mm256_sub_pd( _mm256_mul_pd( wy, _mm256_sub_pd( px, cx ) ), _mm256_mul_pd( wx, _mm256_sub_pd( py, cy ) ) );
+        __m256d o4 = _mm256_sub_pd( _mm256_mul_pd( wy, _mm256_sub_pd( qx, cx ) ), _mm256_mul_pd( wx, _mm256_sub_pd( qy, cy ) ) );
+
+        __m256d general = _mm256_and_pd(
+                              _mm256_or_pd( _mm256_xor_pd( _mm256_cmp_pd( o1, zero, _CMP_GT_OQ ), _mm256_cmp_pd( o2, zero, _CMP_GT_OQ ) ),
+                                            _mm256_xor_pd( _mm256_cmp_pd( o1, zero, _CMP_LT_OQ ), _mm256_cmp_pd( o2, zero, _CMP_LT_OQ ) ) ),
+                              _mm256_or_pd( _mm256_xor_pd( _mm256_cmp_pd( o3, zero, _CMP_GT_OQ ), _mm256_cmp_pd( o4, zero, _CMP_GT_OQ ) ),
+                                            _mm256_xor_pd( _mm256_cmp_pd( o3, zero, _CMP_LT_OQ ), _mm256_cmp_pd( o4, zero, _CMP_LT_OQ ) ) ) );
+
+        __m256d special1 = _mm256_and_pd( _mm256_and_pd( _mm256_cmp_pd( o1, zero, _CMP_EQ_OQ ),
+                                                         _mm256_and_pd( _mm256_cmp_pd( ax, min_x, _CMP_GE_OQ ), _mm256_cmp_pd( ax, max_x, _CMP_LE_OQ ) ) ),
+                                          _mm256_and_pd( _mm256_cmp_pd( ay, min_y, _CMP_GE_OQ ), _mm256_cmp_pd( ay, max_y, _CMP_LE_OQ ) ) );
+        __m256d special2 = _mm256_and_pd( _mm256_and_pd( _mm256_cmp_pd( o2, zero, _CMP_EQ_OQ ),
+                                                         _mm256_and_pd( _mm256_cmp_pd( cx, min_x, _CMP_GE_OQ ), _mm256_cmp_pd( cx, max_x, _CMP_LE_OQ ) ) ),
+                                          _mm256_and_pd( _mm256_cmp_pd( cy, min_y, _CMP_GE_OQ ), _mm256_cmp_pd( cy, max_y, _CMP_LE_OQ ) ) );
+        __m256d special3 = _mm256_and_pd( _mm256_and_pd( _mm256_cmp_pd( o3, zero, _CMP_EQ_OQ ),
+                                                         _mm256_and_pd( _mm256_cmp_pd( px, wmin_x, _CMP_GE_OQ ), _mm256_cmp_pd( px, wmax_x, _CMP_LE_OQ ) ) ),
+                                          _mm256_and_pd( _mm256_cmp_pd( py, wmin_y, _CMP_GE_OQ ), _mm256_cmp_pd( py, wmax_y, _CMP_LE_OQ ) ) );
+        __m256d special4 = _mm256_and_pd( _mm256_and_pd( _mm256_cmp_pd( o4, zero, _CMP_EQ_OQ ),
+                                                         _mm256_and_pd( _mm256_cmp_pd( qx, wmin_x, _CMP_GE_OQ ), _mm256_cmp_pd( qx, wmax_x, _CMP_LE_OQ ) ) ),
+                                          _mm256_and_pd( _mm256_cmp_pd( qy, wmin_y, _CMP_GE_OQ ), _mm256_cmp_pd( qy, wmax_y, _CMP_LE_OQ ) ) );
+
+        int mask = _mm256_movemask_pd( _mm256_or_pd( _mm256_or_pd( general, special1 ),
+                                                     _mm256_or_pd( _mm256_or_pd( special2, special3 ), special4 ) ) );
+        if ( mask )
+        {
+            return loop + __builtin_ctz( ( unsigned int )mask );
+        }
+        loop += 4;
+    }
+    return math_segments_scalar( segments, query, loop );
+}
+
+#endif
+
+static math_segments_kernel *math_segments_dispatch = 0L;
+
+static math_segments_kernel *math_segments_select( void )
+{
+#ifdef MATH_SEGMENTS_AVX2
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return math_segments_avx2;
+    }
+#endif
+#ifdef MATH_SEGMENTS_SSE2
+    return math_segments_sse2;
+#else
+    return math_segments_scalar;
+#endif
+}
+
+static void math_segments_default( void )
+{
+    if ( math_segments_dispatch == 0L )
+    {
+        math_segments_dispatch = math_segments_select();
+    }
+}
+
+/**
+ Chooses the kernel math_segments_intersect tests with, so each kernel can be checked against
+ the others on the same segments.
+ @param kernel The kernel, SEGMENTS_BEST returns to the best available.
+ @return 1 if the kernel is used from now on, 0 if it isn't available here.
+ */
+n_byte math_segments_use( n_segments_kernel kernel )
+{
+    switch ( kernel )
+    {
+    case SEGMENTS_BEST:
+        math_segments_dispatch = math_segments_select();
+        return 1;
+    case SEGMENTS_SCALAR:
+        math_segments_dispatch = math_segments_scalar;
+        return 1;
+#ifdef MATH_SEGMENTS_SSE2
+    case SEGMENTS_SSE2:
+        math_segments_dispatch = math_segments_sse2;
+        return 1;
+#endif
+#ifdef MATH_SEGMENTS_AVX2
+    case SEGMENTS_AVX2:
+        if ( __builtin_cpu_supports( "avx2" ) )
+        {
+            math_segments_dispatch = math_segments_avx2;
+            return 1;
+        }
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ Tests the segment p1q1 against every segment in the list with the widest vector unit available.
+ The result matches calling math_do_intersect on each segment in turn.
+ @param segments The segment list.
+ @param p1 The start of the tested segment.
+ @param q1 The end of the tested segment.
+ @return The index of the first intersecting segment or -1 if none intersect.
+ */
+n_int math_segments_intersect( n_segments *segments, n_vect2 *p1, n_vect2 *q1 )
+{
+    math_segments_query query;
+
+    query.px = ( n_double )p1->x;
+    query.py = ( n_double )p1->y;
+    query.qx = ( n_double )q1->x;
+    query.qy = ( n_double )q1->y;
+    query.dx = query.qx - query.px;
+    query.dy = query.qy - query.py;
+    query.min_x = ( query.px < query.qx ) ? query.px : query.qx;
+    query.max_x = ( query.px < query.qx ) ? query.qx : query.px;
+    query.min_y = ( query.py < query.qy ) ? query.py : query.qy;
+    query.max_y = ( query.py < query.qy ) ? query.qy : query.py;
+
+    return math_segments_dispatch( segments, &query, 0 );
+}
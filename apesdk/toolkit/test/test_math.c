@@ -120,6 +120,115 @@ void check_intersection( void )
     printf( "Intersections passed fine!\n" );
 }
 
+/* every kernel available here is run on the same segments and queries, and each has to give the
+   first segment math_do_intersect finds */
+
+n_int check_segments_kernels( n_segments *segments, n_byte2 *local, n_int mask )
+{
+    n_segments_kernel kernels[3] = {SEGMENTS_SCALAR, SEGMENTS_SSE2, SEGMENTS_AVX2};
+    n_vect2           start, end, p1, q1;
+    n_int             loop = 0;
+
+    while ( loop < 10000 )
+    {
+        n_int expected = -1;
+        n_int each = 0;
+        p1.x = ( math_random( local ) & mask ) - ( mask / 2 );
+        p1.y = ( math_random( local ) & mask ) - ( mask / 2 );
+        q1.x = ( math_random( local ) & mask ) - ( mask / 2 );
+        q1.y = ( math_random( local ) & mask ) - ( mask / 2 );
+
+        while ( each < segments->count )
+        {
+            start.x = ( n_int )segments->start_x[each];
+            start.y = ( n_int )segments->start_y[each];
+            end.x = ( n_int )segments->end_x[each];
+            end.y = ( n_int )segments->end_y[each];
+            if ( math_do_intersect( &p1, &q1, &start, &end ) )
+            {
+                expected = each;
+                break;
+            }
+            each++;
+        }
+
+        each = 0;
+        while ( each < 3 )
+        {
+            if ( math_segments_use( kernels[each] ) )
+            {
+                n_int result = math_segments_intersect( segments, &p1, &q1 );
+                if ( result != expected )
+                {
+                    printf( "segments kernel %d intersection expecting %ld instead %ld\n", kernels[each], expected, result );
+                    ( void )math_segments_use( SEGMENTS_BEST );
+                    return -1;
+                }
+            }
+            each++;
+        }
+        loop++;
+    }
+    ( void )math_segments_use( SEGMENTS_BEST );
+    return 0;
+}
+
+n_int check_segments_list( n_int number, n_int mask )
+{
+    n_vect2     start, end;
+    n_segments *segments = math_segments_new( 4 );
+    n_byte2     local[2] = {0x1234, 0x8765};
+    n_int       loop = 0;
+    n_int       result;
+
+    if ( segments == 0L )
+    {
+        printf( "segments not allocated\n" );
+        return -1;
+    }
+
+    while ( loop < number )
+    {
+        start.x = ( math_random( local ) & mask ) - ( mask / 2 );
+        start.y = ( math_random( local ) & mask ) - ( mask / 2 );
+        end.x = ( math_random( local ) & mask ) - ( mask / 2 );
+        end.y = ( math_random( local ) & mask ) - ( mask / 2 );
+        math_segments_add( segments, &start, &end );
+        loop++;
+    }
+
+    if ( segments->count != number )
+    {
+        printf( "segments expecting %ld instead %ld\n", number, segments->count );
+        math_segments_free( &segments );
+        return -1;
+    }
+
+    result = check_segments_kernels( segments, local, mask );
+    math_segments_free( &segments );
+    return result;
+}
+
+void check_segments( void )
+{
+    printf( "Segments kernels scalar%s%s\n", math_segments_use( SEGMENTS_SSE2 ) ? ", sse2" : "",
+            math_segments_use( SEGMENTS_AVX2 ) ? ", avx2" : "" );
+    ( void )math_segments_use( SEGMENTS_BEST );
+
+    /* enough segments to grow the list and cover the vector and scalar remainders, a small
+       range for the colinear and touching cases and a wide range so later segments are hit */
+
+    if ( check_segments_list( 11, 15 ) != 0 )
+    {
+        return;
+    }
+    if ( check_segments_list( 37, 255 ) != 0 )
+    {
+        return;
+    }
+    printf( "Segments passed fine!\n" );
+}
+
 n_byte test_line( n_int px, n_int py, n_int dx, n_int dy, void *information )
 {
     return 0;
@@ -166,6 +275,7 @@ void check_math( void )
     ( void )check_root( 3, 15 );
     ( void )check_root( 3, 14 );
     check_intersection();
+    check_segments();
 
     while ( loop < 256 )
     {
@@ -215,6 +215,32 @@ typedef struct
     n_int max_points;
 } n_points;
 
+/*! @struct
+ @discussion Line segments stored structure-of-arrays so many can be tested against a single
+ segment at once. The coordinates are exact while their magnitude is below 2^25.
+ */
+typedef struct
+{
+    n_double *start_x;
+    n_double *start_y;
+    n_double *end_x;
+    n_double *end_y;
+    n_int     count;
+    n_int     max;
+} n_segments;
+
+/*! @enum
+ @discussion The kernels math_segments_intersect can test with, the best available is used unless
+ another is chosen with math_segments_use.
+ */
+typedef enum
+{
+    SEGMENTS_BEST = 0,
+    SEGMENTS_SCALAR,
+    SEGMENTS_SSE2,
+    SEGMENTS_AVX2
+} n_segments_kernel;
+
 typedef struct
 {
     n_byte4  date;
@@ -494,6 +520,8 @@ typedef n_int ( execute_function )( void *general_data, void *read_data, void *w
 typedef void ( execute_thread_stub )( execute_function function, void *general_data, void *read_data, void *write_data );
 
 void  execute_group( execute_function *function, void *general_data, void *read_data, n_int count, n_int size );
+void  execute_threads( n_int threads );
+void  execute_close( void );
 
 void area2_add( n_area2 *area, n_vect2 *vect, n_byte first );
 
@@ -610,6 +638,12 @@ n_int  math_seg14( n_int character );
 
 n_byte math_do_intersect( n_vect2 *p1, n_vect2 *q1, n_vect2 *p2, n_vect2 *q2 );
 
+n_segments *math_segments_new( n_int max );
+void        math_segments_add( n_segments *segments, n_vect2 *start, n_vect2 *end );
+void        math_segments_free( n_segments **segments );
+n_int       math_segments_intersect( n_segments *segments, n_vect2 *p1, n_vect2 *q1 );
+n_byte      math_segments_use( n_segments_kernel kernel );
+
 void       io_number_to_string( n_string value, n_uint number );
 void       io_string_number( n_string output_string, n_string input_string, n_uint number );
 void       io_three_strings( n_string output_string, n_string first_string, n_string second_string, n_string third_string, n_byte new_line );
@@ -36,8 +36,32 @@
 #include "mushroom.h"
 #include "toolkit.h"
 
+#include <stdlib.h>
+
+// How close movement comes to a wall and how many walls it slides along in a step
+#define MATRIX_MOVE_MARGIN   (4)
+#define MATRIX_MOVE_SLIDES   (2)
+
+// Uniform grid over the blocking walls, cells are hashed into buckets that double as the walls grow
+#define MATRIX_INDEX_CELL    (512)
+#define MATRIX_INDEX_BUCKETS (4096) // the starting number of buckets
+#define MATRIX_INDEX_LOAD    (16)   // walls per bucket before the buckets double
+
+// Windows block movement but not sight, so there is a grid for each
+#define MATRIX_SIGHT         (0)
+#define MATRIX_MOVE          (1)
+#define MATRIX_GRIDS         (2)
+
 // Global variables
 static memory_list *block_list;
+static memory_list *block_type;
+static memory_list *opening_list;
+static memory_list *opening_type;
+static n_int *opening_table; // open addressing over the openings, each slot is the opening plus one
+static n_int opening_table_size;
+static int_list **block_index[MATRIX_GRIDS];      // each bucket is allocated when a wall first lands in it
+static n_segments **block_segments[MATRIX_GRIDS];
+static n_int block_buckets = 0;
 static memory_list *draw_identifier_list;
 static n_int hit_block = 0;
 static n_int matrix_timer = 0;
@@ -80,7 +104,7 @@ n_int agent_zooming(void) {
 
 // Move the agent forward or backward
 void agent_move(n_int distance) {
-    n_vect2 direction, local_location;
+    n_vect2 direction, local_location, step;
     n_vect2* current_location = agent_location();
     n_int translated_facing;
 
@@ -94,9 +118,16 @@ void agent_move(n_int distance) {
     translated_facing = (128 + 64 + 256 - agent_facing()) & 255;
     vect2_direction(&direction, translated_facing, 1);
 
-    // Move the agent and update the location delta
+    // Move the agent around the walls and update the location delta
     vect2_d(current_location, &direction, distance, 26880 / 20);
+    vect2_subtract(&step, current_location, &local_location);
+    vect2_copy(current_location, &local_location);
+    matrix_move(current_location, &step);
     vect2_subtract(&mushroom_boy.location_delta, current_location, &local_location);
+
+    if (mushroom_boy.location_delta.x || mushroom_boy.location_delta.y) {
+        visibility_invalidate();
+    }
 }
 
 // Reset the agent's state for the next cycle
@@ -117,9 +148,14 @@ memory_list *matrix_draw_block(void) {
     return block_list;
 }
 
+// The matrix_type of each plane in matrix_draw_block
+memory_list *matrix_draw_type(void) {
+    return block_type;
+}
+
 void matrix_draw_identifier_clear(void) {
     matrix_timer++;
-    if (matrix_timer == 6) {
+    if ((matrix_timer == 6) && draw_identifier_list) {
         draw_identifier_list->count = 0;
         matrix_timer = 0;
     }
@@ -136,18 +172,361 @@ void matrix_draw_add(n_vect2 *start, n_vect2 *end) {
     memory_list_copy(draw_identifier_list, (n_byte *)&draw_identifier, sizeof(draw_identifier));
 }
 
+// Floor division so negative locations land in the correct cell
+static n_int matrix_index_cell(n_int value) {
+    if (value < 0) {
+        return ((value + 1) / MATRIX_INDEX_CELL) - 1;
+    }
+    return value / MATRIX_INDEX_CELL;
+}
+
+static n_int matrix_index_bucket(n_int cell_x, n_int cell_y) {
+    n_uint hash = ((n_uint)cell_x * 73856093) ^ ((n_uint)cell_y * 19349663);
+    return (n_int)(hash & (n_uint)(block_buckets - 1));
+}
+
+// Returns 1 to stop the walk through the cells
+typedef n_byte (matrix_index_cell_function)(n_int bucket, void *context);
+
+// Visits every cell the segment passes through, one column of cells at a time. Each column spans up
+// to the first unit of the next column and the y extent is widened by a unit to cover the integer
+// rounding, so a wall and a query that intersect always share at least one visited cell.
+static n_byte matrix_index_segment(n_vect2 *start, n_vect2 *end, matrix_index_cell_function *function,
+                                   void *context) {
+    n_int dx = end->x - start->x;
+    n_int dy = end->y - start->y;
+    n_int min_x = (dx < 0) ? end->x : start->x;
+    n_int max_x = (dx < 0) ? start->x : end->x;
+    n_int cell_x = matrix_index_cell(min_x);
+    n_int cell_end_x = matrix_index_cell(max_x);
+
+    while (cell_x <= cell_end_x) {
+        n_int left = cell_x * MATRIX_INDEX_CELL;
+        n_int right = left + MATRIX_INDEX_CELL;
+        n_int y0, y1, cell_y, cell_end_y;
+
+        if (left < min_x) left = min_x;
+        if (right > max_x) right = max_x;
+
+        if (dx == 0) {
+            y0 = start->y;
+            y1 = end->y;
+        } else {
+            y0 = start->y + (((left - start->x) * dy) / dx);
+            y1 = start->y + (((right - start->x) * dy) / dx);
+        }
+        if (y0 > y1) {
+            n_int temp = y0;
+            y0 = y1;
+            y1 = temp;
+        }
+        cell_y = matrix_index_cell(y0 - 1);
+        cell_end_y = matrix_index_cell(y1 + 1);
+
+        while (cell_y <= cell_end_y) {
+            if (function(matrix_index_bucket(cell_x, cell_y), context)) {
+                return 1;
+            }
+            cell_y++;
+        }
+        cell_x++;
+    }
+    return 0;
+}
+
+typedef struct {
+    n_int index;
+    n_int grid;
+} matrix_index_entry;
+
+// Each bucket keeps the wall indices and a structure-of-arrays copy of the walls in the same order
+static n_byte matrix_index_add(n_int bucket, void *context) {
+    matrix_plane *recorded_walls = (matrix_plane *)block_list->data;
+    matrix_index_entry *entry = (matrix_index_entry *)context;
+    int_list *entries = block_index[entry->grid][bucket];
+    if (entries == 0L) {
+        entries = block_index[entry->grid][bucket] = int_list_new(16);
+        block_segments[entry->grid][bucket] = math_segments_new(16);
+    }
+    // walls are added to neighbouring cells one after another, avoid repeating them in a shared bucket
+    if ((entries->count == 0) || (((n_int *)entries->data)[entries->count - 1] != entry->index)) {
+        int_list_copy(entries, entry->index);
+        math_segments_add(block_segments[entry->grid][bucket], &recorded_walls[entry->index].start, &recorded_walls[entry->index].end);
+    }
+    return 0;
+}
+
+static n_byte matrix_index_hit(n_int bucket, void *context) {
+    matrix_plane *sight = (matrix_plane *)context;
+    n_int found;
+
+    if (block_segments[MATRIX_SIGHT][bucket] == 0L) {
+        return 0;
+    }
+    found = math_segments_intersect(block_segments[MATRIX_SIGHT][bucket], &sight->start, &sight->end);
+    if (found != -1) {
+        matrix_plane *recorded_walls = (matrix_plane *)block_list->data;
+        matrix_plane *wall = &recorded_walls[((n_int *)block_index[MATRIX_SIGHT][bucket]->data)[found]];
+        matrix_draw_add(&wall->start, &wall->end);
+        return 1;
+    }
+    return 0;
+}
+
+static n_byte matrix_index_blocked(n_int bucket, void *context) {
+    matrix_plane *sight = (matrix_plane *)context;
+    if (block_segments[MATRIX_SIGHT][bucket] == 0L) {
+        return 0;
+    }
+    return (math_segments_intersect(block_segments[MATRIX_SIGHT][bucket], &sight->start, &sight->end) != -1);
+}
+
+// Whether the same plane of the same type is already recorded, in either direction
+static n_byte matrix_block_present(matrix_plane *plane, n_byte type) {
+    matrix_plane *recorded_walls = (matrix_plane *)block_list->data;
+    int_list *entries = block_index[MATRIX_MOVE][matrix_index_bucket(matrix_index_cell(plane->start.x), matrix_index_cell(plane->start.y))];
+    n_int loop = 0;
+
+    if (entries == 0L) {
+        return 0;
+    }
+    while (loop < (n_int)entries->count) {
+        n_int index = ((n_int *)entries->data)[loop++];
+        matrix_plane *wall = &recorded_walls[index];
+        if (block_type->data[index] != type) {
+            continue;
+        }
+        if ((vect2_distance_under(&wall->start, &plane->start, 1) && vect2_distance_under(&wall->end, &plane->end, 1)) ||
+            (vect2_distance_under(&wall->start, &plane->end, 1) && vect2_distance_under(&wall->end, &plane->start, 1))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Puts the recorded wall into the buckets of the cells it passes through
+static void matrix_index_wall(n_int index) {
+    matrix_plane *plane = &((matrix_plane *)block_list->data)[index];
+    matrix_index_entry entry;
+
+    entry.index = index;
+    entry.grid = MATRIX_MOVE;
+    matrix_index_segment(&plane->start, &plane->end, matrix_index_add, &entry);
+    if (block_type->data[index] != MT_WINDOW) {
+        entry.grid = MATRIX_SIGHT;
+        matrix_index_segment(&plane->start, &plane->end, matrix_index_add, &entry);
+    }
+}
+
+static void matrix_index_free(void) {
+    n_int grid = 0;
+    while (grid < MATRIX_GRIDS) {
+        n_int loop = 0;
+        while (block_index[grid] && (loop < block_buckets)) {
+            if (block_index[grid][loop]) {
+                int_list_free(&block_index[grid][loop]);
+                math_segments_free(&block_segments[grid][loop]);
+            }
+            loop++;
+        }
+        memory_free((void **)&block_index[grid]);
+        memory_free((void **)&block_segments[grid]);
+        grid++;
+    }
+    block_buckets = 0;
+}
+
+// Sizes the buckets for the number of walls, doubling them and putting the walls back in when there are
+// more than the load of walls per bucket, so the walls in a bucket stay close to the walls in a cell
+static n_int matrix_index_size(n_uint walls) {
+    n_int buckets = block_buckets ? block_buckets : MATRIX_INDEX_BUCKETS;
+    n_int grid = 0;
+    n_int loop = 0;
+
+    while ((walls / MATRIX_INDEX_LOAD) > (n_uint)buckets) {
+        buckets *= 2;
+    }
+    if (buckets == block_buckets) {
+        return 0;
+    }
+    matrix_index_free();
+    while (grid < MATRIX_GRIDS) {
+        block_index[grid] = (int_list **)memory_new(sizeof(int_list *) * (n_uint)buckets);
+        block_segments[grid] = (n_segments **)memory_new(sizeof(n_segments *) * (n_uint)buckets);
+        if ((block_index[grid] == 0L) || (block_segments[grid] == 0L)) {
+            memory_free((void **)&block_index[grid]);
+            memory_free((void **)&block_segments[grid]);
+            matrix_index_free();
+            return SHOW_ERROR("Matrix buckets not allocated");
+        }
+        memory_erase((n_byte *)block_index[grid], sizeof(int_list *) * (n_uint)buckets);
+        memory_erase((n_byte *)block_segments[grid], sizeof(n_segments *) * (n_uint)buckets);
+        grid++;
+    }
+    block_buckets = buckets;
+    while (loop < (n_int)block_list->count) {
+        matrix_index_wall(loop++);
+    }
+    return 0;
+}
+
+static void matrix_block_add(matrix_plane *plane, n_byte type) {
+    if (block_list == 0L) {
+        matrix_init();
+    }
+    if ((block_buckets == 0) || matrix_block_present(plane, type)) {
+        return;
+    }
+
+    memory_list_copy(block_list, (n_byte *)plane, sizeof(matrix_plane));
+    memory_list_copy(block_type, &type, sizeof(type));
+    visibility_invalidate();
+
+    if (matrix_index_size(block_list->count) != 0) {
+        return;
+    }
+    matrix_index_wall((n_int)block_list->count - 1);
+}
+
+static n_int matrix_opening_slot(n_vect2 *start, n_vect2 *end, n_byte type) {
+    n_uint hash = ((n_uint)start->x * 73856093) ^ ((n_uint)start->y * 19349663) ^
+                  ((n_uint)end->x * 83492791) ^ ((n_uint)end->y * 50331653) ^ (n_uint)type;
+    return (n_int)(hash & (n_uint)(opening_table_size - 1));
+}
+
+// The slot of the matching opening, or the empty slot where it goes
+static n_int matrix_opening_find(n_vect2 *start, n_vect2 *end, n_byte type) {
+    matrix_plane *recorded_openings = (matrix_plane *)opening_list->data;
+    n_int slot = matrix_opening_slot(start, end, type);
+    while (opening_table[slot]) {
+        n_int index = opening_table[slot] - 1;
+        if ((opening_type->data[index] == type) &&
+            (recorded_openings[index].start.x == start->x) && (recorded_openings[index].start.y == start->y) &&
+            (recorded_openings[index].end.x == end->x) && (recorded_openings[index].end.y == end->y)) {
+            return slot;
+        }
+        slot = (slot + 1) & (opening_table_size - 1);
+    }
+    return slot;
+}
+
+// Doubles the table when it is half full and puts the openings back in
+static n_int matrix_opening_table(void) {
+    matrix_plane *recorded_openings = (matrix_plane *)opening_list->data;
+    n_int size = opening_table_size ? (opening_table_size * 2) : 8192;
+    n_int loop = 0;
+
+    if (((n_int)(opening_list->count + 1) * 2) <= opening_table_size) {
+        return 0;
+    }
+    memory_free((void **)&opening_table);
+    opening_table = (n_int *)memory_new(sizeof(n_int) * (n_uint)size);
+    if (opening_table == 0L) {
+        opening_table_size = 0;
+        return SHOW_ERROR("Opening table not allocated");
+    }
+    memory_erase((n_byte *)opening_table, sizeof(n_int) * (n_uint)size);
+    opening_table_size = size;
+    while (loop < (n_int)opening_list->count) {
+        n_int slot = matrix_opening_find(&recorded_openings[loop].start, &recorded_openings[loop].end, opening_type->data[loop]);
+        opening_table[slot] = loop + 1;
+        loop++;
+    }
+    return 0;
+}
+
+// Openings are added from the rooms either side, only the first of the same opening is kept
+static void matrix_opening_add(n_vect2 *start, n_vect2 *end, n_byte type) {
+    matrix_plane opening;
+    n_int slot;
+
+    if (block_list == 0L) {
+        matrix_init();
+    }
+    if (matrix_opening_table() != 0) {
+        return;
+    }
+    slot = matrix_opening_find(start, end, type);
+    if (opening_table[slot]) {
+        return;
+    }
+
+    opening.start = *start;
+    opening.end = *end;
+#ifdef DEBUG_BLOCKING_BOUNDARIES
+    opening.color = 4;
+    opening.thickness = 1;
+#endif
+    memory_list_copy(opening_list, (n_byte *)&opening, sizeof(opening));
+    memory_list_copy(opening_type, &type, sizeof(type));
+    opening_table[slot] = (n_int)opening_list->count;
+}
+
+// The doors and windows, with their types in the same order
+memory_list *matrix_opening(memory_list **types) {
+    if (types) {
+        *types = opening_type;
+    }
+    return opening_list;
+}
+
 void matrix_init(void) {
+    if (block_list) {
+        return;
+    }
     block_list = memory_list_new(sizeof(matrix_plane), 50000);
+    block_type = memory_list_new(sizeof(n_byte), 50000);
+    opening_list = memory_list_new(sizeof(matrix_plane), 5000);
+    opening_type = memory_list_new(sizeof(n_byte), 5000);
     draw_identifier_list = memory_list_new(sizeof(matrix_plane), 60000);
+    (void)matrix_index_size(0);
+}
+
+void matrix_clear(void) {
+    n_int grid = 0;
+    if (block_list == 0L) {
+        return;
+    }
+    block_list->count = 0;
+    block_type->count = 0;
+    opening_list->count = 0;
+    opening_type->count = 0;
+    if (opening_table) {
+        memory_erase((n_byte *)opening_table, sizeof(n_int) * (n_uint)opening_table_size);
+    }
+    draw_identifier_list->count = 0;
+    visibility_invalidate();
+    while (grid < MATRIX_GRIDS) {
+        n_int loop = 0;
+        while (block_index[grid] && (loop < block_buckets)) {
+            if (block_index[grid][loop]) {
+                block_index[grid][loop]->count = 0;
+                block_segments[grid][loop]->count = 0;
+            }
+            loop++;
+        }
+        grid++;
+    }
 }
 
 void matrix_close(void) {
+    if (block_list == 0L) {
+        return;
+    }
     memory_list_free(&block_list);
+    memory_list_free(&block_type);
+    memory_list_free(&opening_list);
+    memory_list_free(&opening_type);
+    memory_free((void **)&opening_table);
+    opening_table_size = 0;
     memory_list_free(&draw_identifier_list);
+    visibility_close();
+    matrix_index_free();
 }
 
+// Doors are openings in the walls that can be walked and seen through
 void matrix_add_door(n_vect2 *start, n_vect2 *end) {
-    // TODO: Implement door addition logic
+    matrix_opening_add(start, end, MT_DOOR);
 }
 
 void matrix_add_fence(n_vect2 *start, n_vect2 *end) {
@@ -158,11 +537,20 @@ void matrix_add_fence(n_vect2 *start, n_vect2 *end) {
     new_fence.color = 3;
     new_fence.thickness = 1;
 #endif
-    memory_list_copy(block_list, (n_byte *)&new_fence, sizeof(new_fence));
+    matrix_block_add(&new_fence, MT_FENCE);
 }
 
+// Windows are openings that can be seen through but block movement
 void matrix_add_window(n_vect2 *start, n_vect2 *end) {
-    // TODO: Implement window addition logic
+    matrix_plane new_window;
+    new_window.start = *start;
+    new_window.end = *end;
+#ifdef DEBUG_BLOCKING_BOUNDARIES
+    new_window.color = 4;
+    new_window.thickness = 1;
+#endif
+    matrix_opening_add(start, end, MT_WINDOW);
+    matrix_block_add(&new_window, MT_WINDOW);
 }
 
 void matrix_add_wall(n_vect2 *start, n_vect2 *end) {
@@ -173,31 +561,362 @@ void matrix_add_wall(n_vect2 *start, n_vect2 *end) {
     new_wall.color = 2;
     new_wall.thickness = 1;
 #endif
-    memory_list_copy(block_list, (n_byte *)&new_wall, sizeof(new_wall));
+    matrix_block_add(&new_wall, MT_WALL);
 }
 
+// Only the walls in the cells the line of sight passes through are tested
 n_byte matrix_visually_open(n_vect2 *origin, n_vect2 *end) {
-    n_int loop = 0;
-    matrix_plane *recorded_walls;
+    matrix_plane sight;
 
-    if (block_list == NULL) {
+    if ((block_list == 0L) || (block_buckets == 0)) {
         return 0;
     }
 
-    recorded_walls = (matrix_plane *)block_list->data;
     matrix_draw_add(origin, end);
 
-    while (loop < block_list->count) {
-        if (math_do_intersect(origin, end, &recorded_walls[loop].start, &recorded_walls[loop].end)) {
-            matrix_draw_add(&recorded_walls[loop].start, &recorded_walls[loop].end);
-            hit_block++;
-            return 0;
+    sight.start = *origin;
+    sight.end = *end;
+
+    if (matrix_index_segment(origin, end, matrix_index_hit, &sight)) {
+        hit_block++;
+        return 0;
+    }
+    return 1;
+}
+
+static int matrix_nearby_compare(const void *a, const void *b) {
+    n_int first = *(const n_int *)a;
+    n_int second = *(const n_int *)b;
+    return (first > second) - (first < second);
+}
+
+// Adds the index of every wall and fence indexed within the square around the center, each once
+void matrix_nearby(n_vect2 *center, n_int radius, int_list *found) {
+    n_int start = (n_int)found->count;
+    n_int cell_y = matrix_index_cell(center->y - radius);
+    n_int cell_end_y = matrix_index_cell(center->y + radius);
+    n_int *values;
+    n_int loop, unique;
+
+    if ((block_list == 0L) || (block_buckets == 0)) {
+        return;
+    }
+
+    while (cell_y <= cell_end_y) {
+        n_int cell_x = matrix_index_cell(center->x - radius);
+        n_int cell_end_x = matrix_index_cell(center->x + radius);
+        while (cell_x <= cell_end_x) {
+            int_list *bucket = block_index[MATRIX_SIGHT][matrix_index_bucket(cell_x, cell_y)];
+            if (bucket) {
+                n_int *entries = (n_int *)bucket->data;
+                for (loop = 0; loop < (n_int)bucket->count; loop++) {
+                    int_list_copy(found, entries[loop]);
+                }
+            }
+            cell_x++;
         }
+        cell_y++;
+    }
+
+    // a wall crossing several cells is in several buckets, and cells can share a bucket
+    values = &((n_int *)found->data)[start];
+    qsort(values, found->count - (n_uint)start, sizeof(n_int), matrix_nearby_compare);
+    unique = 0;
+    for (loop = 0; loop < ((n_int)found->count - start); loop++) {
+        if ((unique == 0) || (values[unique - 1] != values[loop])) {
+            values[unique++] = values[loop];
+        }
+    }
+    found->count = (n_uint)(start + unique);
+}
+
+#define MATRIX_BATCH_GROUP (256)
+
+typedef struct {
+    n_vect2 *origins;
+    n_vect2 *ends;
+    n_byte *results;
+    n_int count;
+} matrix_batch;
+
+static n_int matrix_batch_execute(void *general, void *read, void *write) {
+    matrix_batch *batch = (matrix_batch *)read;
+    n_int loop = 0;
+
+    while (loop < batch->count) {
+        matrix_plane sight;
+        sight.start = batch->origins[loop];
+        sight.end = batch->ends[loop];
+        batch->results[loop] = !matrix_index_segment(&sight.start, &sight.end, matrix_index_blocked, &sight);
+        loop++;
+    }
+    return 0;
+}
+
+// Answers many independent lines of sight in one call, spread across the execute threads. Unlike
+// matrix_visually_open the blocking walls are not added to the draw identifiers.
+void matrix_visually_open_batch(n_vect2 *origins, n_vect2 *ends, n_int count, n_byte *results) {
+    n_int groups = (count + MATRIX_BATCH_GROUP - 1) / MATRIX_BATCH_GROUP;
+    matrix_batch *batches;
+    n_int loop = 0;
+
+    if ((block_list == 0L) || (block_buckets == 0) || (count < 1)) {
+        return;
+    }
+
+    batches = (matrix_batch *)memory_new(sizeof(matrix_batch) * (n_uint)groups);
+    if (batches == 0L) {
+        (void)SHOW_ERROR("Matrix batch not allocated");
+        return;
+    }
+
+    while (loop < groups) {
+        n_int offset = loop * MATRIX_BATCH_GROUP;
+        batches[loop].origins = &origins[offset];
+        batches[loop].ends = &ends[offset];
+        batches[loop].results = &results[offset];
+        batches[loop].count = ((count - offset) < MATRIX_BATCH_GROUP) ? (count - offset) : MATRIX_BATCH_GROUP;
         loop++;
     }
+
+    execute_group(matrix_batch_execute, 0L, batches, groups, sizeof(matrix_batch));
+
+    memory_free((void **)&batches);
+
+    loop = 0;
+    while (loop < count) {
+        hit_block += (results[loop++] == 0);
+    }
+}
+
+// Where the ray from point p along d meets the segment from a to c, as a fraction of d.
+// Returns -1 if they don't meet.
+static n_double matrix_raycast_segment(n_double px, n_double py, n_double dx, n_double dy,
+                                       n_double ax, n_double ay, n_double cx, n_double cy) {
+    n_double wx = cx - ax;
+    n_double wy = cy - ay;
+    n_double ox = ax - px;
+    n_double oy = ay - py;
+    n_double denominator = (dx * wy) - (dy * wx);
+    n_double along_ray = (ox * wy) - (oy * wx);
+    n_double along_wall = (ox * dy) - (oy * dx);
+
+    if (denominator == 0) {
+        n_double length, ta, tc;
+        if (along_wall != 0) {
+            return -1;
+        }
+        // colinear, the nearest overlapping end
+        length = (dx * dx) + (dy * dy);
+        if (length == 0) {
+            return -1;
+        }
+        ta = ((ox * dx) + (oy * dy)) / length;
+        tc = (((cx - px) * dx) + ((cy - py) * dy)) / length;
+        if (ta > tc) {
+            n_double temp = ta;
+            ta = tc;
+            tc = temp;
+        }
+        if ((tc < 0) || (ta > 1)) {
+            return -1;
+        }
+        return (ta < 0) ? 0 : ta;
+    }
+
+    if (denominator < 0) {
+        denominator = -denominator;
+        along_ray = -along_ray;
+        along_wall = -along_wall;
+    }
+    if ((along_ray < 0) || (along_ray > denominator) || (along_wall < 0) || (along_wall > denominator)) {
+        return -1;
+    }
+    return along_ray / denominator;
+}
+
+// Length of a vector, the square root is taken with eight bits of fraction
+static n_double matrix_length(n_double x, n_double y) {
+    n_double squared = (x * x) + (y * y);
+    n_double scale = 1;
+    while (squared >= 281474976710656.0) {
+        squared /= 65536;
+        scale *= 256;
+    }
+    return ((n_double)math_root((n_uint)(squared * 65536)) / 256) * scale;
+}
+
+// The nearest plane in the grid along the ray from the origin, as a fraction of the ray. The ray walks
+// the grid cell by cell (DDA) and stops as soon as a hit is closer than the far side of the current cell.
+// Leaving ignores planes the origin is on when the ray moves away from them.
+static n_int matrix_nearest(n_int grid, n_vect2 *origin, n_double dx, n_double dy, n_byte leaving, n_double *nearest) {
+    n_double px = (n_double)origin->x;
+    n_double py = (n_double)origin->y;
+    n_double t_max_x, t_max_y, t_delta_x, t_delta_y;
+    n_double best = 2;
+    n_int best_index = -1;
+    n_int cell_x = matrix_index_cell(origin->x);
+    n_int cell_y = matrix_index_cell(origin->y);
+    n_int step_x = (dx < 0) ? -1 : 1;
+    n_int step_y = (dy < 0) ? -1 : 1;
+
+    if (dx == 0) {
+        t_max_x = t_delta_x = 2;
+    } else {
+        n_double edge = (n_double)((cell_x + (step_x > 0)) * MATRIX_INDEX_CELL);
+        t_max_x = (edge - px) / dx;
+        t_delta_x = (n_double)MATRIX_INDEX_CELL / ((dx < 0) ? -dx : dx);
+    }
+    if (dy == 0) {
+        t_max_y = t_delta_y = 2;
+    } else {
+        n_double edge = (n_double)((cell_y + (step_y > 0)) * MATRIX_INDEX_CELL);
+        t_max_y = (edge - py) / dy;
+        t_delta_y = (n_double)MATRIX_INDEX_CELL / ((dy < 0) ? -dy : dy);
+    }
+
+    while (1) {
+        n_int bucket = matrix_index_bucket(cell_x, cell_y);
+        n_segments *walls = block_segments[grid][bucket];
+        n_double t_exit = (t_max_x < t_max_y) ? t_max_x : t_max_y;
+        n_int loop = 0;
+
+        while (walls && (loop < walls->count)) {
+            n_double t = matrix_raycast_segment(px, py, dx, dy, walls->start_x[loop], walls->start_y[loop],
+                                                walls->end_x[loop], walls->end_y[loop]);
+            if ((t >= 0) && (t < best) && leaving && (t == 0)) {
+                n_double wall_x = walls->end_x[loop] - walls->start_x[loop];
+                n_double wall_y = walls->end_y[loop] - walls->start_y[loop];
+                n_double side_start = (wall_x * (py - walls->start_y[loop])) - (wall_y * (px - walls->start_x[loop]));
+                n_double side_end = (wall_x * (py + dy - walls->start_y[loop])) - (wall_y * (px + dx - walls->start_x[loop]));
+                if ((side_start == 0) && (side_end != 0)) {
+                    t = -1;
+                }
+            }
+            if ((t >= 0) && (t < best)) {
+                best = t;
+                best_index = ((n_int *)block_index[grid][bucket]->data)[loop];
+            }
+            loop++;
+        }
+
+        if ((best <= t_exit) || (t_exit > 1)) {
+            break;
+        }
+        if (t_max_x < t_max_y) {
+            cell_x += step_x;
+            t_max_x += t_delta_x;
+        } else {
+            cell_y += step_y;
+            t_max_y += t_delta_y;
+        }
+    }
+
+    *nearest = best;
+    return best_index;
+}
+
+// The nearest wall or fence along the ray from the origin, windows are seen through
+n_byte matrix_raycast(n_vect2 *origin, n_vect2 *direction, n_int max_distance, matrix_hit *hit) {
+    n_double length, dx, dy, best;
+    n_int best_index;
+
+    if ((block_list == 0L) || (block_buckets == 0) || (max_distance < 1) || ((direction->x == 0) && (direction->y == 0))) {
+        return 0;
+    }
+
+    length = matrix_length((n_double)direction->x, (n_double)direction->y);
+    dx = ((n_double)direction->x * (n_double)max_distance) / length;
+    dy = ((n_double)direction->y * (n_double)max_distance) / length;
+
+    best_index = matrix_nearest(MATRIX_SIGHT, origin, dx, dy, 0, &best);
+
+    if (best_index == -1) {
+        return 0;
+    }
+
+    if (hit) {
+        hit->point.x = origin->x + (n_int)((best * dx) + ((dx < 0) ? -0.5 : 0.5));
+        hit->point.y = origin->y + (n_int)((best * dy) + ((dy < 0) ? -0.5 : 0.5));
+        hit->distance = (n_int)((best * (n_double)max_distance) + 0.5);
+        hit->identifier = best_index;
+        hit->type = block_type->data[best_index];
+    }
     return 1;
 }
 
+static n_int matrix_round(n_double value) {
+    return (n_int)(value + ((value < 0) ? -0.5 : 0.5));
+}
+
+// Rounding to whole units can bring a location closer to a wall, so each whole unit step is checked
+static void matrix_move_step(n_vect2 *location, n_double dx, n_double dy) {
+    n_double nearest;
+    n_int x = matrix_round(dx);
+    n_int y = matrix_round(dy);
+    if ((x == 0) && (y == 0)) {
+        return;
+    }
+    if (matrix_nearest(MATRIX_MOVE, location, (n_double)x, (n_double)y, 1, &nearest) == -1) {
+        location->x += x;
+        location->y += y;
+    }
+}
+
+// Moves the location by the step unless something that blocks movement is in the way. The step is
+// swept against the nearby walls, fences and windows, stops short of the nearest and slides along it
+// with what is left. Doors are gaps in the walls so they are walked through.
+void matrix_move(n_vect2 *location, n_vect2 *step) {
+    n_double dx = (n_double)step->x;
+    n_double dy = (n_double)step->y;
+    n_int slides = 0;
+
+    if ((block_list == 0L) || (block_buckets == 0)) {
+        vect2_add(location, location, step);
+        return;
+    }
+
+    while ((dx != 0) || (dy != 0)) {
+        n_double nearest, length, travel, remaining;
+        matrix_plane *wall;
+        n_double wall_x, wall_y, wall_length, along;
+        n_int index = matrix_nearest(MATRIX_MOVE, location, dx, dy, 1, &nearest);
+
+        if (index == -1) {
+            matrix_move_step(location, dx, dy);
+            return;
+        }
+
+        length = matrix_length(dx, dy);
+        travel = (nearest * length) - MATRIX_MOVE_MARGIN;
+        if (travel > 0) {
+            matrix_move_step(location, (dx * travel) / length, (dy * travel) / length);
+        } else {
+            travel = 0;
+        }
+
+        if (slides++ == MATRIX_MOVE_SLIDES) {
+            return;
+        }
+
+        // slide along the wall with the rest of the step
+        wall = &((matrix_plane *)block_list->data)[index];
+        wall_x = (n_double)(wall->end.x - wall->start.x);
+        wall_y = (n_double)(wall->end.y - wall->start.y);
+        wall_length = (wall_x * wall_x) + (wall_y * wall_y);
+        if (wall_length == 0) {
+            return;
+        }
+        remaining = 1 - (travel / length);
+        along = (((dx * wall_x) + (dy * wall_y)) * remaining) / wall_length;
+        dx = wall_x * along;
+        dy = wall_y * along;
+        if ((matrix_round(dx) == 0) && (matrix_round(dy) == 0)) {
+            return;
+        }
+    }
+}
+
 void matrix_account(void) {
     hit_block = 0;
     matrix_draw_identifier_clear();
@@ -239,63 +239,64 @@ void path_init(n_vect2 * location, simulated_path_group * group, n_int rotation,
 }
 
 
-// Function to rotate a point around a center using a direction vector
-static void house_rotate_logic(n_vect2 *point, n_vect2 *points_center, n_vect2 *direction_vector, n_vect2 *center) {
-    vect2_subtract(point, point, points_center);
-    vect2_rotation(point, direction_vector);
-    vect2_add(point, point, center);
+// Marks the room points that are used, windows and doors that aren't there stay at zero
+static void house_transform_mask(simulated_room *room, n_byte *mask) {
+    n_int loop = 0;
+
+    while (loop < POINTS_PER_ROOM_STRUCTURE) {
+        mask[loop++] = 1;
+    }
+    while (loop < 16) {
+        n_byte present = (n_byte)house_window_present(&room->points[loop]);
+        mask[loop] = present;
+        mask[loop + 1] = present;
+        loop += 2;
+    }
+    while (loop < POINTS_PER_ROOM) {
+        n_byte present = (n_byte)house_door_present(&room->points[loop]);
+        mask[loop] = present;
+        mask[loop + 1] = present;
+        mask[loop + 2] = present;
+        mask[loop + 3] = present;
+        loop += 4;
+    }
 }
 
-// Function to transform a building's rooms based on direction and center
+// Function to transform a building's rooms based on direction and center. The rooms are next to each
+// other so every point of the building is rotated in one pass, the same as vect2_rotation around the
+// center of the room structures.
 static void house_transform(simulated_building *building, n_vect2 *center, n_int direction) {
-    n_int loop_room = 0;
-    n_vect2 *min_max = vect2_min_max_init();
+    n_byte mask[MAX_ROOMS * POINTS_PER_ROOM];
+    n_vect2 min_max[2];
     n_vect2 direction_vector;
     n_vect2 points_center;
+    n_vect2 *points = building->room[0].points;
+    n_int count = building->roomcount * POINTS_PER_ROOM;
+    n_int loop_room = 0;
+    n_int loop = 0;
 
-    if (min_max == 0L) return;
+    vect2_populate(&min_max[0], BIG_INTEGER, BIG_INTEGER);
+    vect2_populate(&min_max[1], BIG_NEGATIVE_INTEGER, BIG_NEGATIVE_INTEGER);
 
-    // Calculate min and max points for all rooms
+    // Calculate min and max points for all rooms and which points are present
     while (loop_room < building->roomcount) {
-        simulated_room *room = &building->room[loop_room++];
+        simulated_room *room = &building->room[loop_room];
         vect2_min_max(room->points, POINTS_PER_ROOM_STRUCTURE, min_max);
+        house_transform_mask(room, &mask[loop_room * POINTS_PER_ROOM]);
+        loop_room++;
     }
 
     vect2_center(&points_center, &min_max[1], &min_max[0]);
     vect2_direction(&direction_vector, direction, 1);
-    memory_free((void **)&min_max);
-
-    // Apply rotation logic to each room's points
-    loop_room = 0;
-    while (loop_room < building->roomcount) {
-        n_int loop = 0;
-        simulated_room *room = &building->room[loop_room++];
-
-        // Rotate room structure points
-        while (loop < 8) {
-            house_rotate_logic(&room->points[loop], &points_center, &direction_vector, center);
-            loop++;
-        }
-
-        // Rotate window points if present
-        while (loop < 16) {
-            if (house_window_present(&room->points[loop])) {
-                house_rotate_logic(&room->points[loop], &points_center, &direction_vector, center);
-                house_rotate_logic(&room->points[loop + 1], &points_center, &direction_vector, center);
-            }
-            loop += 2;
-        }
 
-        // Rotate door points if present
-        while (loop < 32) {
-            if (house_door_present(&room->points[loop])) {
-                house_rotate_logic(&room->points[loop], &points_center, &direction_vector, center);
-                house_rotate_logic(&room->points[loop + 1], &points_center, &direction_vector, center);
-                house_rotate_logic(&room->points[loop + 2], &points_center, &direction_vector, center);
-                house_rotate_logic(&room->points[loop + 3], &points_center, &direction_vector, center);
-            }
-            loop += 4;
+    while (loop < count) {
+        n_int px = points[loop].x - points_center.x;
+        n_int py = points[loop].y - points_center.y;
+        if (mask[loop]) {
+            points[loop].x = (((px * direction_vector.x) + (py * direction_vector.y)) / SINE_MAXIMUM) + center->x;
+            points[loop].y = (((px * direction_vector.y) - (py * direction_vector.x)) / SINE_MAXIMUM) + center->y;
         }
+        loop++;
     }
 }
 
@@ -384,11 +385,20 @@ static void house_construct(simulated_room *room, n_int topx, n_int topy, n_int
     }
 }
 
-// Generate a random value within a specific range
+#define HOUSE_PLUSMINUS_TRIES (16)
+
+// Generate a random value within a specific range, a seed stuck in a short cycle may never produce
+// one so the tries are bounded and the last value picks the sign of the fallback
 static n_int house_plusminus(n_byte2 *seed) {
     n_int tmp = 0;
+    n_int tries = 0;
+    n_byte2 value = 0;
     while ((tmp > -3) && (tmp < 3)) {
-        tmp = (math_random(seed) % 11) - 5;
+        if (tries++ == HOUSE_PLUSMINUS_TRIES) {
+            return (value & 1) ? 3 : -3;
+        }
+        value = math_random(seed);
+        tmp = (value % 11) - 5;
     }
     return tmp;
 }
@@ -412,6 +422,155 @@ static n_int house_genetics(n_int *house, n_byte2 *seed) {
 
 #define HOUSE_SIZE (30)
 
+// Whether the point is inside the room's outline, the outline is convex so the point is on the same
+// side of every edge
+static n_byte house_room_contains(simulated_room *room, n_vect2 *point) {
+    n_int positive = 0, negative = 0;
+    n_int loop = 0;
+    while (loop < 4) {
+        n_vect2 *start = &room->points[loop];
+        n_vect2 *end = &room->points[(loop + 1) & 3];
+        n_int cross = ((end->x - start->x) * (point->y - start->y)) - ((end->y - start->y) * (point->x - start->x));
+        positive |= (cross > 0);
+        negative |= (cross < 0);
+        loop++;
+    }
+    return !(positive && negative);
+}
+
+// The room containing the point, or HOUSE_OUTSIDE
+n_int house_room_at(simulated_building *building, n_vect2 *point) {
+    n_int loop = 0;
+    while (loop < building->roomcount) {
+        if (house_room_contains(&building->room[loop], point)) {
+            return loop;
+        }
+        loop++;
+    }
+    return HOUSE_OUTSIDE;
+}
+
+static n_int house_room_other(simulated_building *building, n_int room, n_vect2 *point) {
+    n_int loop = 0;
+    while (loop < building->roomcount) {
+        if ((loop != room) && house_room_contains(&building->room[loop], point)) {
+            return loop;
+        }
+        loop++;
+    }
+    return HOUSE_OUTSIDE;
+}
+
+static n_int house_walk(n_vect2 *start, n_vect2 *end) {
+    n_vect2 difference;
+    vect2_subtract(&difference, end, start);
+    return (n_int)math_root((n_uint)((difference.x * difference.x) + (difference.y * difference.y)));
+}
+
+// Rooms are the nodes and doors the edges. The inside half of each door is in its own room and the
+// outside half is in the next room or outside. The shortest walks between every pair of rooms, room
+// center to door to room center, are found once so the routes are looked up rather than searched.
+// Outside is only ever the end of a walk, a walk doesn't leave the building and come back in.
+static void house_graph(simulated_building *building) {
+    simulated_house_graph *graph = &building->graph;
+    n_vect2 center[MAX_ROOMS + 1];
+    n_int from, to, through;
+    n_int loop_room = 0;
+
+    graph->count = 0;
+    for (from = 0; from <= MAX_ROOMS; from++) {
+        for (to = 0; to <= MAX_ROOMS; to++) {
+            graph->cost[from][to] = (from == to) ? 0 : HOUSE_UNREACHED;
+            graph->door[from][to] = 0;
+            graph->next[from][to] = (n_byte)to;
+        }
+    }
+
+    while (loop_room < building->roomcount) {
+        vect2_center(&center[loop_room], &building->room[loop_room].points[0], &building->room[loop_room].points[2]);
+        loop_room++;
+    }
+
+    loop_room = 0;
+    while (loop_room < building->roomcount) {
+        simulated_room *room = &building->room[loop_room];
+        n_int loop = 0;
+        while (loop < 4) {
+            n_vect2 *door = &room->points[16 + (loop * 4)];
+            if (house_door_present(door)) {
+                n_vect2 inside, outside, middle;
+                n_int other, cost, number = graph->count++;
+                vect2_center(&inside, &door[0], &door[1]);
+                vect2_center(&outside, &door[2], &door[3]);
+                vect2_center(&middle, &inside, &outside);
+                other = house_room_other(building, loop_room, &outside);
+
+                graph->center[number] = middle;
+                graph->room[number][0] = (n_byte)loop_room;
+                graph->room[number][1] = (n_byte)other;
+
+                cost = house_walk(&center[loop_room], &middle);
+                if (other != HOUSE_OUTSIDE) {
+                    cost += house_walk(&middle, &center[other]);
+                }
+                if (cost < graph->cost[loop_room][other]) {
+                    graph->cost[loop_room][other] = graph->cost[other][loop_room] = (n_byte2)cost;
+                    graph->door[loop_room][other] = graph->door[other][loop_room] = (n_byte)number;
+                }
+            }
+            loop++;
+        }
+        loop_room++;
+    }
+
+    for (through = 0; through < building->roomcount; through++) {
+        for (from = 0; from <= MAX_ROOMS; from++) {
+            if (graph->cost[from][through] == HOUSE_UNREACHED) continue;
+            for (to = 0; to <= MAX_ROOMS; to++) {
+                n_int cost = graph->cost[from][through] + graph->cost[through][to];
+                if ((graph->cost[through][to] != HOUSE_UNREACHED) && (cost < graph->cost[from][to])) {
+                    graph->cost[from][to] = (n_byte2)cost;
+                    graph->door[from][to] = graph->door[from][through];
+                    graph->next[from][to] = graph->next[from][through];
+                }
+            }
+        }
+    }
+}
+
+// The cost of the shortest walk between the rooms, or HOUSE_UNREACHED
+n_int house_route_cost(simulated_building *building, n_int from_room, n_int to_room) {
+    if ((from_room < 0) || (from_room > MAX_ROOMS) || (to_room < 0) || (to_room > MAX_ROOMS)) {
+        return HOUSE_UNREACHED;
+    }
+    return building->graph.cost[from_room][to_room];
+}
+
+// The doors on the shortest walk between the rooms in the order they are walked through. Returns the
+// number of doors, which can be more than the max, or -1 if the rooms aren't joined.
+n_int house_route(simulated_building *building, n_int from_room, n_int to_room, n_vect2 *doors, n_int max) {
+    simulated_house_graph *graph = &building->graph;
+    n_int count = 0;
+
+    if (house_route_cost(building, from_room, to_room) == HOUSE_UNREACHED) {
+        return -1;
+    }
+    while (from_room != to_room) {
+        if (count < max) {
+            doors[count] = graph->center[graph->door[from_room][to_room]];
+        }
+        count++;
+        from_room = graph->next[from_room][to_room];
+    }
+    return count;
+}
+
+// The doors on the shortest walk out of the building from the room
+n_int house_exit(simulated_building *building, n_int room, n_vect2 *doors, n_int max) {
+    return house_route(building, room, HOUSE_OUTSIDE, doors, max);
+}
+
+
 // Create a house with rooms and transform it
 void house_create(simulated_building *building, n_byte2 *seed, n_vect2 *center) {
     n_int rooms = house_genetics(building->house, seed);
@@ -463,6 +622,8 @@ void house_create(simulated_building *building, n_byte2 *seed, n_vect2 *center)
 
     // Transform the building based on the center and random direction
     house_transform(building, center, math_random(seed) & 255);
+
+    house_graph(building);
 }
 
 // Initialize houses in a grid pattern
@@ -484,6 +645,160 @@ void house_init(n_byte2 *seed, n_vect2 *location, simulated_building *buildings)
     }
 }
 
+// Doors and windows of every room in a building, a door can sit on the shared wall of the next room
+#define HOUSE_OPENINGS_MAX  (MAX_ROOMS * 8)
+#define HOUSE_BREAKS_MAX    (2 + (HOUSE_OPENINGS_MAX * 2))
+
+typedef struct {
+    n_vect2 start;
+    n_vect2 end;
+    n_byte  type;
+} house_opening;
+
+static n_int house_openings(simulated_building *building, house_opening *openings) {
+    n_int count = 0;
+    n_int loop_room = 0;
+
+    while (loop_room < building->roomcount) {
+        simulated_room *room = &building->room[loop_room++];
+        n_int loop = 0;
+        while (loop < 4) {
+            n_vect2 *window = &room->points[8 + (loop * 2)];
+            n_vect2 *door = &room->points[16 + (loop * 4)];
+            if (house_window_present(window)) {
+                openings[count].start = window[0];
+                openings[count].end = window[1];
+                openings[count++].type = MT_WINDOW;
+            }
+            if (house_door_present(door)) {
+                // the door is drawn across the wall, the opening is along the middle of it
+                vect2_center(&openings[count].start, &door[0], &door[3]);
+                vect2_center(&openings[count].end, &door[1], &door[2]);
+                openings[count++].type = MT_DOOR;
+            }
+            loop++;
+        }
+    }
+    return count;
+}
+
+static void house_edge_point(n_vect2 *start, n_vect2 *edge, n_int along, n_int length, n_vect2 *point) {
+    point->x = start->x + ((edge->x * along) / length);
+    point->y = start->y + ((edge->y * along) / length);
+}
+
+// Splits a room wall into wall, window and door pieces. Openings within a few units of the wall are
+// projected on to it and doors take precedence over windows where they overlap.
+static void house_edge_matrix(n_vect2 *start, n_vect2 *end, house_opening *openings, n_int count) {
+    n_int breaks[HOUSE_BREAKS_MAX];
+    n_int from[HOUSE_OPENINGS_MAX], to[HOUSE_OPENINGS_MAX];
+    n_byte types[HOUSE_OPENINGS_MAX];
+    n_int break_count = 0, on_edge = 0;
+    n_int loop, piece_start = 0;
+    n_byte piece_type = MT_WALL;
+    n_vect2 edge;
+    n_int length;
+
+    vect2_subtract(&edge, end, start);
+    length = (edge.x * edge.x) + (edge.y * edge.y);
+    if (length == 0) return;
+
+    breaks[break_count++] = 0;
+    breaks[break_count++] = length;
+
+    for (loop = 0; loop < count; loop++) {
+        n_vect2 a, b;
+        n_int cross_a, cross_b, along_a, along_b;
+        vect2_subtract(&a, &openings[loop].start, start);
+        vect2_subtract(&b, &openings[loop].end, start);
+        cross_a = (a.x * edge.y) - (a.y * edge.x);
+        cross_b = (b.x * edge.y) - (b.y * edge.x);
+        if (((cross_a * cross_a) > (16 * length)) || ((cross_b * cross_b) > (16 * length))) continue;
+        along_a = (a.x * edge.x) + (a.y * edge.y);
+        along_b = (b.x * edge.x) + (b.y * edge.y);
+        if (along_a > along_b) { n_int temp = along_a; along_a = along_b; along_b = temp; }
+        if (along_a < 0) along_a = 0;
+        if (along_b > length) along_b = length;
+        if (along_a >= along_b) continue;
+        from[on_edge] = along_a;
+        to[on_edge] = along_b;
+        types[on_edge++] = openings[loop].type;
+        breaks[break_count++] = along_a;
+        breaks[break_count++] = along_b;
+    }
+
+    // sort the breaks, there are only a few
+    for (loop = 1; loop < break_count; loop++) {
+        n_int value = breaks[loop];
+        n_int location = loop;
+        while ((location > 0) && (breaks[location - 1] > value)) {
+            breaks[location] = breaks[location - 1];
+            location--;
+        }
+        breaks[location] = value;
+    }
+
+    for (loop = 0; loop < (break_count - 1); loop++) {
+        n_int middle = (breaks[loop] + breaks[loop + 1]) / 2;
+        n_byte type = MT_WALL;
+        n_int opening;
+        if (breaks[loop] == breaks[loop + 1]) continue;
+        for (opening = 0; opening < on_edge; opening++) {
+            if ((middle >= from[opening]) && (middle <= to[opening]) && (type != MT_DOOR)) {
+                type = types[opening];
+            }
+        }
+        if ((type != piece_type) && (breaks[loop] != piece_start)) {
+            n_vect2 piece_from, piece_to;
+            house_edge_point(start, &edge, piece_start, length, &piece_from);
+            house_edge_point(start, &edge, breaks[loop], length, &piece_to);
+            if (piece_type == MT_WALL) matrix_add_wall(&piece_from, &piece_to);
+            if (piece_type == MT_WINDOW) matrix_add_window(&piece_from, &piece_to);
+            if (piece_type == MT_DOOR) matrix_add_door(&piece_from, &piece_to);
+            piece_start = breaks[loop];
+        }
+        piece_type = type;
+    }
+
+    {
+        n_vect2 piece_from;
+        house_edge_point(start, &edge, piece_start, length, &piece_from);
+        if (piece_type == MT_WALL) matrix_add_wall(&piece_from, end);
+        if (piece_type == MT_WINDOW) matrix_add_window(&piece_from, end);
+        if (piece_type == MT_DOOR) matrix_add_door(&piece_from, end);
+    }
+}
+
+// Add the walls, windows and doors of the houses to the blocking matrix
+void house_matrix(simulated_building *buildings) {
+    house_opening openings[HOUSE_OPENINGS_MAX];
+    n_int count = 0;
+
+    while (count < 16) {
+        simulated_building *building = &buildings[count++];
+        n_int opening_count = house_openings(building, openings);
+        n_int loop_room = 0;
+
+        while (loop_room < building->roomcount) {
+            simulated_room *room = &building->room[loop_room++];
+            n_int loop = 0;
+            while (loop < 4) {
+                house_edge_matrix(&room->points[loop], &room->points[(loop + 1) & 3], openings, opening_count);
+                loop++;
+            }
+        }
+    }
+}
+
+// Add the fences to the blocking matrix
+void fence_matrix(simulated_fence *fences, n_int count) {
+    n_int loop = 0;
+    while (loop < count) {
+        matrix_add_fence(&fences[loop].points[0], &fences[loop].points[1]);
+        loop++;
+    }
+}
+
 void fence_init(n_byte2 *seed, n_byte rotate, n_vect2 *location, simulated_fence *fences) {
     n_int count = 0;
 
@@ -39,22 +39,32 @@
 
 
 #define NEIGHBORHOOD_UNIT_SPACE (3400)
-#define TWO_BLOCK_EDGE_HALF     (4) // 4 (up to 8)
+#define NEIGHBORHOOD_CELL_OFFSET (500) // the world location of the corner of cell (0, 0)
+#define TWO_BLOCK_EDGE_HALF     (4) // default city edge, the edge is set at run time through neighborhood_init
 #define TWO_BLOCK_EDGE          (TWO_BLOCK_EDGE_HALF * 2)
 
-#define MAX_NUMBER_APES  (256) // (TWO_BLOCK_EDGE * TWO_BLOCK_EDGE * 4)
+#define MAX_NUMBER_APES  (256) // default population, population_init takes any number
 
-#define CITY_TOP_RIGHT_X ((NEIGHBORHOOD_UNIT_SPACE * TWO_BLOCK_EDGE_HALF) + 5 + (2*ROAD_WIDTH))
-#define CITY_TOP_RIGHT_Y ((NEIGHBORHOOD_UNIT_SPACE * TWO_BLOCK_EDGE_HALF) + 5 + (2*ROAD_WIDTH))
+#define CITY_EDGE_SPACE  (5 + (2*ROAD_WIDTH))
 
-#define CITY_BOTTOM_LEFT_X (0 - CITY_TOP_RIGHT_X )
-#define CITY_BOTTOM_LEFT_Y (0 - CITY_TOP_RIGHT_Y )
-
-#define PARK_NUM (TWO_BLOCK_EDGE_HALF)
-#define TWO_BLOCK_NUM ((TWO_BLOCK_EDGE * TWO_BLOCK_EDGE) - PARK_NUM)
+#define PARK_RATIO        (16) // one park in every sixteen cells
 #define FENCE_NUM (4)
 
-#define PARK_PROBABILITY  ((255 * TWO_BLOCK_NUM) / (PARK_NUM + TWO_BLOCK_NUM))
+#define PARK_PROBABILITY  ((255 * (PARK_RATIO - 1)) / PARK_RATIO)
+
+#define NEIGHBORHOOD_MEMORY_BUDGET  ((n_uint)8 << 30) // default upper limit for the city
+#define NEIGHBORHOOD_TWOBLOCK_INDEX ((n_uint)150 << 10) // measured bytes of the walls, openings and roads indexed for a two block
+
+#undef  NEIGHBORHOOD_STREAMING      // generate the cells around the agent rather than a fixed city
+#define NEIGHBORHOOD_STREAM_RADIUS  (2)
+
+#define VISIBILITY_RADIUS   (8000) // how far the agent can see
+#define POPULATION_DRAW_RADIUS  (VISIBILITY_RADIUS * 2) // how far from the agent the population is drawn
+
+#undef  DRAW_TILE_PYRAMID           // sample the static scene from cached tiles, not pixel exact
+#define DRAW_TILE_BUDGET    ((n_uint)64 << 20)
+
+#undef  DRAW_TREE_STAMPS            // copy the near tree outlines from kept stamps, not pixel exact
 
 #undef DEBUG_BLOCKING_BOUNDARIES
 
@@ -70,9 +80,17 @@ enum direction_constant
     DC_WEST         = 8
 };
 
+enum matrix_type
+{
+    MT_WALL         = 0,
+    MT_FENCE        = 1,
+    MT_WINDOW       = 2,
+    MT_DOOR         = 3
+};
+
 #define POINTS_PER_ROOM             (32)
 #define POINTS_PER_ROOM_STRUCTURE   (8)
-#define MAX_ROOMS                   (8)
+#define MAX_ROOMS                   (10)
 #define GENETICS_COUNT              (64)
 
 #define POINTS_PER_PATH             (4)
@@ -132,8 +150,22 @@ typedef struct{
     n_vect2  center;
 }simulated_tree;
 
+#define HOUSE_DOORS_MAX             (MAX_ROOMS * 4)
+#define HOUSE_OUTSIDE               (MAX_ROOMS) // the room number of outside the building
+#define HOUSE_UNREACHED             (0xffff)
+
+typedef struct{
+    n_vect2  center[HOUSE_DOORS_MAX];
+    n_byte   room[HOUSE_DOORS_MAX][2];              // the rooms either side of each door
+    n_byte2  cost[MAX_ROOMS + 1][MAX_ROOMS + 1];    // shortest walk between the rooms
+    n_byte   door[MAX_ROOMS + 1][MAX_ROOMS + 1];    // the first door on that walk
+    n_byte   next[MAX_ROOMS + 1][MAX_ROOMS + 1];    // the room through that door
+    n_byte   count;
+}simulated_house_graph;
+
 typedef struct{
     simulated_room   room[MAX_ROOMS];
+    simulated_house_graph graph;
     n_int            house[GENETICS_COUNT];
     n_int            roomcount;
     n_byte           rotation;
@@ -170,18 +202,39 @@ typedef struct{
 #endif
 }matrix_plane;
 
+typedef struct{
+    n_vect2 point;
+    n_int   distance;
+    n_int   identifier;
+    n_byte  type;
+}matrix_hit;
+
 void park_init(n_byte2 * seed, n_vect2 * location, simulated_park * parks);
+void twoblock_init(n_byte2 * seed, n_vect2 * location, simulated_twoblock * twoblock);
 void park_draw(simulated_park * park);
 
-void neighborhood_init(n_byte2 * seed);
+void neighborhood_seed(n_byte2 * city_seed, n_int px, n_int py, n_byte2 * cell_seed);
+n_int neighborhood_init(n_byte2 * seed, n_int edge_x, n_int edge_y);
+void neighborhood_close(void);
+void neighborhood_memory_budget(n_uint bytes);
+void neighborhood_dimensions(n_int * edge_x, n_int * edge_y);
+
+n_int neighborhood_stream_init(n_byte2 * seed, n_int radius);
+n_int neighborhood_stream_cycle(n_vect2 * location);
 void draw_neighborhood(void);
 
 n_int house_window_present(n_vect2 * window);
 n_int house_door_present(n_vect2 * door);
 
+n_int house_room_at(simulated_building * building, n_vect2 * point);
+n_int house_route(simulated_building * building, n_int from_room, n_int to_room, n_vect2 * doors, n_int max);
+n_int house_route_cost(simulated_building * building, n_int from_room, n_int to_room);
+n_int house_exit(simulated_building * building, n_int room, n_vect2 * doors, n_int max);
+
 n_int draw_game_scene(n_int dim_x, n_int dim_y);
-void draw_render(n_byte * buffer, n_int dim_x, n_int dim_y);
+n_int draw_render(n_byte * buffer, n_int dim_x, n_int dim_y);
 void draw_init(void);
+void draw_game_refresh(void);
 void draw_close(void);
 
 void draw_game_color(n_byte2 * fit);
@@ -195,9 +248,11 @@ void draw_path(simulated_path_group * group);
 
 void fence_init(n_byte2 * seed, n_byte rotate, n_vect2 * location, simulated_fence * fences);
 void fence_draw(simulated_fence * fences);
+void fence_matrix(simulated_fence * fences, n_int count);
 
 void house_init(n_byte2 * seed, n_vect2 * location, simulated_building * buildings);
 void draw_house(simulated_building * buildings);
+void house_matrix(simulated_building * buildings);
 
 void tree_init(simulated_tree * trees, n_byte2 * seed, n_vect2 * edge);
 n_int tree_populated(simulated_tree * tree);
@@ -216,21 +271,61 @@ void agent_turn(n_int delta);
 void agent_move(n_int forwards);
 void agent_cycle(void);
 
+n_int population_init(n_byte2 * seed, n_int count, n_vect2 * center, n_int radius);
+void population_cycle(void);
+void population_close(void);
+n_int population_number(void);
+void population_location(n_int agent, n_vect2 * location);
+void population_delta(n_int agent, n_vect2 * delta);
+n_byte population_facing(n_int agent);
+n_byte population_state(n_int agent);
+void population_nearby(n_vect2 * center, n_int radius, int_list * found);
+
 void matrix_add_window(n_vect2 * start, n_vect2 * end);
 void matrix_add_door(n_vect2 * start, n_vect2 * end);
 void matrix_add_wall(n_vect2 * start, n_vect2 * end);
 void matrix_add_fence(n_vect2 * start, n_vect2 * end);
 
 n_byte matrix_visually_open(n_vect2 * origin, n_vect2 * end);
+void matrix_visually_open_batch(n_vect2 * origins, n_vect2 * ends, n_int count, n_byte * results);
+n_byte matrix_raycast(n_vect2 * origin, n_vect2 * direction, n_int max_distance, matrix_hit * hit);
+void matrix_move(n_vect2 * location, n_vect2 * step);
+void matrix_nearby(n_vect2 * center, n_int radius, int_list * found);
+memory_list * matrix_opening(memory_list ** types);
+
+typedef struct road_search road_search;
+
+n_int road_graph_build(void);
+void road_graph_close(void);
+n_int road_graph_nodes(void);
+void road_graph_node(n_int node, n_vect2 * location);
+n_int road_graph_edges(n_int node);
+n_int road_graph_edge(n_int node, n_int edge, n_int * cost);
+n_int road_graph_nearest(n_vect2 * location);
+
+road_search * road_search_new(void);
+void road_search_free(road_search ** search);
+n_int road_route(road_search * search, n_int start, n_int end, int_list * route);
+n_int road_plan(road_search * search, n_int start, n_int end, int_list * route);
+n_int road_plan_prepare(void);
+void road_plan_invalidate(n_int cell_x, n_int cell_y);
+void road_plan_close(void);
+
+void visibility_invalidate(void);
+n_byte visibility_point(n_vect2 * point);
+n_vect2 * visibility_polygon(n_int * count);
+void visibility_close(void);
 
 void matrix_account(void);
 
 memory_list * matrix_draw_identifier(void);
 memory_list * matrix_draw_block(void);
+memory_list * matrix_draw_type(void);
 
 void matrix_draw_identifier_clear(void);
 
 void matrix_init(void);
+void matrix_clear(void);
 void matrix_close(void);
 
 n_object * game_object_fence(simulated_fence * fence);
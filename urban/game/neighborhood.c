@@ -35,15 +35,39 @@
 
 #include "mushroom.h"
 
-static simulated_twoblock twoblock[TWO_BLOCK_NUM];
-static simulated_park     park[PARK_NUM];
-static simulated_fence    fences[FENCE_NUM];
+static simulated_twoblock * twoblock = 0L;
+static simulated_park     * park = 0L;
+static simulated_fence      fences[FENCE_NUM];
+
+static n_int twoblock_num = 0;
+static n_int park_num = 0;
+static n_int fence_num = 0;
+static n_int neighborhood_edge_x = 0;
+static n_int neighborhood_edge_y = 0;
+
+typedef struct{
+    n_int  px;
+    n_int  py;
+    n_uint used;
+}neighborhood_resident;
+
+static neighborhood_resident * twoblock_resident = 0L;
+static neighborhood_resident * park_resident = 0L;
+
+static n_int   stream_on = 0;
+static n_int   stream_radius = 0;
+static n_int   stream_capacity = 0;
+static n_uint  stream_time = 0;
+static n_vect2 stream_center;
+static n_byte2 stream_seed[2];
+
+static n_uint neighborhood_budget = NEIGHBORHOOD_MEMORY_BUDGET;
 
 /// Provide the neighborhood two block count.
 /// - Parameter count: the count of the two blocks.
 simulated_twoblock * neighborhoood_twoblock(n_int * count)
 {
-    *count = TWO_BLOCK_NUM;
+    *count = twoblock_num;
     return twoblock;
 }
 
@@ -51,15 +75,67 @@ simulated_twoblock * neighborhoood_twoblock(n_int * count)
 /// - Parameter count: the count of the park.
 simulated_park * neighborhoood_park(n_int * count)
 {
-    *count = PARK_NUM;
+    *count = park_num;
     return park;
 }
 
+/// Provide the neighborhood grid dimensions in cells.
+/// - Parameter edge_x: the number of cells along x.
+/// - Parameter edge_y: the number of cells along y.
+void neighborhood_dimensions(n_int * edge_x, n_int * edge_y)
+{
+    *edge_x = neighborhood_edge_x;
+    *edge_y = neighborhood_edge_y;
+}
+
+/// Sets the upper limit of memory the city can take, the two blocks and parks and what is indexed from them.
+/// - Parameter bytes: the memory budget in bytes.
+void neighborhood_memory_budget(n_uint bytes)
+{
+    neighborhood_budget = bytes;
+}
+
+/// Builds the blocking matrix from the walls, windows, doors and fences of the resident cells, so the
+/// collisions and lines of sight are there whether or not anything is drawn.
+static void neighborhood_matrix(void)
+{
+    n_int loop = 0;
+    
+    matrix_init();
+    matrix_clear();
+    
+    while (loop < twoblock_num)
+    {
+        house_matrix(twoblock[loop].house);
+        fence_matrix(twoblock[loop].fence, 8);
+        loop++;
+    }
+    fence_matrix(fences, fence_num);
+}
+
+/// Frees the two blocks, parks, the road graph with its portal costs and the blocking matrix.
+void neighborhood_close(void)
+{
+    memory_free((void **)&twoblock);
+    memory_free((void **)&park);
+    memory_free((void **)&twoblock_resident);
+    memory_free((void **)&park_resident);
+    twoblock_num = 0;
+    park_num = 0;
+    fence_num = 0;
+    stream_on = 0;
+    neighborhood_edge_x = 0;
+    neighborhood_edge_y = 0;
+    matrix_close();
+    road_plan_close();
+    road_graph_close();
+}
+
 /// Provide the neighborhood fence count.
 /// - Parameter count: the count of the fences.
 simulated_fence * neighborhoood_fence(n_int * count)
 {
-    *count = FENCE_NUM;
+    *count = fence_num;
     return fences;
 }
 
@@ -70,7 +146,7 @@ void neighborhood_object(n_string file_location)
     n_object * return_object = 0L;
     n_array * created_array = 0L;
     n_int loop = 0;
-    while (loop < TWO_BLOCK_NUM)
+    while (loop < twoblock_num)
     {
         array_add_empty( &created_array, array_object(game_object_twoblock(&twoblock[loop])));
         loop++;
@@ -80,7 +156,7 @@ void neighborhood_object(n_string file_location)
     created_array = 0L;
     loop = 0;
     
-    while (loop < PARK_NUM)
+    while (loop < park_num)
     {
         array_add_empty( &created_array, array_object(game_object_park(&park[loop])));
         loop++;
@@ -114,64 +190,483 @@ void twoblock_init(n_byte2 * seed, n_vect2 * location, simulated_twoblock * twob
     fence_init(seed, twoblock->rotation, location, (simulated_fence*)&(twoblock->fence));
 }
 
+typedef struct{
+    n_byte2              seed[2];
+    n_vect2              location;
+    simulated_twoblock * twoblock;
+    simulated_park     * park;
+    n_byte               is_park;
+}neighborhood_cell;
+
+#define NEIGHBORHOOD_SEED_WARM   (2048)
+#define NEIGHBORHOOD_SEED_CYCLE  (1024)
+#define NEIGHBORHOOD_SEED_REMIX  (16)
+
+/// Whether the seed falls into a short cycle within the random numbers a cell draws. Some seeds of
+/// math_random end in a fixed point or a cycle of a few hundred values, which can leave a cell
+/// waiting on a value it will never see.
+/// - Parameter seed: the two byte random seed of the cell.
+/// - Returns: 1 if the seed reaches a short cycle, 0 otherwise.
+static n_int neighborhood_seed_short(n_byte2 * seed)
+{
+    n_byte2 walk[2];
+    n_byte2 start[2];
+    n_int   loop = 0;
+    
+    walk[0] = seed[0];
+    walk[1] = seed[1];
+    while (loop++ < NEIGHBORHOOD_SEED_WARM)
+    {
+        (void)math_random(walk);
+    }
+    start[0] = walk[0];
+    start[1] = walk[1];
+    loop = 0;
+    while (loop++ < NEIGHBORHOOD_SEED_CYCLE)
+    {
+        (void)math_random(walk);
+        if ((walk[0] == start[0]) && (walk[1] == start[1]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// Produces the seed for a single cell from the city seed and the cell's grid location. Each cell
+/// can then be generated independently of every other cell. A seed that reaches a short cycle is
+/// re-mixed with a count until it doesn't.
+/// - Parameter city_seed: two byte random seed of the city.
+/// - Parameter px: the grid x location of the cell.
+/// - Parameter py: the grid y location of the cell.
+/// - Parameter cell_seed: the two byte random seed of the cell.
+void neighborhood_seed(n_byte2 * city_seed, n_int px, n_int py, n_byte2 * cell_seed)
+{
+    n_byte  values[9];
+    n_uint  hash;
+    n_int   remix = 0;
+    
+    values[0] = city_seed[0] & 255;
+    values[1] = city_seed[0] >> 8;
+    values[2] = city_seed[1] & 255;
+    values[3] = city_seed[1] >> 8;
+    values[4] = px & 255;
+    values[5] = (px >> 8) & 255;
+    values[6] = py & 255;
+    values[7] = (py >> 8) & 255;
+    
+    do
+    {
+        values[8] = (n_byte)remix;
+        
+        hash = math_hash(values, remix ? 9 : 8);
+        
+        cell_seed[0] = (hash >> 0) & 0xffff;
+        cell_seed[1] = (hash >> 16) & 0xffff;
+        
+        math_random3(cell_seed);
+    }
+    while (neighborhood_seed_short(cell_seed) && (++remix < NEIGHBORHOOD_SEED_REMIX));
+}
+
+static n_int neighborhood_cell_execute(void * general_data, void * read_data, void * write_data)
+{
+    neighborhood_cell * cell = (neighborhood_cell *)read_data;
+    if (cell->park)
+    {
+        park_init(cell->seed, &cell->location, cell->park);
+    }
+    else
+    {
+        twoblock_init(cell->seed, &cell->location, cell->twoblock);
+    }
+    return 0;
+}
+
+/// Seeds the cell at the grid location and decides from the cell's own seed whether it is a park or
+/// a two block, so the fixed and the streaming neighborhoods agree on every cell.
+/// - Parameter city_seed: two byte random seed of the city.
+/// - Parameter px: the grid x location of the cell.
+/// - Parameter py: the grid y location of the cell.
+/// - Parameter cell: the cell seeded.
+static void neighborhood_cell_seed(n_byte2 * city_seed, n_int px, n_int py, neighborhood_cell * cell)
+{
+    neighborhood_seed(city_seed, px, py, cell->seed);
+    
+    cell->location.x = NEIGHBORHOOD_CELL_OFFSET + (px * NEIGHBORHOOD_UNIT_SPACE);
+    cell->location.y = NEIGHBORHOOD_CELL_OFFSET + (py * NEIGHBORHOOD_UNIT_SPACE);
+    cell->park = 0L;
+    cell->twoblock = 0L;
+    cell->is_park = ((math_random(cell->seed) & 255) > PARK_PROBABILITY);
+}
+
 /// Initializes the neighborhood and seeds to values into the two block which is the next level of structure combination.
+/// The park or two block layout is decided first and then each cell is generated across the thread pool from its own seed.
 /// - Parameter seed: two byte random seed.
-void neighborhood_init(n_byte2 * seed)
+/// - Parameter edge_x: the number of cells along x.
+/// - Parameter edge_y: the number of cells along y.
+n_int neighborhood_init(n_byte2 * seed, n_int edge_x, n_int edge_y)
 {
-    n_vect2 location = { 500 , 500};
+    n_int   cells_num = edge_x * edge_y;
     n_int   park_count = 0;
     n_int   twoblock_count = 0;
-    n_int   py = 0 - TWO_BLOCK_EDGE_HALF;
-    while (py < TWO_BLOCK_EDGE_HALF)
+    n_int   cell_count = 0;
+    n_int   loop = 0;
+    n_int   py = 0 - (edge_y / 2);
+    n_vect2 bottom_left, top_right;
+    neighborhood_cell * cells;
+    
+    if ((edge_x < 1) || (edge_y < 1))
+    {
+        return SHOW_ERROR("Neighborhood dimensions out of range");
+    }
+    
+    cells = memory_new(sizeof(neighborhood_cell) * (n_uint)cells_num);
+    if (cells == 0L)
+    {
+        return SHOW_ERROR("Neighborhood cells not allocated");
+    }
+    
+    while (py < (edge_y - (edge_y / 2)))
     {
-        n_int px = 0 - TWO_BLOCK_EDGE_HALF;
-        while (px < TWO_BLOCK_EDGE_HALF)
+        n_int px = 0 - (edge_x / 2);
+        while (px < (edge_x - (edge_x / 2)))
         {
-            n_vect2 additional;
-            n_byte2 park_probabilty = math_random(seed) & 255;
-            
-            additional.x = location.x + (px * NEIGHBORHOOD_UNIT_SPACE);
-            additional.y = location.y + (py * NEIGHBORHOOD_UNIT_SPACE);
+            neighborhood_cell * cell = &cells[cell_count++];
             
-            if (twoblock_count == (TWO_BLOCK_NUM))
-            {
-                park_probabilty = 255;
-            }
-            if (park_count == PARK_NUM)
-            {
-                park_probabilty = 0;
-            }
+            neighborhood_cell_seed(seed, px, py, cell);
             
-            if (park_probabilty > PARK_PROBABILITY)
+            if (cell->is_park)
             {
-                park_init(seed, &additional, &park[park_count++]);
+                park_count++;
             }
             else
             {
-                twoblock_init(seed, &additional, &twoblock[twoblock_count++]);
+                twoblock_count++;
             }
             px++;
         }
         py++;
     }
+    
+    if (((n_uint)twoblock_count * (sizeof(simulated_twoblock) + NEIGHBORHOOD_TWOBLOCK_INDEX)) + ((n_uint)park_count * sizeof(simulated_park)) > neighborhood_budget)
+    {
+        memory_free((void **)&cells);
+        return SHOW_ERROR("Neighborhood exceeds memory budget");
+    }
+    
+    neighborhood_close();
+    
+    if (twoblock_count)
+    {
+        twoblock = memory_new(sizeof(simulated_twoblock) * (n_uint)twoblock_count);
+    }
+    if (park_count)
+    {
+        park = memory_new(sizeof(simulated_park) * (n_uint)park_count);
+    }
+    
+    if (((twoblock == 0L) && twoblock_count) || ((park == 0L) && park_count))
+    {
+        memory_free((void **)&cells);
+        neighborhood_close();
+        return SHOW_ERROR("Neighborhood not allocated");
+    }
+    
+    park_count = 0;
+    twoblock_count = 0;
+    
+    while (loop < cell_count)
+    {
+        neighborhood_cell * cell = &cells[loop++];
+        if (cell->is_park)
+        {
+            cell->park = &park[park_count++];
+        }
+        else
+        {
+            cell->twoblock = &twoblock[twoblock_count++];
+        }
+    }
+    
+    execute_group(neighborhood_cell_execute, 0L, cells, cell_count, sizeof(neighborhood_cell));
+    
+    memory_free((void **)&cells);
+    
+    twoblock_num = twoblock_count;
+    park_num = park_count;
+    fence_num = FENCE_NUM;
+    neighborhood_edge_x = edge_x;
+    neighborhood_edge_y = edge_y;
+    
+    bottom_left.x = 0 - ((NEIGHBORHOOD_UNIT_SPACE * (edge_x / 2)) + CITY_EDGE_SPACE);
+    bottom_left.y = 0 - ((NEIGHBORHOOD_UNIT_SPACE * (edge_y / 2)) + CITY_EDGE_SPACE);
+    top_right.x = (NEIGHBORHOOD_UNIT_SPACE * (edge_x - (edge_x / 2))) + CITY_EDGE_SPACE;
+    top_right.y = (NEIGHBORHOOD_UNIT_SPACE * (edge_y - (edge_y / 2))) + CITY_EDGE_SPACE;
+
+    fences[0].points[0].x = bottom_left.x;
+    fences[0].points[0].y = bottom_left.y;
+    fences[0].points[1].x = top_right.x;
+    fences[0].points[1].y = bottom_left.y;
+
+    fences[1].points[0].x = top_right.x;
+    fences[1].points[0].y = bottom_left.y;
+    fences[1].points[1].x = top_right.x;
+    fences[1].points[1].y = top_right.y;
+    
+    fences[2].points[0].x = top_right.x;
+    fences[2].points[0].y = top_right.y;
+    fences[2].points[1].x = bottom_left.x;
+    fences[2].points[1].y = top_right.y;
+
+    fences[3].points[0].x = bottom_left.x;
+    fences[3].points[0].y = top_right.y;
+    fences[3].points[1].x = bottom_left.x;
+    fences[3].points[1].y = bottom_left.y;
+    
+    neighborhood_matrix();
+    
+    return road_graph_build();
+}
+
+/// Starts the streaming neighborhood. Rather than generating every cell up front, only the cells
+/// within the radius of the agent are resident and the least recently used cells are evicted as the
+/// agent moves. As each cell is generated from its own seed, an evicted cell regenerates identically.
+/// - Parameter seed: two byte random seed.
+/// - Parameter radius: the number of cells generated either side of the agent's cell.
+n_int neighborhood_stream_init(n_byte2 * seed, n_int radius)
+{
+    n_int edge = (radius * 2) + 1;
+    n_int capacity = edge * edge * 2;
+    
+    if (radius < 0)
+    {
+        return SHOW_ERROR("Neighborhood stream radius out of range");
+    }
+    
+    if (((n_uint)capacity * (sizeof(simulated_twoblock) + NEIGHBORHOOD_TWOBLOCK_INDEX + sizeof(simulated_park) + (2 * sizeof(neighborhood_resident)))) > neighborhood_budget)
+    {
+        return SHOW_ERROR("Neighborhood stream exceeds memory budget");
+    }
+    
+    neighborhood_close();
+    
+    twoblock = memory_new(sizeof(simulated_twoblock) * (n_uint)capacity);
+    park = memory_new(sizeof(simulated_park) * (n_uint)capacity);
+    twoblock_resident = memory_new(sizeof(neighborhood_resident) * (n_uint)capacity);
+    park_resident = memory_new(sizeof(neighborhood_resident) * (n_uint)capacity);
+    
+    if ((twoblock == 0L) || (park == 0L) || (twoblock_resident == 0L) || (park_resident == 0L))
+    {
+        neighborhood_close();
+        return SHOW_ERROR("Neighborhood stream not allocated");
+    }
+    
+    stream_seed[0] = seed[0];
+    stream_seed[1] = seed[1];
+    stream_radius = radius;
+    stream_capacity = capacity;
+    stream_time = 0;
+    stream_on = 1;
+    
+    neighborhood_edge_x = edge;
+    neighborhood_edge_y = edge;
+    return 0;
+}
 
-    fences[0].points[0].x = CITY_BOTTOM_LEFT_X;
-    fences[0].points[0].y = CITY_BOTTOM_LEFT_Y;
-    fences[0].points[1].x = CITY_TOP_RIGHT_X;
-    fences[0].points[1].y = CITY_BOTTOM_LEFT_Y;
+static n_int neighborhood_stream_find(neighborhood_resident * resident, n_int count, n_int px, n_int py)
+{
+    n_int loop = 0;
+    while (loop < count)
+    {
+        if ((resident[loop].px == px) && (resident[loop].py == py))
+        {
+            return loop;
+        }
+        loop++;
+    }
+    return -1;
+}
 
-    fences[1].points[0].x = CITY_TOP_RIGHT_X;
-    fences[1].points[0].y = CITY_BOTTOM_LEFT_Y;
-    fences[1].points[1].x = CITY_TOP_RIGHT_X;
-    fences[1].points[1].y = CITY_TOP_RIGHT_Y;
+/// Removes the least recently used cell that wasn't touched in this cycle, with the road portal costs
+/// around it.
+static n_int neighborhood_stream_evict(neighborhood_resident * resident, n_byte * cells, n_int * count, n_uint cell_size)
+{
+    n_int  loop = 0;
+    n_int  oldest = -1;
+    n_int  last = (*count) - 1;
     
-    fences[2].points[0].x = CITY_TOP_RIGHT_X;
-    fences[2].points[0].y = CITY_TOP_RIGHT_Y;
-    fences[2].points[1].x = CITY_BOTTOM_LEFT_X;
-    fences[2].points[1].y = CITY_TOP_RIGHT_Y;
+    while (loop < *count)
+    {
+        if (resident[loop].used != stream_time)
+        {
+            if ((oldest == -1) || (resident[loop].used < resident[oldest].used))
+            {
+                oldest = loop;
+            }
+        }
+        loop++;
+    }
+    if (oldest == -1)
+    {
+        return 0;
+    }
+    road_plan_invalidate(resident[oldest].px, resident[oldest].py);
+    if (oldest != last)
+    {
+        resident[oldest] = resident[last];
+        memory_copy(&cells[(n_uint)last * cell_size], &cells[(n_uint)oldest * cell_size], cell_size);
+    }
+    *count = last;
+    return 1;
+}
+
+/// Touches the resident cell at the grid location.
+/// - Returns: 1 if the cell is resident, 0 otherwise.
+static n_int neighborhood_stream_touch(n_int px, n_int py)
+{
+    n_int found = neighborhood_stream_find(twoblock_resident, twoblock_num, px, py);
+    if (found != -1)
+    {
+        twoblock_resident[found].used = stream_time;
+        return 1;
+    }
+    found = neighborhood_stream_find(park_resident, park_num, px, py);
+    if (found != -1)
+    {
+        park_resident[found].used = stream_time;
+        return 1;
+    }
+    return 0;
+}
+
+/// The grid location of the cell covering a world coordinate, the cells start at the cell offset.
+/// - Parameter value: the world coordinate.
+/// - Returns: the grid location along that axis.
+static n_int neighborhood_cell_grid(n_int value)
+{
+    n_int offset = value - NEIGHBORHOOD_CELL_OFFSET;
+    n_int grid = offset / NEIGHBORHOOD_UNIT_SPACE;
+    if ((offset < 0) && ((offset % NEIGHBORHOOD_UNIT_SPACE) != 0))
+    {
+        grid--;
+    }
+    return grid;
+}
 
-    fences[3].points[0].x = CITY_BOTTOM_LEFT_X;
-    fences[3].points[0].y = CITY_TOP_RIGHT_Y;
-    fences[3].points[1].x = CITY_BOTTOM_LEFT_X;
-    fences[3].points[1].y = CITY_BOTTOM_LEFT_Y;
+/// Brings the cells around the location into the resident set. The road portal costs around each cell
+/// generated or evicted are dropped, so road_plan finds them again from the new graph.
+/// - Parameter location: the location the cells are streamed around, usually the agent location.
+/// - Returns: 1 if the resident cells changed, 0 otherwise.
+n_int neighborhood_stream_cycle(n_vect2 * location)
+{
+    n_int   edge = (stream_radius * 2) + 1;
+    n_int   cx, cy, px, py;
+    n_int   loop;
+    n_int   missing_twoblock = 0;
+    n_int   missing_park = 0;
+    n_int   cell_count = 0;
+    neighborhood_cell * cells;
+    
+    if (stream_on == 0)
+    {
+        return 0;
+    }
+    
+    cx = neighborhood_cell_grid(location->x);
+    cy = neighborhood_cell_grid(location->y);
+    
+    if ((stream_time != 0) && (cx == stream_center.x) && (cy == stream_center.y))
+    {
+        return 0;
+    }
+    
+    cells = memory_new(sizeof(neighborhood_cell) * (n_uint)(edge * edge));
+    if (cells == 0L)
+    {
+        return SHOW_ERROR("Neighborhood stream cells not allocated");
+    }
+    
+    stream_time++;
+    stream_center.x = cx;
+    stream_center.y = cy;
+    
+    /* touch the resident cells and seed the missing ones */
+    
+    for (py = cy - stream_radius; py <= (cy + stream_radius); py++)
+    {
+        for (px = cx - stream_radius; px <= (cx + stream_radius); px++)
+        {
+            if (neighborhood_stream_touch(px, py) == 0)
+            {
+                neighborhood_cell * cell = &cells[cell_count++];
+                
+                neighborhood_cell_seed(stream_seed, px, py, cell);
+                
+                if (cell->is_park)
+                {
+                    missing_park++;
+                }
+                else
+                {
+                    missing_twoblock++;
+                }
+            }
+        }
+    }
+    
+    /* make room, the cells touched in this cycle are never evicted */
+    
+    while ((twoblock_num + missing_twoblock) > stream_capacity)
+    {
+        if (neighborhood_stream_evict(twoblock_resident, (n_byte *)twoblock, &twoblock_num, sizeof(simulated_twoblock)) == 0)
+        {
+            break;
+        }
+    }
+    while ((park_num + missing_park) > stream_capacity)
+    {
+        if (neighborhood_stream_evict(park_resident, (n_byte *)park, &park_num, sizeof(simulated_park)) == 0)
+        {
+            break;
+        }
+    }
+    
+    /* assign the slots */
+    
+    loop = 0;
+    while (loop < cell_count)
+    {
+        neighborhood_cell * cell = &cells[loop++];
+        neighborhood_resident * resident;
+        
+        if (cell->is_park)
+        {
+            resident = &park_resident[park_num];
+            cell->park = &park[park_num++];
+            memory_erase((n_byte *)cell->park, sizeof(simulated_park));
+        }
+        else
+        {
+            resident = &twoblock_resident[twoblock_num];
+            cell->twoblock = &twoblock[twoblock_num++];
+            memory_erase((n_byte *)cell->twoblock, sizeof(simulated_twoblock));
+        }
+        resident->px = neighborhood_cell_grid(cell->location.x);
+        resident->py = neighborhood_cell_grid(cell->location.y);
+        resident->used = stream_time;
+        road_plan_invalidate(resident->px, resident->py);
+    }
+    
+    execute_group(neighborhood_cell_execute, 0L, cells, cell_count, sizeof(neighborhood_cell));
+    
+    memory_free((void **)&cells);
+    
+    if (cell_count > 0)
+    {
+        neighborhood_matrix();
+        (void)road_graph_build();
+    }
+    
+    return (cell_count > 0);
 }
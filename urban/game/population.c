@@ -0,0 +1,381 @@
+/****************************************************************
+ 
+ population.c
+ 
+ =============================================================
+ 
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+ 
+ ****************************************************************/
+
+#include "mushroom.h"
+#include "toolkit.h"
+
+// Agents are hashed into square cells for the neighbor lookups
+#define POPULATION_HASH_CELL     (256)
+#define POPULATION_HASH_MINIMUM  (1024)
+
+// Agents in each job of the threaded cycle
+#define POPULATION_CHUNK         (2048)
+
+// How far an agent walks in a cycle and how close it comes to another before turning away
+#define POPULATION_SPEED         (8)
+#define POPULATION_SPACE         (48)
+
+// The population is stored as one array for each value, each agent is an index into the arrays
+static n_int    population_count = 0;
+static n_c_int *population_x = 0L;
+static n_c_int *population_y = 0L;
+static n_c_int *population_delta_x = 0L;
+static n_c_int *population_delta_y = 0L;
+static n_byte  *population_facing_list = 0L;
+static n_byte  *population_state_list = 0L;
+static n_byte2 *population_seed = 0L;
+
+// The spatial hash, a copy of the agent locations sorted by bucket. The cycle reads the neighbors
+// from this copy while the agents move, so the result doesn't depend on the order the jobs run in.
+static n_int    hash_mask = 0;
+static n_int   *hash_start = 0L;
+static n_int   *hash_agent = 0L;
+static n_c_int *hash_x = 0L;
+static n_c_int *hash_y = 0L;
+
+typedef struct {
+    n_int start;
+    n_int end;
+} population_chunk;
+
+static n_int population_cell(n_int value) {
+    if (value < 0) {
+        return ((value + 1) / POPULATION_HASH_CELL) - 1;
+    }
+    return value / POPULATION_HASH_CELL;
+}
+
+static n_int population_bucket(n_int cell_x, n_int cell_y) {
+    n_uint hash = ((n_uint)cell_x * 73856093) ^ ((n_uint)cell_y * 19349663);
+    return (n_int)(hash & (n_uint)hash_mask);
+}
+
+// Sorts the agent locations into the buckets, a counting sort so it is linear in the population
+static void population_hash(void) {
+    n_int loop = 0;
+
+    memory_erase((n_byte *)hash_start, sizeof(n_int) * (n_uint)(hash_mask + 2));
+
+    while (loop < population_count) {
+        n_int bucket = population_bucket(population_cell(population_x[loop]), population_cell(population_y[loop]));
+        hash_start[bucket + 1]++;
+        loop++;
+    }
+    loop = 0;
+    while (loop <= hash_mask) {
+        hash_start[loop + 1] += hash_start[loop];
+        loop++;
+    }
+    loop = 0;
+    while (loop < population_count) {
+        n_int bucket = population_bucket(population_cell(population_x[loop]), population_cell(population_y[loop]));
+        n_int position = hash_start[bucket]++;
+        hash_agent[position] = loop;
+        hash_x[position] = population_x[loop];
+        hash_y[position] = population_y[loop];
+        loop++;
+    }
+    // the fill moved each start to the next bucket's start
+    loop = hash_mask;
+    while (loop > 0) {
+        hash_start[loop] = hash_start[loop - 1];
+        loop--;
+    }
+    hash_start[0] = 0;
+}
+
+// The nearest other agent within the radius, -1 if there is none
+static n_int population_nearest(n_int agent, n_int x, n_int y, n_int radius, n_vect2 *offset) {
+    n_int cell_left = population_cell(x - radius);
+    n_int cell_right = population_cell(x + radius);
+    n_int cell_top = population_cell(y - radius);
+    n_int cell_bottom = population_cell(y + radius);
+    n_int best = (radius * radius) + 1;
+    n_int best_agent = -1;
+    n_int cell_y = cell_top;
+
+    while (cell_y <= cell_bottom) {
+        n_int cell_x = cell_left;
+        while (cell_x <= cell_right) {
+            n_int bucket = population_bucket(cell_x, cell_y);
+            n_int loop = hash_start[bucket];
+            n_int end = hash_start[bucket + 1];
+            while (loop < end) {
+                n_int dx = hash_x[loop] - x;
+                n_int dy = hash_y[loop] - y;
+                n_int distance = (dx * dx) + (dy * dy);
+                if ((distance < best) && (hash_agent[loop] != agent)) {
+                    best = distance;
+                    best_agent = hash_agent[loop];
+                    offset->x = dx;
+                    offset->y = dy;
+                }
+                loop++;
+            }
+            cell_x++;
+        }
+        cell_y++;
+    }
+    return best_agent;
+}
+
+// Walks one agent. Agents wander, rest now and then, turn away from the nearest agent in their
+// personal space and turn around when a wall stops them.
+static void population_agent_cycle(n_int agent) {
+    n_byte2 *seed = &population_seed[agent * 2];
+    n_vect2 location, direction, step, offset;
+    n_int facing = population_facing_list[agent];
+    n_byte2 random = math_random(seed);
+
+    population_delta_x[agent] = 0;
+    population_delta_y[agent] = 0;
+
+    if (population_state_list[agent]) {
+        population_state_list[agent]--;
+        return;
+    }
+    if ((random & 1023) == 0) {
+        population_state_list[agent] = (n_byte)(16 + ((random >> 10) & 63));
+        return;
+    }
+    if ((random & 15) == 0) {
+        facing += (n_int)((random >> 4) & 31) - 16;
+    }
+
+    location.x = population_x[agent];
+    location.y = population_y[agent];
+
+    vect2_direction(&direction, (128 + 64 + 256 - facing) & 255, 1);
+
+    if (population_nearest(agent, location.x, location.y, POPULATION_SPACE, &offset) != -1) {
+        // turn away from the side the other agent is on
+        n_int side = (direction.x * offset.y) - (direction.y * offset.x);
+        facing += (side > 0) ? 16 : -16;
+        vect2_direction(&direction, (128 + 64 + 256 - facing) & 255, 1);
+    }
+
+    step.x = (direction.x * POPULATION_SPEED) / 26880;
+    step.y = (direction.y * POPULATION_SPEED) / 26880;
+
+    matrix_move(&location, &step);
+
+    population_delta_x[agent] = (n_c_int)(location.x - population_x[agent]);
+    population_delta_y[agent] = (n_c_int)(location.y - population_y[agent]);
+
+    if ((population_delta_x[agent] == 0) && (population_delta_y[agent] == 0)) {
+        facing += 64 + (math_random(seed) & 127);
+    }
+
+    population_x[agent] = (n_c_int)location.x;
+    population_y[agent] = (n_c_int)location.y;
+    population_facing_list[agent] = (n_byte)(facing & 255);
+}
+
+static n_int population_chunk_execute(void *general_data, void *read_data, void *write_data) {
+    population_chunk *chunk = (population_chunk *)read_data;
+    n_int loop = chunk->start;
+    while (loop < chunk->end) {
+        population_agent_cycle(loop++);
+    }
+    return 0;
+}
+
+void population_close(void) {
+    memory_free((void **)&population_x);
+    memory_free((void **)&population_y);
+    memory_free((void **)&population_delta_x);
+    memory_free((void **)&population_delta_y);
+    memory_free((void **)&population_facing_list);
+    memory_free((void **)&population_state_list);
+    memory_free((void **)&population_seed);
+    memory_free((void **)&hash_start);
+    memory_free((void **)&hash_agent);
+    memory_free((void **)&hash_x);
+    memory_free((void **)&hash_y);
+    population_count = 0;
+    hash_mask = 0;
+}
+
+// Places the agents over the square around the center. Each agent has its own seed taken from the
+// population seed, so the population walks the same way however many threads run the cycle.
+n_int population_init(n_byte2 *seed, n_int count, n_vect2 *center, n_int radius) {
+    n_byte2 local[2];
+    n_int buckets = POPULATION_HASH_MINIMUM;
+    n_int loop = 0;
+
+    population_close();
+
+    if ((count < 1) || (radius < 1)) {
+        return 0;
+    }
+    while (buckets < count) {
+        buckets <<= 1;
+    }
+
+    population_x = memory_new(sizeof(n_c_int) * (n_uint)count);
+    population_y = memory_new(sizeof(n_c_int) * (n_uint)count);
+    population_delta_x = memory_new(sizeof(n_c_int) * (n_uint)count);
+    population_delta_y = memory_new(sizeof(n_c_int) * (n_uint)count);
+    population_facing_list = memory_new((n_uint)count);
+    population_state_list = memory_new((n_uint)count);
+    population_seed = memory_new(sizeof(n_byte2) * 2 * (n_uint)count);
+    hash_start = memory_new(sizeof(n_int) * (n_uint)(buckets + 1));
+    hash_agent = memory_new(sizeof(n_int) * (n_uint)count);
+    hash_x = memory_new(sizeof(n_c_int) * (n_uint)count);
+    hash_y = memory_new(sizeof(n_c_int) * (n_uint)count);
+
+    if ((population_x == 0L) || (population_y == 0L) || (population_delta_x == 0L) || (population_delta_y == 0L) ||
+        (population_facing_list == 0L) || (population_state_list == 0L) || (population_seed == 0L) ||
+        (hash_start == 0L) || (hash_agent == 0L) || (hash_x == 0L) || (hash_y == 0L)) {
+        population_close();
+        return SHOW_ERROR("Population not allocated");
+    }
+
+    local[0] = seed[0];
+    local[1] = seed[1];
+
+    while (loop < count) {
+        n_byte2 *agent_seed = &population_seed[loop * 2];
+        n_uint x, y;
+        agent_seed[0] = math_random(local);
+        agent_seed[1] = math_random(local);
+        (void)math_random(agent_seed);
+
+        x = ((n_uint)math_random(agent_seed) << 16) | math_random(agent_seed);
+        y = ((n_uint)math_random(agent_seed) << 16) | math_random(agent_seed);
+
+        population_x[loop] = (n_c_int)(center->x - radius + (n_int)(x % (n_uint)((radius * 2) + 1)));
+        population_y[loop] = (n_c_int)(center->y - radius + (n_int)(y % (n_uint)((radius * 2) + 1)));
+        population_delta_x[loop] = 0;
+        population_delta_y[loop] = 0;
+        population_facing_list[loop] = (n_byte)(math_random(agent_seed) & 255);
+        population_state_list[loop] = 0;
+        loop++;
+    }
+
+    population_count = count;
+    hash_mask = buckets - 1;
+    population_hash();
+    return 0;
+}
+
+// Walks every agent in chunks spread over the threads then hashes the new locations
+void population_cycle(void) {
+    population_chunk *chunks;
+    n_int groups, loop = 0;
+
+    if (population_count == 0) {
+        return;
+    }
+
+    groups = (population_count + POPULATION_CHUNK - 1) / POPULATION_CHUNK;
+    chunks = memory_new(sizeof(population_chunk) * (n_uint)groups);
+    if (chunks == 0L) {
+        return;
+    }
+    while (loop < groups) {
+        chunks[loop].start = loop * POPULATION_CHUNK;
+        chunks[loop].end = chunks[loop].start + POPULATION_CHUNK;
+        if (chunks[loop].end > population_count) {
+            chunks[loop].end = population_count;
+        }
+        loop++;
+    }
+
+    execute_group(population_chunk_execute, 0L, chunks, groups, sizeof(population_chunk));
+
+    memory_free((void **)&chunks);
+
+    population_hash();
+}
+
+n_int population_number(void) {
+    return population_count;
+}
+
+void population_location(n_int agent, n_vect2 *location) {
+    location->x = population_x[agent];
+    location->y = population_y[agent];
+}
+
+void population_delta(n_int agent, n_vect2 *delta) {
+    delta->x = population_delta_x[agent];
+    delta->y = population_delta_y[agent];
+}
+
+n_byte population_facing(n_int agent) {
+    return population_facing_list[agent];
+}
+
+n_byte population_state(n_int agent) {
+    return population_state_list[agent];
+}
+
+// Adds the agents within the radius of the center to the list, the cells around the center are
+// looked up in the spatial hash so only the nearby agents are checked
+void population_nearby(n_vect2 *center, n_int radius, int_list *found) {
+    n_int cell_left, cell_right, cell_top, cell_bottom, cell_y;
+
+    if ((population_count == 0) || (found == 0L) || (radius < 0)) {
+        return;
+    }
+
+    cell_left = population_cell(center->x - radius);
+    cell_right = population_cell(center->x + radius);
+    cell_top = population_cell(center->y - radius);
+    cell_bottom = population_cell(center->y + radius);
+
+    cell_y = cell_top;
+    while (cell_y <= cell_bottom) {
+        n_int cell_x = cell_left;
+        while (cell_x <= cell_right) {
+            n_int bucket = population_bucket(cell_x, cell_y);
+            n_int loop = hash_start[bucket];
+            n_int end = hash_start[bucket + 1];
+            while (loop < end) {
+                n_int dx = hash_x[loop] - center->x;
+                n_int dy = hash_y[loop] - center->y;
+                // cells that share the bucket are skipped so each agent is only added once
+                if ((population_cell(hash_x[loop]) == cell_x) && (population_cell(hash_y[loop]) == cell_y) &&
+                    (((dx * dx) + (dy * dy)) <= (radius * radius))) {
+                    int_list_copy(found, hash_agent[loop]);
+                }
+                loop++;
+            }
+            cell_x++;
+        }
+        cell_y++;
+    }
+}
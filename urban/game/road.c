@@ -0,0 +1,1850 @@
+/****************************************************************
+ 
+ road.c
+ 
+ =============================================================
+ 
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+ 
+ ****************************************************************/
+
+#include "mushroom.h"
+#include "toolkit.h"
+
+#include <stdlib.h>
+
+// Nodes are looked up by location through a grid with a bucket for every cell the graph covers
+#define ROAD_GRAPH_CELL      (1024)
+
+#define ROAD_UNREACHED       (0x7fffffff)
+
+// Landmarks at the corners and the middles of the sides of the graph, in halves of each side
+#define ROAD_LANDMARKS       (8)
+
+static const n_byte road_landmark_side[ROAD_LANDMARKS][2] = {
+    {0, 0}, {1, 0}, {2, 0}, {2, 1}, {2, 2}, {1, 2}, {0, 2}, {0, 1}
+};
+
+// A road or footpath rectangle and the line down its middle, which is where the graph runs
+typedef struct {
+    n_int min_x, min_y;
+    n_int max_x, max_y;
+    n_int middle;
+    n_int group;
+    n_byte vertical;
+} road_rect;
+
+// A location on the middle line of a rectangle that becomes a node
+typedef struct {
+    n_int rect;
+    n_int x, y;
+    n_int node;
+} road_stop;
+
+// Two locations joined where rectangles meet
+typedef struct {
+    n_int start_x, start_y;
+    n_int end_x, end_y;
+} road_link;
+
+typedef struct {
+    n_int from;
+    n_int to;
+    n_int cost;
+} road_edge;
+
+typedef struct {
+    n_int *nodes;
+    n_int *position;
+    n_int *key;
+    n_int count;
+} road_heap;
+
+// A search inside a single block, by the place of each node in the block
+typedef struct {
+    n_int capacity;
+    n_int *cost;
+    n_int *parent;
+    road_heap heap;
+} road_local;
+
+struct road_search {
+    n_int capacity;
+    n_int *cost;
+    n_int *estimate;
+    n_int *parent;
+    n_uint *seen;
+    n_uint *closed;
+    n_uint generation;
+    road_heap heap;
+    // road_plan searches the sides of the portals with its own search, from the start and to the end
+    // inside their blocks and fills the portal costs of blocks as it reaches them
+    road_search *portals;
+    road_local start;
+    road_local end;
+    road_local fill;
+};
+
+// The costs between the sides of the portals of a block. The nodes of the block are named by their
+// place in the block, so the costs outlast the graph being built again from the same cells.
+typedef struct {
+    n_int nodes;
+    n_int sides;
+    n_c_int *entry;     // the place of the node of each side
+    n_c_int *cost;      // from each side to each side inside the block, -1 if there is no way
+    n_c_int *parent;    // from each side, the place every node of the block is reached from
+} road_portal_cache;
+
+// The portal costs are kept by the location of the block
+typedef struct {
+    n_int block_x, block_y;
+    n_byte used;
+    road_portal_cache *cache;
+} road_cache_slot;
+
+// The blocks are the cells of the neighborhood. A node is in the block its location is in and the
+// nodes of each block are listed together in the order of the graph.
+typedef struct {
+    n_int block_x, block_y;
+    n_int first;
+    n_int count;
+    n_int side_first;
+    n_int sides;
+    road_portal_cache *cache;
+} road_block;
+
+// A portal joins two neighboring blocks. Every road crossing between the two is merged into the one
+// entrance, the crossing edge nearest the middle of them. The portal has a side in each block, the
+// node of the crossing edge in that block.
+typedef struct {
+    n_int node[2];
+    n_int block[2];
+    n_int cost;
+} road_portal;
+
+// A road crossing between two blocks, with the blocks in order
+typedef struct {
+    n_int block[2];
+    n_int node[2];
+    n_int cost;
+    n_int middle_x, middle_y;
+} road_crossing;
+
+// The graph, nodes sorted by location with their edges in one array
+static n_int road_node_count = 0;
+static n_c_int *road_node_x = 0L;
+static n_c_int *road_node_y = 0L;
+static n_int *road_edge_start = 0L;
+static n_c_int *road_edge_to = 0L;
+static n_c_int *road_edge_cost = 0L;
+static n_c_int *road_component = 0L;
+
+// Distances from each landmark, the landmarks of a node are next to each other
+static n_c_int *road_landmark = 0L;
+
+static n_int *road_bucket_start = 0L;
+static n_int *road_bucket_node = 0L;
+static n_int road_bucket_width = 0;
+static n_int road_cell_low_x, road_cell_low_y;
+static n_int road_cell_high_x, road_cell_high_y;
+
+// The blocks and the portals between them, the sides of the portals of each block are listed together
+static n_int road_block_count = 0;
+static n_int road_block_largest = 0;
+static road_block *road_blocks = 0L;
+static n_int *road_block_node = 0L;
+static n_c_int *road_node_block = 0L;
+static n_c_int *road_node_place = 0L;
+static n_int road_portal_count = 0;
+static road_portal *road_portals = 0L;
+// the landmark distances of both nodes of each portal together, the portal search reads nothing else
+static n_c_int *road_portal_landmark = 0L;
+static n_int *road_block_side = 0L;
+static n_c_int *road_side_place = 0L;
+
+static road_cache_slot *road_cache = 0L;
+static n_int road_cache_size = 0;
+static n_int road_cache_used = 0;
+
+static n_int road_cell(n_int value) {
+    if (value < 0) {
+        return ((value + 1) / ROAD_GRAPH_CELL) - 1;
+    }
+    return value / ROAD_GRAPH_CELL;
+}
+
+// The cell must be within the cells the graph covers
+static n_int road_bucket(n_int cell_x, n_int cell_y) {
+    return ((cell_y - road_cell_low_y) * road_bucket_width) + (cell_x - road_cell_low_x);
+}
+
+static n_int road_clamp(n_int value, n_int low, n_int high) {
+    if (value < low) {
+        return low;
+    }
+    if (value > high) {
+        return high;
+    }
+    return value;
+}
+
+static n_int road_distance(n_int dx, n_int dy) {
+    return (n_int)math_root((n_uint)((dx * dx) + (dy * dy)));
+}
+
+static void road_heap_swap(road_heap *heap, n_int first, n_int second) {
+    n_int temp = heap->nodes[first];
+    heap->nodes[first] = heap->nodes[second];
+    heap->nodes[second] = temp;
+    heap->position[heap->nodes[first]] = first;
+    heap->position[heap->nodes[second]] = second;
+}
+
+static void road_heap_fix(road_heap *heap, n_int location) {
+    while ((location > 0) && (heap->key[heap->nodes[location]] < heap->key[heap->nodes[(location - 1) / 2]])) {
+        road_heap_swap(heap, location, (location - 1) / 2);
+        location = (location - 1) / 2;
+    }
+    while (1) {
+        n_int child = (location * 2) + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (((child + 1) < heap->count) && (heap->key[heap->nodes[child + 1]] < heap->key[heap->nodes[child]])) {
+            child++;
+        }
+        if (heap->key[heap->nodes[child]] >= heap->key[heap->nodes[location]]) {
+            break;
+        }
+        road_heap_swap(heap, location, child);
+        location = child;
+    }
+}
+
+static void road_heap_push(road_heap *heap, n_int node) {
+    heap->nodes[heap->count] = node;
+    heap->position[node] = heap->count;
+    heap->count++;
+    road_heap_fix(heap, heap->count - 1);
+}
+
+static n_int road_heap_pop(road_heap *heap) {
+    n_int node = heap->nodes[0];
+    heap->count--;
+    if (heap->count) {
+        heap->nodes[0] = heap->nodes[heap->count];
+        heap->position[heap->nodes[0]] = 0;
+        road_heap_fix(heap, 0);
+    }
+    return node;
+}
+
+static int road_compare_stop_location(const void *a, const void *b) {
+    const road_stop *first = (const road_stop *)a;
+    const road_stop *second = (const road_stop *)b;
+    if (first->x != second->x) {
+        return (first->x < second->x) ? -1 : 1;
+    }
+    if (first->y != second->y) {
+        return (first->y < second->y) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int road_compare_stop_rect(const void *a, const void *b) {
+    const road_stop *first = (const road_stop *)a;
+    const road_stop *second = (const road_stop *)b;
+    if (first->rect != second->rect) {
+        return (first->rect < second->rect) ? -1 : 1;
+    }
+    return road_compare_stop_location(a, b);
+}
+
+static int road_compare_rect(const void *a, const void *b) {
+    const road_rect *first = (const road_rect *)a;
+    const road_rect *second = (const road_rect *)b;
+    if (first->min_x != second->min_x) {
+        return (first->min_x < second->min_x) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void road_add_group(memory_list *rects, simulated_path_group *group, n_int group_number) {
+    n_int loop = 0;
+    while (loop < group->number) {
+        n_vect2 *points = group->paths[loop].points;
+        road_rect rect;
+        n_int corner = 1;
+        rect.min_x = rect.max_x = points[0].x;
+        rect.min_y = rect.max_y = points[0].y;
+        while (corner < POINTS_PER_PATH) {
+            if (points[corner].x < rect.min_x) rect.min_x = points[corner].x;
+            if (points[corner].x > rect.max_x) rect.max_x = points[corner].x;
+            if (points[corner].y < rect.min_y) rect.min_y = points[corner].y;
+            if (points[corner].y > rect.max_y) rect.max_y = points[corner].y;
+            corner++;
+        }
+        rect.vertical = ((rect.max_y - rect.min_y) > (rect.max_x - rect.min_x));
+        rect.middle = rect.vertical ? ((rect.min_x + rect.max_x) / 2) : ((rect.min_y + rect.max_y) / 2);
+        rect.group = group_number;
+        memory_list_copy(rects, (n_byte *)&rect, sizeof(road_rect));
+        loop++;
+    }
+}
+
+static void road_add_stop(memory_list *stops, n_int rect, n_int x, n_int y) {
+    road_stop stop;
+    stop.rect = rect;
+    stop.x = x;
+    stop.y = y;
+    stop.node = -1;
+    memory_list_copy(stops, (n_byte *)&stop, sizeof(road_stop));
+}
+
+static void road_add_link(memory_list *links, n_int start_x, n_int start_y, n_int end_x, n_int end_y) {
+    road_link link;
+    if ((start_x == end_x) && (start_y == end_y)) {
+        return;
+    }
+    link.start_x = start_x;
+    link.start_y = start_y;
+    link.end_x = end_x;
+    link.end_y = end_y;
+    memory_list_copy(links, (n_byte *)&link, sizeof(road_link));
+}
+
+static void road_add_edge(memory_list *edges, n_int from, n_int to) {
+    road_edge edge;
+    if ((from == to) || (from < 0) || (to < 0)) {
+        return;
+    }
+    edge.from = from;
+    edge.to = to;
+    edge.cost = road_distance(road_node_x[to] - road_node_x[from], road_node_y[to] - road_node_y[from]);
+    memory_list_copy(edges, (n_byte *)&edge, sizeof(road_edge));
+}
+
+// Where a rectangle running one way meets a rectangle running the other way, the middle lines are
+// joined at the nearest points on each. Where they cross these are the same point.
+static void road_meet_across(memory_list *stops, memory_list *links, road_rect *rects, n_int horizontal, n_int vertical) {
+    n_int x = road_clamp(rects[vertical].middle, rects[horizontal].min_x, rects[horizontal].max_x);
+    n_int y = road_clamp(rects[horizontal].middle, rects[vertical].min_y, rects[vertical].max_y);
+    road_add_stop(stops, horizontal, x, rects[horizontal].middle);
+    road_add_stop(stops, vertical, rects[vertical].middle, y);
+    road_add_link(links, x, rects[horizontal].middle, rects[vertical].middle, y);
+}
+
+// Side by side rectangles, such as the footpaths of neighboring cells, are joined at each stop of one
+// that is alongside the other
+static void road_meet_along(memory_list *stops, memory_list *links, road_rect *rects, n_int from, n_int to,
+                            n_int first_stop, n_int last_stop) {
+    road_stop *stop = (road_stop *)stops->data;
+    n_int low = rects[from].vertical ? rects[to].min_y : rects[to].min_x;
+    n_int high = rects[from].vertical ? rects[to].max_y : rects[to].max_x;
+    n_int loop = first_stop;
+    while (loop < last_stop) {
+        // adding a stop can move the stops
+        n_int x = stop[loop].x;
+        n_int y = stop[loop].y;
+        n_int along = rects[from].vertical ? y : x;
+        if ((along >= low) && (along <= high)) {
+            if (rects[from].vertical) {
+                road_add_stop(stops, to, rects[to].middle, along);
+                road_add_link(links, x, along, rects[to].middle, along);
+            } else {
+                road_add_stop(stops, to, along, rects[to].middle);
+                road_add_link(links, along, y, along, rects[to].middle);
+            }
+            stop = (road_stop *)stops->data;
+        }
+        loop++;
+    }
+}
+
+static n_int road_node_find(n_int x, n_int y) {
+    n_int low = 0;
+    n_int high = road_node_count - 1;
+    while (low <= high) {
+        n_int middle = (low + high) / 2;
+        if ((road_node_x[middle] < x) || ((road_node_x[middle] == x) && (road_node_y[middle] < y))) {
+            low = middle + 1;
+        } else if ((road_node_x[middle] == x) && (road_node_y[middle] == y)) {
+            return middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    n_int source;
+    n_c_int *distance;
+} road_landmark_job;
+
+// Distances from the source to every node
+static n_int road_landmark_execute(void *general_data, void *read_data, void *write_data) {
+    road_landmark_job *job = (road_landmark_job *)read_data;
+    road_heap heap;
+    n_int loop = 0;
+
+    heap.nodes = memory_new(sizeof(n_int) * (n_uint)road_node_count);
+    heap.position = memory_new(sizeof(n_int) * (n_uint)road_node_count);
+    heap.key = memory_new(sizeof(n_int) * (n_uint)road_node_count);
+    heap.count = 0;
+
+    if ((heap.nodes == 0L) || (heap.position == 0L) || (heap.key == 0L)) {
+        memory_free((void **)&heap.nodes);
+        memory_free((void **)&heap.position);
+        memory_free((void **)&heap.key);
+        return SHOW_ERROR("Road landmark not allocated");
+    }
+
+    while (loop < road_node_count) {
+        heap.key[loop] = ROAD_UNREACHED;
+        heap.position[loop] = -1;
+        loop++;
+    }
+    heap.key[job->source] = 0;
+    road_heap_push(&heap, job->source);
+
+    while (heap.count) {
+        n_int node = road_heap_pop(&heap);
+        n_int edge = road_edge_start[node];
+        while (edge < road_edge_start[node + 1]) {
+            n_int to = road_edge_to[edge];
+            n_int cost = heap.key[node] + road_edge_cost[edge];
+            if (cost < heap.key[to]) {
+                heap.key[to] = cost;
+                if (heap.position[to] == -1) {
+                    road_heap_push(&heap, to);
+                } else {
+                    road_heap_fix(&heap, heap.position[to]);
+                }
+            }
+            edge++;
+        }
+        heap.position[node] = -1;
+    }
+
+    loop = 0;
+    while (loop < road_node_count) {
+        job->distance[loop] = (n_c_int)heap.key[loop];
+        loop++;
+    }
+
+    memory_free((void **)&heap.nodes);
+    memory_free((void **)&heap.position);
+    memory_free((void **)&heap.key);
+    return 0;
+}
+
+// Landmarks around the edge of the graph give the tightest bounds, the nodes nearest the corners and
+// the middles of the sides of the bounding box are used
+static n_int road_landmarks(void) {
+    road_landmark_job jobs[ROAD_LANDMARKS];
+    n_int min_x = road_node_x[0], max_x = road_node_x[road_node_count - 1];
+    n_int min_y = road_node_y[0], max_y = road_node_y[0];
+    n_int loop = 0, landmark = 0;
+
+    while (loop < road_node_count) {
+        if (road_node_y[loop] < min_y) min_y = road_node_y[loop];
+        if (road_node_y[loop] > max_y) max_y = road_node_y[loop];
+        loop++;
+    }
+    while (landmark < ROAD_LANDMARKS) {
+        n_vect2 corner;
+        corner.x = min_x + (((max_x - min_x) * road_landmark_side[landmark][0]) / 2);
+        corner.y = min_y + (((max_y - min_y) * road_landmark_side[landmark][1]) / 2);
+        jobs[landmark].source = road_graph_nearest(&corner);
+        jobs[landmark].distance = memory_new(sizeof(n_c_int) * (n_uint)road_node_count);
+        if (jobs[landmark].distance == 0L) {
+            while (landmark--) {
+                memory_free((void **)&jobs[landmark].distance);
+            }
+            return SHOW_ERROR("Road landmarks not allocated");
+        }
+        landmark++;
+    }
+
+    execute_group(road_landmark_execute, 0L, jobs, ROAD_LANDMARKS, sizeof(road_landmark_job));
+
+    loop = 0;
+    while (loop < road_node_count) {
+        landmark = 0;
+        while (landmark < ROAD_LANDMARKS) {
+            road_landmark[(loop * ROAD_LANDMARKS) + landmark] = jobs[landmark].distance[loop];
+            landmark++;
+        }
+        loop++;
+    }
+    landmark = 0;
+    while (landmark < ROAD_LANDMARKS) {
+        memory_free((void **)&jobs[landmark++].distance);
+    }
+    return 0;
+}
+
+// Labels the connected parts of the graph so routes between them fail straight away
+static n_int road_components(void) {
+    n_int *queue = memory_new(sizeof(n_int) * (n_uint)road_node_count);
+    n_int loop = 0, label = 0;
+    if (queue == 0L) {
+        return SHOW_ERROR("Road components not allocated");
+    }
+    while (loop < road_node_count) {
+        road_component[loop++] = -1;
+    }
+    loop = 0;
+    while (loop < road_node_count) {
+        if (road_component[loop] == -1) {
+            n_int head = 0, tail = 0;
+            queue[tail++] = loop;
+            road_component[loop] = (n_c_int)label;
+            while (head < tail) {
+                n_int node = queue[head++];
+                n_int edge = road_edge_start[node];
+                while (edge < road_edge_start[node + 1]) {
+                    if (road_component[road_edge_to[edge]] == -1) {
+                        road_component[road_edge_to[edge]] = (n_c_int)label;
+                        queue[tail++] = road_edge_to[edge];
+                    }
+                    edge++;
+                }
+            }
+            label++;
+        }
+        loop++;
+    }
+    memory_free((void **)&queue);
+    return 0;
+}
+
+// The buckets are sized from the extent of the graph, so every cell has its own bucket
+static n_int road_buckets(void) {
+    n_int loop = 0;
+    n_int buckets;
+    road_cell_low_x = road_cell_high_x = road_cell(road_node_x[0]);
+    road_cell_low_y = road_cell_high_y = road_cell(road_node_y[0]);
+    while (loop < road_node_count) {
+        n_int cell_x = road_cell(road_node_x[loop]);
+        n_int cell_y = road_cell(road_node_y[loop]);
+        if (cell_x < road_cell_low_x) road_cell_low_x = cell_x;
+        if (cell_x > road_cell_high_x) road_cell_high_x = cell_x;
+        if (cell_y < road_cell_low_y) road_cell_low_y = cell_y;
+        if (cell_y > road_cell_high_y) road_cell_high_y = cell_y;
+        loop++;
+    }
+    road_bucket_width = road_cell_high_x - road_cell_low_x + 1;
+    buckets = road_bucket_width * (road_cell_high_y - road_cell_low_y + 1);
+
+    memory_free((void **)&road_bucket_start);
+    road_bucket_start = memory_new(sizeof(n_int) * (n_uint)(buckets + 1));
+    if (road_bucket_start == 0L) {
+        return SHOW_ERROR("Road buckets not allocated");
+    }
+    memory_erase((n_byte *)road_bucket_start, sizeof(n_int) * (n_uint)(buckets + 1));
+
+    loop = 0;
+    while (loop < road_node_count) {
+        road_bucket_start[road_bucket(road_cell(road_node_x[loop]), road_cell(road_node_y[loop])) + 1]++;
+        loop++;
+    }
+    loop = 0;
+    while (loop < buckets) {
+        road_bucket_start[loop + 1] += road_bucket_start[loop];
+        loop++;
+    }
+    loop = 0;
+    while (loop < road_node_count) {
+        n_int bucket = road_bucket(road_cell(road_node_x[loop]), road_cell(road_node_y[loop]));
+        road_bucket_node[road_bucket_start[bucket]++] = loop;
+        loop++;
+    }
+    loop = buckets;
+    while (loop > 0) {
+        road_bucket_start[loop] = road_bucket_start[loop - 1];
+        loop--;
+    }
+    road_bucket_start[0] = 0;
+    return 0;
+}
+
+static n_int road_block_of(n_int value) {
+    n_int offset = value - NEIGHBORHOOD_CELL_OFFSET;
+    if (offset < 0) {
+        return ((offset + 1) / NEIGHBORHOOD_UNIT_SPACE) - 1;
+    }
+    return offset / NEIGHBORHOOD_UNIT_SPACE;
+}
+
+static n_int road_side_node(n_int side) {
+    return road_portals[side >> 1].node[side & 1];
+}
+
+static int road_compare_block_node(const void *a, const void *b) {
+    const n_int *first = (const n_int *)a;
+    const n_int *second = (const n_int *)b;
+    n_int loop = 0;
+    while (loop < 3) {
+        if (first[loop] != second[loop]) {
+            return (first[loop] < second[loop]) ? -1 : 1;
+        }
+        loop++;
+    }
+    return 0;
+}
+
+static int road_compare_crossing(const void *a, const void *b) {
+    const road_crossing *first = (const road_crossing *)a;
+    const road_crossing *second = (const road_crossing *)b;
+    if (first->block[0] != second->block[0]) {
+        return (first->block[0] < second->block[0]) ? -1 : 1;
+    }
+    if (first->block[1] != second->block[1]) {
+        return (first->block[1] < second->block[1]) ? -1 : 1;
+    }
+    if (first->node[0] != second->node[0]) {
+        return (first->node[0] < second->node[0]) ? -1 : 1;
+    }
+    if (first->node[1] != second->node[1]) {
+        return (first->node[1] < second->node[1]) ? -1 : 1;
+    }
+    return 0;
+}
+
+// Groups the nodes by block, the blocks are in order of block x then block y
+static n_int road_blocks_build(void) {
+    n_int *order = memory_new(sizeof(n_int) * 3 * (n_uint)road_node_count);
+    n_int loop = 0;
+
+    road_block_node = memory_new(sizeof(n_int) * (n_uint)road_node_count);
+    road_node_block = memory_new(sizeof(n_c_int) * (n_uint)road_node_count);
+    road_node_place = memory_new(sizeof(n_c_int) * (n_uint)road_node_count);
+    road_blocks = memory_new(sizeof(road_block) * (n_uint)road_node_count);
+    if ((order == 0L) || (road_block_node == 0L) || (road_node_block == 0L) || (road_node_place == 0L) ||
+        (road_blocks == 0L)) {
+        memory_free((void **)&order);
+        return SHOW_ERROR("Road blocks not allocated");
+    }
+
+    while (loop < road_node_count) {
+        order[(loop * 3)] = road_block_of(road_node_x[loop]);
+        order[(loop * 3) + 1] = road_block_of(road_node_y[loop]);
+        order[(loop * 3) + 2] = loop;
+        loop++;
+    }
+    qsort(order, (size_t)road_node_count, sizeof(n_int) * 3, road_compare_block_node);
+
+    loop = 0;
+    while (loop < road_node_count) {
+        n_int *entry = &order[loop * 3];
+        road_block *block = road_block_count ? &road_blocks[road_block_count - 1] : 0L;
+        if ((block == 0L) || (block->block_x != entry[0]) || (block->block_y != entry[1])) {
+            block = &road_blocks[road_block_count++];
+            memory_erase((n_byte *)block, sizeof(road_block));
+            block->block_x = entry[0];
+            block->block_y = entry[1];
+            block->first = loop;
+        }
+        road_block_node[loop] = entry[2];
+        road_node_block[entry[2]] = (n_c_int)(road_block_count - 1);
+        road_node_place[entry[2]] = (n_c_int)block->count++;
+        if (block->count > road_block_largest) {
+            road_block_largest = block->count;
+        }
+        loop++;
+    }
+    memory_free((void **)&order);
+    return 0;
+}
+
+// Picks the portal of each pair of neighboring blocks from the edges crossing between them and lists
+// the sides of the portals by block
+static n_int road_portals_build(void) {
+    road_crossing *crossing;
+    n_int count = 0;
+    n_int loop = 0;
+
+    while (loop < road_node_count) {
+        n_int edge = road_edge_start[loop];
+        while (edge < road_edge_start[loop + 1]) {
+            n_int to = road_edge_to[edge];
+            count += ((loop < to) && (road_node_block[loop] != road_node_block[to]));
+            edge++;
+        }
+        loop++;
+    }
+
+    crossing = memory_new(sizeof(road_crossing) * (n_uint)(count + 1));
+    road_portals = memory_new(sizeof(road_portal) * (n_uint)(count + 1));
+    road_block_side = memory_new(sizeof(n_int) * 2 * (n_uint)(count + 1));
+    road_side_place = memory_new(sizeof(n_c_int) * 2 * (n_uint)(count + 1));
+    if ((crossing == 0L) || (road_portals == 0L) || (road_block_side == 0L) || (road_side_place == 0L)) {
+        memory_free((void **)&crossing);
+        return SHOW_ERROR("Road portals not allocated");
+    }
+
+    count = 0;
+    loop = 0;
+    while (loop < road_node_count) {
+        n_int edge = road_edge_start[loop];
+        while (edge < road_edge_start[loop + 1]) {
+            n_int to = road_edge_to[edge];
+            if ((loop < to) && (road_node_block[loop] != road_node_block[to])) {
+                n_byte swap = (road_node_block[loop] > road_node_block[to]);
+                road_crossing *next = &crossing[count++];
+                next->block[swap] = road_node_block[loop];
+                next->block[!swap] = road_node_block[to];
+                next->node[swap] = loop;
+                next->node[!swap] = to;
+                next->cost = road_edge_cost[edge];
+                next->middle_x = (road_node_x[loop] + road_node_x[to]) / 2;
+                next->middle_y = (road_node_y[loop] + road_node_y[to]) / 2;
+            }
+            edge++;
+        }
+        loop++;
+    }
+    qsort(crossing, (size_t)count, sizeof(road_crossing), road_compare_crossing);
+
+    // the crossings between the same two blocks are together, the one nearest their middle is the portal
+    loop = 0;
+    while (loop < count) {
+        n_int last = loop + 1;
+        n_int sum_x = crossing[loop].middle_x, sum_y = crossing[loop].middle_y;
+        n_int best = loop, best_distance = -1;
+        n_int member;
+        while ((last < count) && (crossing[last].block[0] == crossing[loop].block[0]) &&
+               (crossing[last].block[1] == crossing[loop].block[1])) {
+            sum_x += crossing[last].middle_x;
+            sum_y += crossing[last].middle_y;
+            last++;
+        }
+        sum_x /= (last - loop);
+        sum_y /= (last - loop);
+        member = loop;
+        while (member < last) {
+            n_int dx = crossing[member].middle_x - sum_x;
+            n_int dy = crossing[member].middle_y - sum_y;
+            if ((best_distance == -1) || (((dx * dx) + (dy * dy)) < best_distance)) {
+                best = member;
+                best_distance = (dx * dx) + (dy * dy);
+            }
+            member++;
+        }
+        {
+            road_portal *portal = &road_portals[road_portal_count++];
+            portal->node[0] = crossing[best].node[0];
+            portal->node[1] = crossing[best].node[1];
+            portal->block[0] = crossing[best].block[0];
+            portal->block[1] = crossing[best].block[1];
+            portal->cost = crossing[best].cost;
+            road_blocks[portal->block[0]].sides++;
+            road_blocks[portal->block[1]].sides++;
+        }
+        loop = last;
+    }
+    memory_free((void **)&crossing);
+
+    road_portal_landmark = memory_new(sizeof(n_c_int) * 2 * ROAD_LANDMARKS * (n_uint)(road_portal_count + 1));
+    if (road_portal_landmark == 0L) {
+        return SHOW_ERROR("Road portal landmarks not allocated");
+    }
+    loop = 0;
+    while (loop < (road_portal_count * 2)) {
+        memory_copy((n_byte *)&road_landmark[road_side_node(loop) * ROAD_LANDMARKS],
+                    (n_byte *)&road_portal_landmark[loop * ROAD_LANDMARKS], sizeof(n_c_int) * ROAD_LANDMARKS);
+        loop++;
+    }
+
+    // the sides of each block follow the order of the portals, which is by the neighboring block
+    loop = 0;
+    count = 0;
+    while (loop < road_block_count) {
+        road_blocks[loop].side_first = count;
+        count += road_blocks[loop].sides;
+        road_blocks[loop].sides = 0;
+        loop++;
+    }
+    loop = 0;
+    while (loop < (road_portal_count * 2)) {
+        road_block *block = &road_blocks[road_portals[loop / 2].block[loop & 1]];
+        road_side_place[loop] = (n_c_int)block->sides;
+        road_block_side[block->side_first + block->sides++] = loop;
+        loop++;
+    }
+    return 0;
+}
+
+void road_graph_close(void) {
+    memory_free((void **)&road_node_x);
+    memory_free((void **)&road_node_y);
+    memory_free((void **)&road_edge_start);
+    memory_free((void **)&road_edge_to);
+    memory_free((void **)&road_edge_cost);
+    memory_free((void **)&road_component);
+    memory_free((void **)&road_landmark);
+    memory_free((void **)&road_bucket_start);
+    memory_free((void **)&road_bucket_node);
+    memory_free((void **)&road_blocks);
+    memory_free((void **)&road_block_node);
+    memory_free((void **)&road_node_block);
+    memory_free((void **)&road_node_place);
+    memory_free((void **)&road_portals);
+    memory_free((void **)&road_portal_landmark);
+    memory_free((void **)&road_block_side);
+    memory_free((void **)&road_side_place);
+    road_node_count = 0;
+    road_block_count = 0;
+    road_block_largest = 0;
+    road_portal_count = 0;
+}
+
+// Collects the stops on each rectangle, where rectangles meet and at the ends of each
+static void road_graph_stops(memory_list *rects, memory_list *stops, memory_list *links) {
+    road_rect *rect = (road_rect *)rects->data;
+    n_int count = (n_int)rects->count;
+    memory_list *alongside = memory_list_new(sizeof(n_int) * 2, 64);
+    n_int loop = 0;
+
+    while (loop < count) {
+        if (rect[loop].vertical) {
+            road_add_stop(stops, loop, rect[loop].middle, rect[loop].min_y);
+            road_add_stop(stops, loop, rect[loop].middle, rect[loop].max_y);
+        } else {
+            road_add_stop(stops, loop, rect[loop].min_x, rect[loop].middle);
+            road_add_stop(stops, loop, rect[loop].max_x, rect[loop].middle);
+        }
+        loop++;
+    }
+
+    // the rectangles are sorted along x so only those starting before this one ends can touch it
+    loop = 0;
+    while (loop < count) {
+        n_int other = loop + 1;
+        while ((other < count) && (rect[other].min_x <= rect[loop].max_x)) {
+            if ((rect[other].min_y <= rect[loop].max_y) && (rect[other].max_y >= rect[loop].min_y)) {
+                if (rect[loop].vertical != rect[other].vertical) {
+                    road_meet_across(stops, links, rect, rect[loop].vertical ? other : loop, rect[loop].vertical ? loop : other);
+                } else if ((rect[loop].group != rect[other].group) && alongside) {
+                    n_int pair[2];
+                    pair[0] = loop;
+                    pair[1] = other;
+                    memory_list_copy(alongside, (n_byte *)pair, sizeof(pair));
+                }
+            }
+            other++;
+        }
+        loop++;
+    }
+
+    if (alongside == 0L) {
+        return;
+    }
+
+    // the stops of side by side rectangles are carried across once the other stops are known
+    if (alongside->count) {
+        n_int *pairs = (n_int *)alongside->data;
+        n_int *first = memory_new(sizeof(n_int) * (n_uint)(count + 1));
+        n_int known = (n_int)stops->count;
+        if (first) {
+            qsort(stops->data, (size_t)known, sizeof(road_stop), road_compare_stop_rect);
+            memory_erase((n_byte *)first, sizeof(n_int) * (n_uint)(count + 1));
+            loop = 0;
+            while (loop < known) {
+                first[((road_stop *)stops->data)[loop].rect + 1]++;
+                loop++;
+            }
+            loop = 0;
+            while (loop < count) {
+                first[loop + 1] += first[loop];
+                loop++;
+            }
+            loop = 0;
+            while (loop < (n_int)alongside->count) {
+                n_int from = pairs[loop * 2];
+                n_int to = pairs[(loop * 2) + 1];
+                road_meet_along(stops, links, rect, from, to, first[from], first[from + 1]);
+                road_meet_along(stops, links, rect, to, from, first[to], first[to + 1]);
+                loop++;
+            }
+            memory_free((void **)&first);
+        }
+    }
+    memory_list_free(&alongside);
+}
+
+// Turns the stops into nodes and the stops along each rectangle and the links into edges
+static n_int road_graph_make(memory_list *rects, memory_list *stops, memory_list *links, memory_list *edges) {
+    road_stop *stop;
+    n_int loop = 0, node = 0;
+
+    qsort(rects->data, rects->count, sizeof(road_rect), road_compare_rect);
+
+    road_graph_stops(rects, stops, links);
+
+    // the nodes are the distinct stop locations
+    stop = (road_stop *)stops->data;
+    qsort(stop, stops->count, sizeof(road_stop), road_compare_stop_location);
+    while (loop < (n_int)stops->count) {
+        if ((loop == 0) || road_compare_stop_location(&stop[loop - 1], &stop[loop])) {
+            node++;
+        }
+        loop++;
+    }
+
+    road_node_x = memory_new(sizeof(n_c_int) * (n_uint)node);
+    road_node_y = memory_new(sizeof(n_c_int) * (n_uint)node);
+    road_edge_start = memory_new(sizeof(n_int) * (n_uint)(node + 1));
+    road_component = memory_new(sizeof(n_c_int) * (n_uint)node);
+    road_landmark = memory_new(sizeof(n_c_int) * ROAD_LANDMARKS * (n_uint)node);
+    road_bucket_node = memory_new(sizeof(n_int) * (n_uint)node);
+    if ((road_node_x == 0L) || (road_node_y == 0L) || (road_edge_start == 0L) || (road_component == 0L) ||
+        (road_landmark == 0L) || (road_bucket_node == 0L)) {
+        return SHOW_ERROR("Road nodes not allocated");
+    }
+
+    node = -1;
+    loop = 0;
+    while (loop < (n_int)stops->count) {
+        if ((loop == 0) || road_compare_stop_location(&stop[loop - 1], &stop[loop])) {
+            node++;
+            road_node_x[node] = (n_c_int)stop[loop].x;
+            road_node_y[node] = (n_c_int)stop[loop].y;
+        }
+        stop[loop].node = node;
+        loop++;
+    }
+    road_node_count = node + 1;
+
+    // edges along each rectangle between its stops in order
+    qsort(stop, stops->count, sizeof(road_stop), road_compare_stop_rect);
+    loop = 1;
+    while (loop < (n_int)stops->count) {
+        if (stop[loop - 1].rect == stop[loop].rect) {
+            road_add_edge(edges, stop[loop - 1].node, stop[loop].node);
+        }
+        loop++;
+    }
+    // and across where the rectangles meet
+    loop = 0;
+    while (loop < (n_int)links->count) {
+        road_link *link = &((road_link *)links->data)[loop];
+        road_add_edge(edges, road_node_find(link->start_x, link->start_y), road_node_find(link->end_x, link->end_y));
+        loop++;
+    }
+
+    road_edge_to = memory_new(sizeof(n_c_int) * 2 * (edges->count + 1));
+    road_edge_cost = memory_new(sizeof(n_c_int) * 2 * (edges->count + 1));
+    if ((road_edge_to == 0L) || (road_edge_cost == 0L)) {
+        return SHOW_ERROR("Road edges not allocated");
+    }
+
+    // both directions of each edge, grouped by node
+    memory_erase((n_byte *)road_edge_start, sizeof(n_int) * (n_uint)(road_node_count + 1));
+    loop = 0;
+    while (loop < (n_int)edges->count) {
+        road_edge *edge = &((road_edge *)edges->data)[loop];
+        road_edge_start[edge->from + 1]++;
+        road_edge_start[edge->to + 1]++;
+        loop++;
+    }
+    loop = 0;
+    while (loop < road_node_count) {
+        road_edge_start[loop + 1] += road_edge_start[loop];
+        loop++;
+    }
+    loop = 0;
+    while (loop < (n_int)edges->count) {
+        road_edge *edge = &((road_edge *)edges->data)[loop];
+        n_int forward = road_edge_start[edge->from]++;
+        n_int backward = road_edge_start[edge->to]++;
+        road_edge_to[forward] = (n_c_int)edge->to;
+        road_edge_cost[forward] = (n_c_int)edge->cost;
+        road_edge_to[backward] = (n_c_int)edge->from;
+        road_edge_cost[backward] = (n_c_int)edge->cost;
+        loop++;
+    }
+    loop = road_node_count;
+    while (loop > 0) {
+        road_edge_start[loop] = road_edge_start[loop - 1];
+        loop--;
+    }
+    road_edge_start[0] = 0;
+
+    if ((road_buckets() != 0) || (road_components() != 0) || (road_landmarks() != 0)) {
+        return -1;
+    }
+    if (road_blocks_build() != 0) {
+        return -1;
+    }
+    return road_portals_build();
+}
+
+// Joins the road and footpath rectangles of the two blocks and parks into a graph. Nodes are where the
+// rectangles meet and at their ends, edges run along the middle of each rectangle and across to the
+// neighboring rectangles, including those of the neighboring cells. The landmark distances for the
+// route estimates, and the blocks and portals road_plan searches, are found once here. The portal
+// costs are kept from graph to graph until road_plan_invalidate drops them.
+n_int road_graph_build(void) {
+    memory_list *rects = memory_list_new(sizeof(road_rect), 256);
+    memory_list *stops = memory_list_new(sizeof(road_stop), 1024);
+    memory_list *links = memory_list_new(sizeof(road_link), 1024);
+    memory_list *edges = memory_list_new(sizeof(road_edge), 1024);
+    simulated_twoblock *twoblocks;
+    simulated_park *parks;
+    n_int twoblock_count, park_count;
+    n_int loop = 0;
+    n_int result = 0;
+
+    road_graph_close();
+
+    if ((rects == 0L) || (stops == 0L) || (links == 0L) || (edges == 0L)) {
+        result = SHOW_ERROR("Road graph not allocated");
+    } else {
+        twoblocks = neighborhoood_twoblock(&twoblock_count);
+        parks = neighborhoood_park(&park_count);
+
+        while (loop < twoblock_count) {
+            road_add_group(rects, &twoblocks[loop].road, loop);
+            loop++;
+        }
+        loop = 0;
+        while (loop < park_count) {
+            road_add_group(rects, &parks[loop].road, twoblock_count + loop);
+            loop++;
+        }
+        if (rects->count) {
+            result = road_graph_make(rects, stops, links, edges);
+            if (result != 0) {
+                road_graph_close();
+            }
+        }
+    }
+
+    memory_list_free(&rects);
+    memory_list_free(&stops);
+    memory_list_free(&links);
+    memory_list_free(&edges);
+    return result;
+}
+
+n_int road_graph_nodes(void) {
+    return road_node_count;
+}
+
+void road_graph_node(n_int node, n_vect2 *location) {
+    location->x = road_node_x[node];
+    location->y = road_node_y[node];
+}
+
+n_int road_graph_edges(n_int node) {
+    return road_edge_start[node + 1] - road_edge_start[node];
+}
+
+// The node the edge of the node leads to, and the cost of the edge
+n_int road_graph_edge(n_int node, n_int edge, n_int *cost) {
+    n_int index = road_edge_start[node] + edge;
+    if (cost) {
+        *cost = road_edge_cost[index];
+    }
+    return road_edge_to[index];
+}
+
+// The nearest node to the location, the grid cells are searched in growing rings until a ring is
+// further away than the nearest node found
+n_int road_graph_nearest(n_vect2 *location) {
+    n_int cell_x, cell_y, ring = 0, last_ring;
+    n_int best = -1;
+    n_int best_distance = 0;
+
+    if (road_node_count == 0) {
+        return -1;
+    }
+    cell_x = road_cell(location->x);
+    cell_y = road_cell(location->y);
+
+    // by the last ring every cell with nodes has been searched
+    last_ring = road_cell_high_x - cell_x;
+    if ((cell_x - road_cell_low_x) > last_ring) last_ring = cell_x - road_cell_low_x;
+    if ((road_cell_high_y - cell_y) > last_ring) last_ring = road_cell_high_y - cell_y;
+    if ((cell_y - road_cell_low_y) > last_ring) last_ring = cell_y - road_cell_low_y;
+
+    while (1) {
+        n_int py = cell_y - ring;
+        while (py <= (cell_y + ring)) {
+            n_int px = cell_x - ring;
+            while (px <= (cell_x + ring)) {
+                // only the cells on the ring itself, that the graph covers
+                if (((py == (cell_y - ring)) || (py == (cell_y + ring)) || (px == (cell_x - ring)) || (px == (cell_x + ring))) &&
+                    (px >= road_cell_low_x) && (px <= road_cell_high_x) && (py >= road_cell_low_y) && (py <= road_cell_high_y)) {
+                    n_int bucket = road_bucket(px, py);
+                    n_int loop = road_bucket_start[bucket];
+                    while (loop < road_bucket_start[bucket + 1]) {
+                        n_int node = road_bucket_node[loop];
+                        n_int dx = road_node_x[node] - location->x;
+                        n_int dy = road_node_y[node] - location->y;
+                        n_int distance = (dx * dx) + (dy * dy);
+                        if ((best == -1) || (distance < best_distance) || ((distance == best_distance) && (node < best))) {
+                            best = node;
+                            best_distance = distance;
+                        }
+                        loop++;
+                    }
+                }
+                px++;
+            }
+            py++;
+        }
+        // a node beyond this ring is at least a ring of cells away
+        if (best != -1) {
+            n_int clear = ring * ROAD_GRAPH_CELL;
+            if ((clear * clear) >= best_distance) {
+                return best;
+            }
+        }
+        if (ring >= last_ring) {
+            return best;
+        }
+        ring++;
+    }
+}
+
+static void road_local_free(road_local *local) {
+    memory_free((void **)&local->cost);
+    memory_free((void **)&local->parent);
+    memory_free((void **)&local->heap.nodes);
+    memory_free((void **)&local->heap.position);
+    local->capacity = 0;
+}
+
+static n_int road_local_size(road_local *local) {
+    if (local->capacity >= road_block_largest) {
+        return 0;
+    }
+    road_local_free(local);
+    local->cost = memory_new(sizeof(n_int) * (n_uint)road_block_largest);
+    local->parent = memory_new(sizeof(n_int) * (n_uint)road_block_largest);
+    local->heap.nodes = memory_new(sizeof(n_int) * (n_uint)road_block_largest);
+    local->heap.position = memory_new(sizeof(n_int) * (n_uint)road_block_largest);
+    if ((local->cost == 0L) || (local->parent == 0L) || (local->heap.nodes == 0L) || (local->heap.position == 0L)) {
+        return SHOW_ERROR("Road local search not allocated");
+    }
+    local->heap.key = local->cost;
+    local->capacity = road_block_largest;
+    return 0;
+}
+
+// Dijkstra from the source to every node of its block without leaving the block
+static void road_local_search(road_local *local, n_int source) {
+    road_block *block = &road_blocks[road_node_block[source]];
+    n_int loop = 0;
+
+    while (loop < block->count) {
+        local->cost[loop] = ROAD_UNREACHED;
+        local->parent[loop] = -1;
+        local->heap.position[loop] = -1;
+        loop++;
+    }
+    local->heap.count = 0;
+    local->cost[road_node_place[source]] = 0;
+    road_heap_push(&local->heap, road_node_place[source]);
+
+    while (local->heap.count) {
+        n_int place = road_heap_pop(&local->heap);
+        n_int node = road_block_node[block->first + place];
+        n_int edge = road_edge_start[node];
+        while (edge < road_edge_start[node + 1]) {
+            n_int to = road_edge_to[edge];
+            if (road_node_block[to] == road_node_block[node]) {
+                n_int to_place = road_node_place[to];
+                n_int cost = local->cost[place] + road_edge_cost[edge];
+                if (cost < local->cost[to_place]) {
+                    local->cost[to_place] = cost;
+                    local->parent[to_place] = place;
+                    if (local->heap.position[to_place] == -1) {
+                        road_heap_push(&local->heap, to_place);
+                    } else {
+                        road_heap_fix(&local->heap, local->heap.position[to_place]);
+                    }
+                }
+            }
+            edge++;
+        }
+        local->heap.position[place] = -1;
+    }
+}
+
+road_search *road_search_new(void) {
+    road_search *search = memory_new(sizeof(road_search));
+    if (search) {
+        memory_erase((n_byte *)search, sizeof(road_search));
+    }
+    return search;
+}
+
+void road_search_free(road_search **search) {
+    if (*search) {
+        memory_free((void **)&(*search)->cost);
+        memory_free((void **)&(*search)->estimate);
+        memory_free((void **)&(*search)->parent);
+        memory_free((void **)&(*search)->seen);
+        memory_free((void **)&(*search)->closed);
+        memory_free((void **)&(*search)->heap.nodes);
+        memory_free((void **)&(*search)->heap.position);
+        road_search_free(&(*search)->portals);
+        road_local_free(&(*search)->start);
+        road_local_free(&(*search)->end);
+        road_local_free(&(*search)->fill);
+        memory_free((void **)search);
+    }
+}
+
+// The search memory follows the size of the graph searched. Nodes are only reset when a search first
+// sees them, so nothing is cleared between searches.
+static n_int road_search_size(road_search *search, n_int count) {
+    if (search->capacity >= count) {
+        return 0;
+    }
+    memory_free((void **)&search->cost);
+    memory_free((void **)&search->estimate);
+    memory_free((void **)&search->parent);
+    memory_free((void **)&search->seen);
+    memory_free((void **)&search->closed);
+    memory_free((void **)&search->heap.nodes);
+    memory_free((void **)&search->heap.position);
+    search->capacity = 0;
+
+    search->cost = memory_new(sizeof(n_int) * (n_uint)count);
+    search->estimate = memory_new(sizeof(n_int) * (n_uint)count);
+    search->parent = memory_new(sizeof(n_int) * (n_uint)count);
+    search->seen = memory_new(sizeof(n_uint) * (n_uint)count);
+    search->closed = memory_new(sizeof(n_uint) * (n_uint)count);
+    search->heap.nodes = memory_new(sizeof(n_int) * (n_uint)count);
+    search->heap.position = memory_new(sizeof(n_int) * (n_uint)count);
+    if ((search->cost == 0L) || (search->estimate == 0L) || (search->parent == 0L) || (search->seen == 0L) ||
+        (search->closed == 0L) || (search->heap.nodes == 0L) || (search->heap.position == 0L)) {
+        return SHOW_ERROR("Road search not allocated");
+    }
+    memory_erase((n_byte *)search->seen, sizeof(n_uint) * (n_uint)count);
+    memory_erase((n_byte *)search->closed, sizeof(n_uint) * (n_uint)count);
+    search->heap.key = search->estimate;
+    search->capacity = count;
+    search->generation = 0;
+    return 0;
+}
+
+// The lower bound on the cost from the node to the end, the triangle inequality on the distances to
+// each landmark
+static n_int road_estimate_from(n_c_int *node_landmark, n_c_int *end_landmark) {
+    n_int best = 0;
+    n_int loop = 0;
+    while (loop < ROAD_LANDMARKS) {
+        n_int difference = (n_int)end_landmark[loop] - (n_int)node_landmark[loop];
+        if (difference < 0) {
+            difference = -difference;
+        }
+        if (difference > best) {
+            best = difference;
+        }
+        loop++;
+    }
+    return best;
+}
+
+static n_int road_estimate(n_int node, n_c_int *end_landmark) {
+    return road_estimate_from(&road_landmark[node * ROAD_LANDMARKS], end_landmark);
+}
+
+// Turns the nodes of the route from the first around
+static void road_route_reverse(int_list *route, n_uint first) {
+    n_int *values = (n_int *)route->data;
+    n_uint low = first;
+    n_uint high = route->count - 1;
+    if (route->count == 0) {
+        return;
+    }
+    while (low < high) {
+        n_int temp = values[low];
+        values[low++] = values[high];
+        values[high--] = temp;
+    }
+}
+
+// The shortest route from the start node to the end node with A*, estimated with the landmarks. The
+// search is separate from the graph so each thread can route with its own search.
+// Returns the cost of the route and adds the nodes from the start to the end to the route, or -1 if
+// there is no route.
+n_int road_route(road_search *search, n_int start, n_int end, int_list *route) {
+    n_c_int *end_landmark;
+    n_uint generation;
+
+    if ((search == 0L) || (start < 0) || (end < 0) || (start >= road_node_count) || (end >= road_node_count)) {
+        return -1;
+    }
+    if (road_component[start] != road_component[end]) {
+        return -1;
+    }
+    if (road_search_size(search, road_node_count) != 0) {
+        return -1;
+    }
+
+    generation = ++search->generation;
+    end_landmark = &road_landmark[end * ROAD_LANDMARKS];
+
+    search->heap.count = 0;
+    search->cost[start] = 0;
+    search->estimate[start] = road_estimate(start, end_landmark);
+    search->parent[start] = -1;
+    search->seen[start] = generation;
+    road_heap_push(&search->heap, start);
+
+    while (search->heap.count) {
+        n_int node = road_heap_pop(&search->heap);
+        n_int edge;
+
+        if (node == end) {
+            break;
+        }
+        search->closed[node] = generation;
+
+        edge = road_edge_start[node];
+        while (edge < road_edge_start[node + 1]) {
+            n_int to = road_edge_to[edge];
+            n_int cost = search->cost[node] + road_edge_cost[edge];
+            if (search->seen[to] != generation) {
+                search->seen[to] = generation;
+                search->cost[to] = cost;
+                search->estimate[to] = cost + road_estimate(to, end_landmark);
+                search->parent[to] = node;
+                road_heap_push(&search->heap, to);
+            } else if ((search->closed[to] != generation) && (cost < search->cost[to])) {
+                search->estimate[to] -= search->cost[to] - cost;
+                search->cost[to] = cost;
+                search->parent[to] = node;
+                road_heap_fix(&search->heap, search->heap.position[to]);
+            }
+            edge++;
+        }
+    }
+
+    if (search->seen[end] != generation) {
+        return -1;
+    }
+
+    if (route) {
+        n_uint first = route->count;
+        n_int node = end;
+        while (node != -1) {
+            int_list_copy(route, node);
+            node = search->parent[node];
+        }
+        // the nodes were added from the end back to the start
+        road_route_reverse(route, first);
+    }
+    return search->cost[end];
+}
+
+static n_int road_cache_bucket(n_int block_x, n_int block_y) {
+    n_uint hash = ((n_uint)block_x * 73856093) ^ ((n_uint)block_y * 19349663);
+    return (n_int)(hash & (n_uint)(road_cache_size - 1));
+}
+
+static road_cache_slot *road_cache_find(n_int block_x, n_int block_y) {
+    n_int bucket;
+    if (road_cache_size == 0) {
+        return 0L;
+    }
+    bucket = road_cache_bucket(block_x, block_y);
+    while (road_cache[bucket].used) {
+        if ((road_cache[bucket].block_x == block_x) && (road_cache[bucket].block_y == block_y)) {
+            return &road_cache[bucket];
+        }
+        bucket = (bucket + 1) & (road_cache_size - 1);
+    }
+    return 0L;
+}
+
+// The slot of the block, added if it isn't there. The table doubles when it is half full.
+static road_cache_slot *road_cache_add(n_int block_x, n_int block_y) {
+    road_cache_slot *slot = road_cache_find(block_x, block_y);
+    n_int bucket;
+    if (slot) {
+        return slot;
+    }
+    if (((road_cache_used + 1) * 2) > road_cache_size) {
+        road_cache_slot *previous = road_cache;
+        n_int previous_size = road_cache_size;
+        n_int size = road_cache_size ? (road_cache_size * 2) : 256;
+        n_int loop = 0;
+        road_cache_slot *larger = memory_new(sizeof(road_cache_slot) * (n_uint)size);
+        if (larger == 0L) {
+            (void)SHOW_ERROR("Road portal cache not allocated");
+            return 0L;
+        }
+        memory_erase((n_byte *)larger, sizeof(road_cache_slot) * (n_uint)size);
+        road_cache = larger;
+        road_cache_size = size;
+        while (loop < previous_size) {
+            if (previous[loop].used) {
+                bucket = road_cache_bucket(previous[loop].block_x, previous[loop].block_y);
+                while (road_cache[bucket].used) {
+                    bucket = (bucket + 1) & (road_cache_size - 1);
+                }
+                road_cache[bucket] = previous[loop];
+            }
+            loop++;
+        }
+        memory_free((void **)&previous);
+    }
+    bucket = road_cache_bucket(block_x, block_y);
+    while (road_cache[bucket].used) {
+        bucket = (bucket + 1) & (road_cache_size - 1);
+    }
+    slot = &road_cache[bucket];
+    slot->block_x = block_x;
+    slot->block_y = block_y;
+    slot->used = 1;
+    slot->cache = 0L;
+    road_cache_used++;
+    return slot;
+}
+
+// Whether the kept costs were found on the same nodes and portals the block has now
+static n_byte road_cache_matches(road_portal_cache *cache, road_block *block) {
+    n_int loop = 0;
+    if ((cache->nodes != block->count) || (cache->sides != block->sides)) {
+        return 0;
+    }
+    while (loop < block->sides) {
+        if (cache->entry[loop] != road_node_place[road_side_node(road_block_side[block->side_first + loop])]) {
+            return 0;
+        }
+        loop++;
+    }
+    return 1;
+}
+
+// The costs between every pair of sides of the block and the walks behind them, found from each side
+static road_portal_cache *road_cache_fill(n_int block_number, road_local *local) {
+    road_block *block = &road_blocks[block_number];
+    n_int sides = block->sides;
+    n_int nodes = block->count;
+    n_int from = 0;
+    road_portal_cache *cache = memory_new(sizeof(road_portal_cache) +
+                                          (sizeof(n_c_int) * (n_uint)(sides + (sides * sides) + (sides * nodes))));
+    if (cache == 0L) {
+        (void)SHOW_ERROR("Road portal costs not allocated");
+        return 0L;
+    }
+    cache->nodes = nodes;
+    cache->sides = sides;
+    cache->entry = (n_c_int *)&cache[1];
+    cache->cost = &cache->entry[sides];
+    cache->parent = &cache->cost[sides * sides];
+
+    while (from < sides) {
+        cache->entry[from] = road_node_place[road_side_node(road_block_side[block->side_first + from])];
+        from++;
+    }
+    from = 0;
+    while (from < sides) {
+        n_int loop = 0;
+        road_local_search(local, road_side_node(road_block_side[block->side_first + from]));
+        while (loop < sides) {
+            n_int cost = local->cost[cache->entry[loop]];
+            cache->cost[(from * sides) + loop] = (n_c_int)((cost == ROAD_UNREACHED) ? -1 : cost);
+            loop++;
+        }
+        loop = 0;
+        while (loop < nodes) {
+            cache->parent[(from * nodes) + loop] = (n_c_int)local->parent[loop];
+            loop++;
+        }
+        from++;
+    }
+    return cache;
+}
+
+// The portal costs of the block, found again only if the block's cells were invalidated or its nodes
+// and portals no longer match
+static road_portal_cache *road_block_cache(n_int block_number, road_local *local) {
+    road_block *block = &road_blocks[block_number];
+    road_cache_slot *slot;
+    if (block->cache) {
+        return block->cache;
+    }
+    slot = road_cache_add(block->block_x, block->block_y);
+    if (slot == 0L) {
+        return 0L;
+    }
+    if (slot->cache && (road_cache_matches(slot->cache, block) == 0)) {
+        memory_free((void **)&slot->cache);
+    }
+    if (slot->cache == 0L) {
+        if (road_local_size(local) != 0) {
+            return 0L;
+        }
+        slot->cache = road_cache_fill(block_number, local);
+    }
+    block->cache = slot->cache;
+    return block->cache;
+}
+
+typedef struct {
+    n_int block;
+    road_portal_cache *cache;
+} road_cache_job;
+
+static n_int road_cache_execute(void *general_data, void *read_data, void *write_data) {
+    road_cache_job *job = (road_cache_job *)read_data;
+    road_local local;
+    memory_erase((n_byte *)&local, sizeof(road_local));
+    if (road_local_size(&local) == 0) {
+        job->cache = road_cache_fill(job->block, &local);
+    }
+    road_local_free(&local);
+    return 0;
+}
+
+// Finds the portal costs of every block of the graph that doesn't have them across the threads. Until
+// then road_plan finds the costs of the blocks it reaches, so it can only route from more than one
+// thread once the costs are prepared.
+n_int road_plan_prepare(void) {
+    road_cache_job *jobs;
+    n_int count = 0;
+    n_int loop = 0;
+    n_int result = 0;
+
+    if (road_block_count == 0) {
+        return 0;
+    }
+    jobs = memory_new(sizeof(road_cache_job) * (n_uint)road_block_count);
+    if (jobs == 0L) {
+        return SHOW_ERROR("Road portal jobs not allocated");
+    }
+    while (loop < road_block_count) {
+        road_block *block = &road_blocks[loop];
+        road_cache_slot *slot = road_cache_add(block->block_x, block->block_y);
+        if (slot == 0L) {
+            memory_free((void **)&jobs);
+            return -1;
+        }
+        if (slot->cache && (road_cache_matches(slot->cache, block) == 0)) {
+            memory_free((void **)&slot->cache);
+        }
+        if (slot->cache) {
+            block->cache = slot->cache;
+        } else {
+            jobs[count].block = loop;
+            jobs[count].cache = 0L;
+            count++;
+        }
+        loop++;
+    }
+
+    execute_group(road_cache_execute, 0L, jobs, count, sizeof(road_cache_job));
+
+    loop = 0;
+    while (loop < count) {
+        road_block *block = &road_blocks[jobs[loop].block];
+        if (jobs[loop].cache == 0L) {
+            result = -1;
+        } else {
+            road_cache_find(block->block_x, block->block_y)->cache = jobs[loop].cache;
+            block->cache = jobs[loop].cache;
+        }
+        loop++;
+    }
+    memory_free((void **)&jobs);
+    return result;
+}
+
+static n_int road_block_find(n_int block_x, n_int block_y) {
+    n_int low = 0;
+    n_int high = road_block_count - 1;
+    while (low <= high) {
+        n_int middle = (low + high) / 2;
+        road_block *block = &road_blocks[middle];
+        if ((block->block_x < block_x) || ((block->block_x == block_x) && (block->block_y < block_y))) {
+            low = middle + 1;
+        } else if ((block->block_x == block_x) && (block->block_y == block_y)) {
+            return middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+// Drops the portal costs around a cell of the neighborhood that is generated or evicted. The roads of
+// a cell reach into the blocks either side of it and the links between neighboring cells are made
+// in both, so the eight blocks around the cell go too.
+void road_plan_invalidate(n_int cell_x, n_int cell_y) {
+    n_int py = cell_y - 1;
+    while (py <= (cell_y + 1)) {
+        n_int px = cell_x - 1;
+        while (px <= (cell_x + 1)) {
+            road_cache_slot *slot = road_cache_find(px, py);
+            n_int block = road_block_find(px, py);
+            if (slot) {
+                memory_free((void **)&slot->cache);
+            }
+            if (block != -1) {
+                road_blocks[block].cache = 0L;
+            }
+            px++;
+        }
+        py++;
+    }
+}
+
+void road_plan_close(void) {
+    n_int loop = 0;
+    while (loop < road_cache_size) {
+        memory_free((void **)&road_cache[loop].cache);
+        loop++;
+    }
+    memory_free((void **)&road_cache);
+    road_cache_size = 0;
+    road_cache_used = 0;
+    loop = 0;
+    while (loop < road_block_count) {
+        road_blocks[loop].cache = 0L;
+        loop++;
+    }
+}
+
+// The portals are searched at the middle of their crossing edges, with the costs doubled so the
+// halves of each crossing edge add up. The estimate is from the nearer node of the crossing edge.
+static void road_plan_reach(road_search *portals, n_int from, n_int portal, n_int cost, n_c_int *end_landmark) {
+    n_uint generation = portals->generation;
+    if (portals->seen[portal] != generation) {
+        n_c_int *landmark = &road_portal_landmark[portal * 2 * ROAD_LANDMARKS];
+        n_int first = road_estimate_from(landmark, end_landmark);
+        n_int second = road_estimate_from(&landmark[ROAD_LANDMARKS], end_landmark);
+        portals->seen[portal] = generation;
+        portals->cost[portal] = cost;
+        portals->estimate[portal] = cost + road_portals[portal].cost + (2 * ((first < second) ? first : second));
+        portals->parent[portal] = from;
+        road_heap_push(&portals->heap, portal);
+    } else if ((portals->closed[portal] != generation) && (cost < portals->cost[portal])) {
+        portals->estimate[portal] -= portals->cost[portal] - cost;
+        portals->cost[portal] = cost;
+        portals->parent[portal] = from;
+        road_heap_fix(&portals->heap, portals->heap.position[portal]);
+    }
+}
+
+// The side of the portal in the block
+static n_int road_portal_side(n_int portal, n_int block_number) {
+    return (portal * 2) + (road_portals[portal].block[1] == block_number);
+}
+
+// Adds the walk inside the block between two sides of its portals, without the first side's node
+static void road_plan_walk(int_list *route, n_int block_number, n_int from, n_int to) {
+    road_block *block = &road_blocks[block_number];
+    road_portal_cache *cache = block->cache;
+    n_c_int *parent = &cache->parent[road_side_place[from] * cache->nodes];
+    n_int place = cache->entry[road_side_place[to]];
+    n_int first_place = cache->entry[road_side_place[from]];
+    n_uint first = route->count;
+    while (place != first_place) {
+        int_list_copy(route, road_block_node[block->first + place]);
+        place = parent[place];
+    }
+    road_route_reverse(route, first);
+}
+
+// A route from the start node to the end node over the portals between the blocks of the neighborhood.
+// The start and the end are joined to the portals of their blocks with a search inside each block, the
+// portals are searched with A* over the kept costs inside each block and the walks behind those costs
+// make the route. Every road crossing between two blocks goes through the one portal, so the route can
+// be longer than road_route's, in return the search sees about two portals for each block rather than
+// every node. Routes within a block of each other, or that the portals can't make, are left to
+// road_route.
+// Returns the cost of the route and adds the nodes from the start to the end to the route, or -1 if
+// there is no route.
+n_int road_plan(road_search *search, n_int start, n_int end, int_list *route) {
+    road_search *portals;
+    n_int start_block, end_block;
+    n_c_int *end_landmark;
+    n_uint generation;
+    n_int best = ROAD_UNREACHED, best_portal = -1;
+    n_int loop;
+
+    if ((search == 0L) || (start < 0) || (end < 0) || (start >= road_node_count) || (end >= road_node_count)) {
+        return -1;
+    }
+    if (road_component[start] != road_component[end]) {
+        return -1;
+    }
+    start_block = road_node_block[start];
+    end_block = road_node_block[end];
+    if ((labs(road_blocks[start_block].block_x - road_blocks[end_block].block_x) < 2) &&
+        (labs(road_blocks[start_block].block_y - road_blocks[end_block].block_y) < 2)) {
+        return road_route(search, start, end, route);
+    }
+    if (search->portals == 0L) {
+        search->portals = road_search_new();
+        if (search->portals == 0L) {
+            return SHOW_ERROR("Road portal search not allocated");
+        }
+    }
+    portals = search->portals;
+    if ((road_search_size(portals, road_portal_count) != 0) || (road_local_size(&search->start) != 0) ||
+        (road_local_size(&search->end) != 0)) {
+        return -1;
+    }
+
+    road_local_search(&search->start, start);
+    road_local_search(&search->end, end);
+
+    generation = ++portals->generation;
+    end_landmark = &road_landmark[end * ROAD_LANDMARKS];
+    portals->heap.count = 0;
+
+    // out from the start to the middle of each portal of its block
+    loop = 0;
+    while (loop < road_blocks[start_block].sides) {
+        n_int side = road_block_side[road_blocks[start_block].side_first + loop];
+        n_int cost = search->start.cost[road_node_place[road_side_node(side)]];
+        if (cost != ROAD_UNREACHED) {
+            road_plan_reach(portals, -1, side >> 1, (2 * cost) + road_portals[side >> 1].cost, end_landmark);
+        }
+        loop++;
+    }
+
+    while (portals->heap.count) {
+        n_int portal = road_heap_pop(&portals->heap);
+        n_int parent = portals->parent[portal];
+        n_int side, block_number, place;
+        road_portal_cache *cache;
+
+        if (portals->estimate[portal] >= best) {
+            break;
+        }
+        portals->closed[portal] = generation;
+
+        // going back into the block the portal was reached from is never shorter than going on from
+        // the portal before, so only the block across the portal is searched
+        if (parent == -1) {
+            side = (road_portals[portal].block[0] == start_block);
+        } else {
+            side = (road_portals[portal].block[0] == road_portals[parent].block[0]) ||
+                   (road_portals[portal].block[0] == road_portals[parent].block[1]);
+        }
+        block_number = road_portals[portal].block[side];
+
+        if (block_number == end_block) {
+            n_int rest = search->end.cost[road_node_place[road_portals[portal].node[side]]];
+            n_int cost = portals->cost[portal] + road_portals[portal].cost + (2 * rest);
+            if ((rest != ROAD_UNREACHED) && (cost < best)) {
+                best = cost;
+                best_portal = portal;
+            }
+        }
+        // every portal of the start block is reached from the start
+        if (block_number == start_block) {
+            continue;
+        }
+        cache = road_block_cache(block_number, &search->fill);
+        if (cache == 0L) {
+            return -1;
+        }
+        place = road_side_place[(portal * 2) + side];
+        loop = 0;
+        while (loop < cache->sides) {
+            n_int cost = cache->cost[(place * cache->sides) + loop];
+            if ((loop != place) && (cost >= 0)) {
+                n_int next = road_block_side[road_blocks[block_number].side_first + loop] >> 1;
+                road_plan_reach(portals, portal, next,
+                                portals->cost[portal] + road_portals[portal].cost + (2 * cost) + road_portals[next].cost,
+                                end_landmark);
+            }
+            loop++;
+        }
+    }
+
+    if (best_portal == -1) {
+        return road_route(search, start, end, route);
+    }
+
+    if (route) {
+        n_int *order = portals->heap.nodes;
+        n_int count = 0;
+        n_int portal = best_portal;
+        n_int side, place;
+        n_uint first = route->count;
+
+        // the portals from the start to the end
+        while (portal != -1) {
+            count++;
+            portal = portals->parent[portal];
+        }
+        portal = best_portal;
+        loop = count;
+        while (portal != -1) {
+            order[--loop] = portal;
+            portal = portals->parent[portal];
+        }
+
+        // from the start to the first portal
+        side = road_portal_side(order[0], start_block);
+        place = road_node_place[road_side_node(side)];
+        while (place != -1) {
+            int_list_copy(route, road_block_node[road_blocks[start_block].first + place]);
+            place = search->start.parent[place];
+        }
+        road_route_reverse(route, first);
+
+        // across each portal and along the block it shares with the next
+        loop = 1;
+        while (loop <= count) {
+            n_int next_block;
+            side ^= 1;
+            int_list_copy(route, road_side_node(side));
+            next_block = road_portals[side >> 1].block[side & 1];
+            if (loop < count) {
+                n_int next = road_portal_side(order[loop], next_block);
+                road_plan_walk(route, next_block, side, next);
+                side = next;
+            }
+            loop++;
+        }
+
+        // and from the last portal to the end
+        place = search->end.parent[road_node_place[road_side_node(side)]];
+        while (place != -1) {
+            int_list_copy(route, road_block_node[road_blocks[end_block].first + place]);
+            place = search->end.parent[place];
+        }
+    }
+    return best / 2;
+}
@@ -0,0 +1,589 @@
+/****************************************************************
+ 
+ visibility.c
+ 
+ =============================================================
+ 
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+ 
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+ 
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+ 
+ ****************************************************************/
+
+#include "mushroom.h"
+#include "toolkit.h"
+
+#include <stdlib.h>
+
+// The walls are put in a grid of this many cells a side to find the ones that cross
+#define VISIBILITY_CROSSING_GRID (64)
+
+// A wall seen from the agent, relative to the agent and turning counterclockwise from start to end.
+// Walls across the zero angle are split in two so every wall covers a single range of angles.
+typedef struct {
+    n_double start_x, start_y;
+    n_double end_x, end_y;
+    n_double angle_start;
+    n_double angle_end;
+} visibility_wall;
+
+static visibility_wall *walls = 0L;
+static n_int *walls_by_start = 0L;
+static n_int *walls_by_end = 0L;
+static n_int *heap = 0L;
+static n_int *heap_position = 0L;
+static n_int walls_count = 0;
+
+// The visibility polygon is the nearest wall over each range of angles
+static n_double *sector_angle = 0L;
+static n_int *sector_wall = 0L;
+static n_int sector_count = 0;
+
+// Two walls in view at the same time that cross swap which is nearer at the angle they cross
+typedef struct {
+    n_double angle;
+    n_int first;
+    n_int second;
+} visibility_crossing;
+
+static n_vect2 *polygon = 0L;
+static n_int polygon_count = 0;
+
+static n_vect2 visibility_origin;
+static n_byte visibility_valid = 0;
+
+static n_double heap_direction_x;
+static n_double heap_direction_y;
+
+// Pseudo angle from 0 to 4 counterclockwise from the x axis, it orders directions like the angle does
+static n_double visibility_angle(n_double x, n_double y) {
+    if (y >= 0) {
+        return (x >= 0) ? (y / (x + y)) : (1 + (-x / (y - x)));
+    }
+    return (x < 0) ? (2 + (-y / (-x - y))) : (3 + (x / (x - y)));
+}
+
+// A direction with the pseudo angle
+static void visibility_direction(n_double angle, n_double *x, n_double *y) {
+    if (angle < 1) {
+        *x = 1 - angle;
+        *y = angle;
+    } else if (angle < 2) {
+        *x = 1 - angle;
+        *y = 2 - angle;
+    } else if (angle < 3) {
+        *x = angle - 3;
+        *y = 2 - angle;
+    } else {
+        *x = angle - 3;
+        *y = angle - 4;
+    }
+}
+
+// How far along the direction the wall is, in lengths of the direction
+static n_double visibility_distance(visibility_wall *wall, n_double x, n_double y) {
+    n_double wall_x = wall->end_x - wall->start_x;
+    n_double wall_y = wall->end_y - wall->start_y;
+    n_double denominator = (x * wall_y) - (y * wall_x);
+    if (denominator == 0) {
+        return -1;
+    }
+    return ((wall->start_x * wall_y) - (wall->start_y * wall_x)) / denominator;
+}
+
+// Walls seen from a point only meet at their ends or where they cross, so while two walls are both in
+// view their order only changes at a crossing and the heap can compare them at the current direction
+// of the sweep
+static n_int visibility_nearer(n_int first, n_int second) {
+    return visibility_distance(&walls[heap[first]], heap_direction_x, heap_direction_y) <
+           visibility_distance(&walls[heap[second]], heap_direction_x, heap_direction_y);
+}
+
+static void visibility_heap_swap(n_int first, n_int second) {
+    n_int temp = heap[first];
+    heap[first] = heap[second];
+    heap[second] = temp;
+    heap_position[heap[first]] = first;
+    heap_position[heap[second]] = second;
+}
+
+static void visibility_heap_fix(n_int location, n_int count) {
+    while ((location > 0) && visibility_nearer(location, (location - 1) / 2)) {
+        visibility_heap_swap(location, (location - 1) / 2);
+        location = (location - 1) / 2;
+    }
+    while (1) {
+        n_int child = (location * 2) + 1;
+        if (child >= count) {
+            break;
+        }
+        if (((child + 1) < count) && visibility_nearer(child + 1, child)) {
+            child++;
+        }
+        if (!visibility_nearer(child, location)) {
+            break;
+        }
+        visibility_heap_swap(location, child);
+        location = child;
+    }
+}
+
+// Puts the wall back in order if it is still in the heap
+static void visibility_heap_reorder(n_int wall, n_int count) {
+    n_int location = heap_position[wall];
+    if ((location != -1) && (location < count) && (heap[location] == wall)) {
+        visibility_heap_fix(location, count);
+    }
+}
+
+static int visibility_compare_start(const void *a, const void *b) {
+    n_double first = walls[*(const n_int *)a].angle_start;
+    n_double second = walls[*(const n_int *)b].angle_start;
+    return (first > second) - (first < second);
+}
+
+static int visibility_compare_end(const void *a, const void *b) {
+    n_double first = walls[*(const n_int *)a].angle_end;
+    n_double second = walls[*(const n_int *)b].angle_end;
+    return (first > second) - (first < second);
+}
+
+static int visibility_compare_angle(const void *a, const void *b) {
+    n_double first = *(const n_double *)a;
+    n_double second = *(const n_double *)b;
+    return (first > second) - (first < second);
+}
+
+static int visibility_compare_crossing(const void *a, const void *b) {
+    n_double first = ((const visibility_crossing *)a)->angle;
+    n_double second = ((const visibility_crossing *)b)->angle;
+    return (first > second) - (first < second);
+}
+
+// Whether the walls cross away from their ends and the angle of where they cross. The ends of each wall
+// have to be either side of the other, most pairs are turned away by the first.
+static n_byte visibility_cross(visibility_wall *first, visibility_wall *second, n_double *angle) {
+    n_double first_x = first->end_x - first->start_x;
+    n_double first_y = first->end_y - first->start_y;
+    n_double second_x = second->end_x - second->start_x;
+    n_double second_y = second->end_y - second->start_y;
+    n_double side_start = (first_x * (second->start_y - first->start_y)) - (first_y * (second->start_x - first->start_x));
+    n_double side_end = (first_x * (second->end_y - first->start_y)) - (first_y * (second->end_x - first->start_x));
+    n_double side_first, side_last, along;
+
+    if (!(((side_start < 0) && (side_end > 0)) || ((side_start > 0) && (side_end < 0)))) {
+        return 0;
+    }
+    side_first = (second_x * (first->start_y - second->start_y)) - (second_y * (first->start_x - second->start_x));
+    side_last = (second_x * (first->end_y - second->start_y)) - (second_y * (first->end_x - second->start_x));
+    if (!(((side_first < 0) && (side_last > 0)) || ((side_first > 0) && (side_last < 0)))) {
+        return 0;
+    }
+    along = side_start / (side_start - side_end);
+    *angle = visibility_angle(second->start_x + (along * second_x), second->start_y + (along * second_y));
+    return 1;
+}
+
+// The grid cells covered by the box around the wall, the low corner of the grid and the size of its
+// cells are the first three values of the grid
+static void visibility_cells(visibility_wall *wall, n_double *grid, n_int *cells) {
+    n_double low_x = (wall->start_x < wall->end_x) ? wall->start_x : wall->end_x;
+    n_double low_y = (wall->start_y < wall->end_y) ? wall->start_y : wall->end_y;
+    n_double high_x = (wall->start_x < wall->end_x) ? wall->end_x : wall->start_x;
+    n_double high_y = (wall->start_y < wall->end_y) ? wall->end_y : wall->start_y;
+    cells[0] = (n_int)((low_x - grid[0]) / grid[2]);
+    cells[1] = (n_int)((low_y - grid[1]) / grid[2]);
+    cells[2] = (n_int)((high_x - grid[0]) / grid[2]);
+    cells[3] = (n_int)((high_y - grid[1]) / grid[2]);
+}
+
+// Fences can cross walls and each other. The walls are put in a grid by the box around each, and a
+// pair of walls is only tested in the cell where their boxes start to overlap.
+static n_int visibility_crossings(memory_list *crossings) {
+    n_double grid[3];
+    n_double high_x = 0, high_y = 0;
+    n_int *cell_start, *cell_wall, *wall_low;
+    n_int cells[4];
+    n_int loop, cell_x, cell_y;
+
+    if (walls_count == 0) {
+        return 0;
+    }
+    for (loop = 0; loop < walls_count; loop++) {
+        visibility_wall *wall = &walls[loop];
+        n_double low_x = (wall->start_x < wall->end_x) ? wall->start_x : wall->end_x;
+        n_double low_y = (wall->start_y < wall->end_y) ? wall->start_y : wall->end_y;
+        n_double far_x = (wall->start_x < wall->end_x) ? wall->end_x : wall->start_x;
+        n_double far_y = (wall->start_y < wall->end_y) ? wall->end_y : wall->start_y;
+        if ((loop == 0) || (low_x < grid[0])) grid[0] = low_x;
+        if ((loop == 0) || (low_y < grid[1])) grid[1] = low_y;
+        if ((loop == 0) || (far_x > high_x)) high_x = far_x;
+        if ((loop == 0) || (far_y > high_y)) high_y = far_y;
+    }
+    grid[2] = (((high_x - grid[0]) > (high_y - grid[1])) ? (high_x - grid[0]) : (high_y - grid[1]));
+    grid[2] = (grid[2] / VISIBILITY_CROSSING_GRID) + 1;
+
+    cell_start = (n_int *)memory_new(sizeof(n_int) * ((VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID) + 1));
+    wall_low = (n_int *)memory_new(sizeof(n_int) * 2 * (n_uint)walls_count);
+    if ((cell_start == 0L) || (wall_low == 0L)) {
+        memory_free((void **)&cell_start);
+        memory_free((void **)&wall_low);
+        return SHOW_ERROR("Visibility crossings not allocated");
+    }
+    memory_erase((n_byte *)cell_start, sizeof(n_int) * ((VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID) + 1));
+
+    // count the walls in each cell, then place them
+    for (loop = 0; loop < walls_count; loop++) {
+        visibility_cells(&walls[loop], grid, cells);
+        wall_low[(loop * 2)] = cells[0];
+        wall_low[(loop * 2) + 1] = cells[1];
+        for (cell_y = cells[1]; cell_y <= cells[3]; cell_y++) {
+            for (cell_x = cells[0]; cell_x <= cells[2]; cell_x++) {
+                cell_start[(cell_y * VISIBILITY_CROSSING_GRID) + cell_x + 1]++;
+            }
+        }
+    }
+    for (loop = 0; loop < (VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID); loop++) {
+        cell_start[loop + 1] += cell_start[loop];
+    }
+    cell_wall = (n_int *)memory_new(sizeof(n_int) * (n_uint)(cell_start[VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID] + 1));
+    if (cell_wall == 0L) {
+        memory_free((void **)&cell_start);
+        memory_free((void **)&wall_low);
+        return SHOW_ERROR("Visibility crossings not allocated");
+    }
+    for (loop = 0; loop < walls_count; loop++) {
+        visibility_cells(&walls[loop], grid, cells);
+        for (cell_y = cells[1]; cell_y <= cells[3]; cell_y++) {
+            for (cell_x = cells[0]; cell_x <= cells[2]; cell_x++) {
+                cell_wall[cell_start[(cell_y * VISIBILITY_CROSSING_GRID) + cell_x]++] = loop;
+            }
+        }
+    }
+    // placing moved each start on to the start of the next cell
+    for (loop = (VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID); loop > 0; loop--) {
+        cell_start[loop] = cell_start[loop - 1];
+    }
+    cell_start[0] = 0;
+
+    for (loop = 0; loop < (VISIBILITY_CROSSING_GRID * VISIBILITY_CROSSING_GRID); loop++) {
+        n_int first = cell_start[loop];
+        while (first < cell_start[loop + 1]) {
+            n_int one = cell_wall[first];
+            n_int second = first + 1;
+            while (second < cell_start[loop + 1]) {
+                n_int other = cell_wall[second++];
+                visibility_crossing crossing;
+                // the cell where the boxes start to overlap
+                cell_x = (wall_low[(one * 2)] > wall_low[(other * 2)]) ? wall_low[(one * 2)] : wall_low[(other * 2)];
+                cell_y = (wall_low[(one * 2) + 1] > wall_low[(other * 2) + 1]) ? wall_low[(one * 2) + 1] : wall_low[(other * 2) + 1];
+                if ((((cell_y * VISIBILITY_CROSSING_GRID) + cell_x) == loop) &&
+                    visibility_cross(&walls[one], &walls[other], &crossing.angle)) {
+                    crossing.first = one;
+                    crossing.second = other;
+                    memory_list_copy(crossings, (n_byte *)&crossing, sizeof(visibility_crossing));
+                }
+            }
+            first++;
+        }
+    }
+    memory_free((void **)&cell_wall);
+    memory_free((void **)&wall_low);
+    memory_free((void **)&cell_start);
+    return 0;
+}
+
+static void visibility_free(void) {
+    memory_free((void **)&walls);
+    memory_free((void **)&walls_by_start);
+    memory_free((void **)&walls_by_end);
+    memory_free((void **)&heap);
+    memory_free((void **)&heap_position);
+    memory_free((void **)&sector_angle);
+    memory_free((void **)&sector_wall);
+    memory_free((void **)&polygon);
+    walls_count = 0;
+    sector_count = 0;
+    polygon_count = 0;
+}
+
+static void visibility_add_wall(n_double start_x, n_double start_y, n_double end_x, n_double end_y) {
+    visibility_wall *wall = &walls[walls_count++];
+    wall->start_x = start_x;
+    wall->start_y = start_y;
+    wall->end_x = end_x;
+    wall->end_y = end_y;
+    wall->angle_start = visibility_angle(start_x, start_y);
+    wall->angle_end = visibility_angle(end_x, end_y);
+}
+
+// The point on the polygon edge at the angle, either on the nearest wall or at the edge of view
+static void visibility_polygon_point(n_int wall, n_double angle, n_vect2 *point) {
+    n_double x, y, distance, length;
+    visibility_direction(angle, &x, &y);
+    length = (n_double)math_root((n_uint)(((x * x) + (y * y)) * 4294967296.0)) / 65536;
+    distance = (n_double)VISIBILITY_RADIUS / length;
+    if (wall != -1) {
+        n_double wall_distance = visibility_distance(&walls[wall], x, y);
+        if ((wall_distance >= 0) && (wall_distance < distance)) {
+            distance = wall_distance;
+        }
+    }
+    point->x = visibility_origin.x + (n_int)(x * distance);
+    point->y = visibility_origin.y + (n_int)(y * distance);
+}
+
+// Sweeps the nearby walls counterclockwise around the agent. Each wall enters the heap at its first
+// angle and leaves at its last, and the nearest wall between two neighbouring angles is the top.
+static n_int visibility_compute(void) {
+    int_list *nearby = int_list_new(256);
+    memory_list *crossings;
+    visibility_crossing *crossing;
+    matrix_plane *recorded_walls = (matrix_plane *)matrix_draw_block()->data;
+    n_int *indices;
+    n_int loop, angles, next_start = 0, next_end = 0, next_crossing = 0, heap_count = 0;
+
+    visibility_free();
+    vect2_copy(&visibility_origin, agent_location());
+
+    if (nearby == 0L) {
+        return SHOW_ERROR("Visibility nearby walls not allocated");
+    }
+    matrix_nearby(&visibility_origin, VISIBILITY_RADIUS, nearby);
+    indices = (n_int *)nearby->data;
+
+    walls = (visibility_wall *)memory_new(sizeof(visibility_wall) * ((nearby->count * 2) + 1));
+    walls_by_start = (n_int *)memory_new(sizeof(n_int) * ((nearby->count * 2) + 1));
+    walls_by_end = (n_int *)memory_new(sizeof(n_int) * ((nearby->count * 2) + 1));
+    heap = (n_int *)memory_new(sizeof(n_int) * ((nearby->count * 2) + 1));
+    heap_position = (n_int *)memory_new(sizeof(n_int) * ((nearby->count * 2) + 1));
+
+    if ((walls == 0L) || (walls_by_start == 0L) || (walls_by_end == 0L) || (heap == 0L) ||
+        (heap_position == 0L)) {
+        int_list_free(&nearby);
+        visibility_free();
+        return SHOW_ERROR("Visibility not allocated");
+    }
+
+    for (loop = 0; loop < (n_int)nearby->count; loop++) {
+        matrix_plane *plane = &recorded_walls[indices[loop]];
+        n_double start_x = (n_double)(plane->start.x - visibility_origin.x);
+        n_double start_y = (n_double)(plane->start.y - visibility_origin.y);
+        n_double end_x = (n_double)(plane->end.x - visibility_origin.x);
+        n_double end_y = (n_double)(plane->end.y - visibility_origin.y);
+        n_double turn = (start_x * end_y) - (start_y * end_x);
+
+        // walls in line with the agent hide nothing
+        if (turn == 0) {
+            continue;
+        }
+        if (turn < 0) {
+            n_double temp_x = start_x, temp_y = start_y;
+            start_x = end_x;
+            start_y = end_y;
+            end_x = temp_x;
+            end_y = temp_y;
+        }
+        visibility_add_wall(start_x, start_y, end_x, end_y);
+        if ((walls[walls_count - 1].angle_end < walls[walls_count - 1].angle_start) && (end_y != 0)) {
+            // across the zero angle, split where the wall crosses the x axis
+            n_double cross_x = start_x - (start_y * (end_x - start_x) / (end_y - start_y));
+            walls[walls_count - 1].end_x = cross_x;
+            walls[walls_count - 1].end_y = 0;
+            walls[walls_count - 1].angle_end = 4;
+            visibility_add_wall(cross_x, 0, end_x, end_y);
+            walls[walls_count - 1].angle_start = 0;
+        }
+    }
+    int_list_free(&nearby);
+
+    for (loop = 0; loop < walls_count; loop++) {
+        walls_by_start[loop] = loop;
+        walls_by_end[loop] = loop;
+        heap_position[loop] = -1;
+    }
+    qsort(walls_by_start, (size_t)walls_count, sizeof(n_int), visibility_compare_start);
+    qsort(walls_by_end, (size_t)walls_count, sizeof(n_int), visibility_compare_end);
+
+    crossings = memory_list_new(sizeof(visibility_crossing), 64);
+    if ((crossings == 0L) || (visibility_crossings(crossings) != 0)) {
+        memory_list_free(&crossings);
+        visibility_free();
+        return SHOW_ERROR("Visibility crossings not found");
+    }
+    crossing = (visibility_crossing *)crossings->data;
+    qsort(crossing, crossings->count, sizeof(visibility_crossing), visibility_compare_crossing);
+
+    sector_angle = (n_double *)memory_new(sizeof(n_double) * ((n_uint)(walls_count * 2) + crossings->count + 2));
+    sector_wall = (n_int *)memory_new(sizeof(n_int) * ((n_uint)(walls_count * 2) + crossings->count + 2));
+    if ((sector_angle == 0L) || (sector_wall == 0L)) {
+        memory_list_free(&crossings);
+        visibility_free();
+        return SHOW_ERROR("Visibility sectors not allocated");
+    }
+
+    angles = 0;
+    sector_angle[angles++] = 0;
+    sector_angle[angles++] = 4;
+    for (loop = 0; loop < walls_count; loop++) {
+        sector_angle[angles++] = walls[loop].angle_start;
+        sector_angle[angles++] = walls[loop].angle_end;
+    }
+    for (loop = 0; loop < (n_int)crossings->count; loop++) {
+        sector_angle[angles++] = crossing[loop].angle;
+    }
+    qsort(sector_angle, (size_t)angles, sizeof(n_double), visibility_compare_angle);
+
+    sector_count = 0;
+    for (loop = 0; loop < angles; loop++) {
+        if ((sector_count == 0) || (sector_angle[sector_count - 1] != sector_angle[loop])) {
+            sector_angle[sector_count++] = sector_angle[loop];
+        }
+    }
+
+    // the last angle is 4, it closes the sectors
+    angles = 0;
+    for (loop = 0; loop < (sector_count - 1); loop++) {
+        n_double angle = sector_angle[loop];
+        n_byte wall_event = 0;
+        n_int nearest;
+        visibility_direction((angle + sector_angle[loop + 1]) / 2, &heap_direction_x, &heap_direction_y);
+
+        while ((next_end < walls_count) && (walls[walls_by_end[next_end]].angle_end <= angle)) {
+            n_int wall = walls_by_end[next_end++];
+            wall_event = 1;
+            n_int location = heap_position[wall];
+            if ((location != -1) && (location < heap_count) && (heap[location] == wall)) {
+                heap_count--;
+                if (location != heap_count) {
+                    visibility_heap_swap(location, heap_count);
+                    visibility_heap_fix(location, heap_count);
+                }
+            }
+        }
+        while ((next_start < walls_count) && (walls[walls_by_start[next_start]].angle_start <= angle)) {
+            n_int wall = walls_by_start[next_start++];
+            wall_event = 1;
+            heap[heap_count] = wall;
+            heap_position[wall] = heap_count;
+            visibility_heap_fix(heap_count, heap_count + 1);
+            heap_count++;
+        }
+        while ((next_crossing < (n_int)crossings->count) && (crossing[next_crossing].angle <= angle)) {
+            visibility_heap_reorder(crossing[next_crossing].first, heap_count);
+            visibility_heap_reorder(crossing[next_crossing].second, heap_count);
+            next_crossing++;
+        }
+        nearest = (heap_count > 0) ? heap[0] : -1;
+        // a crossing behind the nearest wall leaves the sector as it was
+        if ((angles > 0) && (wall_event == 0) && (sector_wall[angles - 1] == nearest)) {
+            continue;
+        }
+        sector_angle[angles] = angle;
+        sector_wall[angles++] = nearest;
+    }
+    sector_angle[angles++] = sector_angle[sector_count - 1];
+    sector_count = angles;
+    memory_list_free(&crossings);
+
+    polygon = (n_vect2 *)memory_new(sizeof(n_vect2) * (n_uint)(sector_count * 2));
+    if (polygon == 0L) {
+        visibility_free();
+        return SHOW_ERROR("Visibility polygon not allocated");
+    }
+    for (loop = 0; loop < (sector_count - 1); loop++) {
+        visibility_polygon_point(sector_wall[loop], sector_angle[loop], &polygon[polygon_count++]);
+        visibility_polygon_point(sector_wall[loop], sector_angle[loop + 1], &polygon[polygon_count++]);
+    }
+
+    visibility_valid = 1;
+    return 0;
+}
+
+// Called when the agent moves or the walls change
+void visibility_invalidate(void) {
+    visibility_valid = 0;
+}
+
+static n_int visibility_current(void) {
+    if (visibility_valid) {
+        return 0;
+    }
+    return visibility_compute();
+}
+
+// Whether the point is in view of the agent, a binary search of the sectors for the point's angle
+n_byte visibility_point(n_vect2 *point) {
+    n_double x, y, angle, distance;
+    n_int low = 0, high;
+
+    if (visibility_current() != 0) {
+        return 0;
+    }
+
+    x = (n_double)(point->x - visibility_origin.x);
+    y = (n_double)(point->y - visibility_origin.y);
+
+    if ((x == 0) && (y == 0)) {
+        return 1;
+    }
+    if (((x * x) + (y * y)) > ((n_double)VISIBILITY_RADIUS * (n_double)VISIBILITY_RADIUS)) {
+        return 0;
+    }
+
+    angle = visibility_angle(x, y);
+    high = sector_count - 2;
+    while (low < high) {
+        n_int middle = (low + high + 1) / 2;
+        if (sector_angle[middle] <= angle) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    if (sector_wall[low] == -1) {
+        return 1;
+    }
+    distance = visibility_distance(&walls[sector_wall[low]], x, y);
+    // on the wall counts as seen
+    return (distance < 0) || (distance >= 1);
+}
+
+// The visibility polygon around the agent, two points for each sector counterclockwise
+n_vect2 *visibility_polygon(n_int *count) {
+    if (visibility_current() != 0) {
+        *count = 0;
+        return 0L;
+    }
+    *count = polygon_count;
+    return polygon;
+}
+
+void visibility_close(void) {
+    visibility_free();
+    visibility_valid = 0;
+}
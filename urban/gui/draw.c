@@ -59,30 +59,76 @@
 /* dark grey 16, 24, 24 - wall color */
 /* dark grey 168, 151, 128 - room color */
 
-void draw_tree(simulated_tree * tree)
+/* the directions of the tree outline points are the same for every tree */
+static n_vect2 tree_direction[POINTS_PER_TREE];
+static n_byte  tree_direction_done = 0;
+
+/* each point of the tree outline is worked out once as the tree is drawn */
+static void draw_tree_outline(simulated_tree * tree, n_vect2 * outline)
 {
-    n_vect2 quad[4];
     n_vect2 unit[2] = {1, 1};
     n_int   loop = 0;
     
+    if (tree_direction_done == 0)
+    {
+        while (loop < POINTS_PER_TREE)
+        {
+            vect2_direction(&tree_direction[loop], loop * (256/POINTS_PER_TREE), 600);
+            loop++;
+        }
+        tree_direction_done = 1;
+        loop = 0;
+    }
     while (loop < POINTS_PER_TREE)
     {
-        vect2_copy(&quad[0], &tree->center);
-        
-        vect2_direction(&quad[1], loop * (256/POINTS_PER_TREE), 600);
-        vect2_multiplier(&quad[1], &quad[1], (n_vect2 *)&unit, tree->points[loop&(POINTS_PER_TREE-1)] * tree->radius, 360);
-        
+        n_vect2 edge;
+        vect2_multiplier(&edge, &tree_direction[loop], (n_vect2 *)&unit, tree->points[loop] * tree->radius, 360);
+        vect2_subtract(&outline[loop], &tree->center, &edge);
         loop++;
-        vect2_direction(&quad[2], loop * (256/POINTS_PER_TREE), 600);
-        vect2_multiplier(&quad[2], &quad[2], (n_vect2 *)&unit, tree->points[loop&(POINTS_PER_TREE-1)] * tree->radius, 360);
-        
+    }
+}
+
+/* far out the tree is a disc of two quads through every eighth point of its outline */
+static void draw_tree_disc(n_vect2 * outline)
+{
+    n_vect2 quad[4];
+    n_int   loop = 0;
+    
+    glrender_detail(GLR_DETAIL_FAR);
+    glrender_color(TREE_COLOR);
+    while (loop < 2)
+    {
+        vect2_copy(&quad[0], &outline[(loop * 4)]);
+        vect2_copy(&quad[1], &outline[(loop * 4) + 8]);
+        vect2_copy(&quad[2], &outline[(loop * 4) + 16]);
+        vect2_copy(&quad[3], &outline[(loop * 4) + 24]);
+        glrender_quads(quad, 1);
         loop++;
-        vect2_direction(&quad[3], loop * (256/POINTS_PER_TREE), 600);
-        vect2_multiplier(&quad[3], &quad[3], (n_vect2 *)&unit, tree->points[loop&(POINTS_PER_TREE-1)] * tree->radius, 360);
-        
-        vect2_subtract(&quad[1], &quad[0], &quad[1]);
-        vect2_subtract(&quad[2], &quad[0], &quad[2]);
-        vect2_subtract(&quad[3], &quad[0], &quad[3]);
+    }
+    glrender_detail(GLR_DETAIL_ALL);
+}
+
+void draw_tree(simulated_tree * tree)
+{
+    n_vect2 outline[POINTS_PER_TREE];
+    n_vect2 quad[4];
+    n_int   loop = 0;
+    
+    draw_tree_outline(tree, outline);
+    draw_tree_disc(outline);
+    
+    glrender_detail(GLR_DETAIL_NEAR);
+#ifdef DRAW_TREE_STAMPS
+    /* the renderer keeps the outline as one stamp placed by the center */
+    glrender_start_stamp();
+#endif
+    while (loop < POINTS_PER_TREE)
+    {
+        vect2_copy(&quad[0], &tree->center);
+        vect2_copy(&quad[1], &outline[loop]);
+        vect2_copy(&quad[2], &outline[loop + 1]);
+        vect2_copy(&quad[3], &outline[(loop + 2) & (POINTS_PER_TREE-1)]);
+        loop += 2;
 
         glrender_color(TREE_COLOR);
         
@@ -92,6 +138,10 @@ void draw_tree(simulated_tree * tree)
         glrender_line(&quad[2], &quad[3]);
         
     }
+#ifdef DRAW_TREE_STAMPS
+    glrender_end_stamp();
+#endif
+    glrender_detail(GLR_DETAIL_ALL);
 }
 
 void draw_each_fence(simulated_fence * fence)
@@ -99,9 +149,6 @@ void draw_each_fence(simulated_fence * fence)
     glrender_wide_line();
     glrender_color(FENCE_COLOR);
     glrender_line(&fence->points[0], &fence->points[1]);
-    
-    matrix_add_fence(&fence->points[0], &fence->points[1]);
-    
     glrender_thin_line();
 }
 
@@ -141,12 +188,15 @@ void draw_each_path(simulated_path * path)
     glrender_color(ROAD_COLOR);
 
     glrender_quads(&path->points[0], 1);
+    /* far out the outline of the filled road is enough */
+    glrender_detail(GLR_DETAIL_NEAR);
     glrender_wide_line();
     glrender_line(&path->points[0], &path->points[1]);
     glrender_line(&path->points[2], &path->points[1]);
     glrender_line(&path->points[2], &path->points[3]);
     glrender_line(&path->points[0], &path->points[3]);
     glrender_thin_line();
+    glrender_detail(GLR_DETAIL_ALL);
 #ifdef DEBUG_ROAD_NUMBER
     draw_debug_number_point(&path->points[0], 0);
     draw_debug_number_point(&path->points[1], 1);
@@ -200,6 +250,7 @@ void draw_park(simulated_park * park)
 
 static void draw_house_room(simulated_room * room, n_int room_number)
 {
+    glrender_detail(GLR_DETAIL_NEAR);
     glrender_color(WALL_COLOR);
     glrender_quads(&room->points[4], 1);
     glrender_wide_line();
@@ -213,11 +264,6 @@ static void draw_house_room(simulated_room * room, n_int room_number)
     glrender_color(ROOM_COLOR);
     glrender_quads(&room->points[0], 0);
     
-    matrix_add_wall(&room->points[0], &room->points[1]);
-    matrix_add_wall(&room->points[1], &room->points[2]);
-    matrix_add_wall(&room->points[2], &room->points[3]);
-    matrix_add_wall(&room->points[3], &room->points[0]);
-    
     glrender_color(WINDOW_COLOR);
 
     if (house_window_present(&room->points[8]))
@@ -236,6 +282,7 @@ static void draw_house_room(simulated_room * room, n_int room_number)
     {
         glrender_line(&room->points[14], &room->points[15]);
     }
+    glrender_detail(GLR_DETAIL_ALL);
 #ifdef DEBUG_ROOM_NUMBER
     draw_debug_number_fill(room->points, room_number);
 #endif
@@ -245,6 +292,7 @@ static void draw_house_door(simulated_room * room)
 {
     glrender_color(DOOR_COLOR);
 
+    glrender_detail(GLR_DETAIL_NEAR);
     glrender_wide_line();
     
     if (house_door_present(&room->points[16]))
@@ -286,12 +334,64 @@ static void draw_house_door(simulated_room * room)
         glrender_line(&room->points[28], &room->points[31]);
     }
     glrender_thin_line();
+    glrender_detail(GLR_DETAIL_ALL);
 
 }
 
+/* far out the building is one filled quad around the walls of its rooms, the rooms all share the
+   turn of the first room's walls */
+static void draw_house_footprint(simulated_building * building)
+{
+    n_vect2 * origin = &building->room[0].points[4];
+    n_vect2   along, across, footprint[4];
+    n_double  along_length, across_length;
+    n_double  low_along = 0, high_along = 0, low_across = 0, high_across = 0;
+    n_int     loop = 0;
+    
+    vect2_subtract(&along, &building->room[0].points[5], origin);
+    vect2_subtract(&across, &building->room[0].points[7], origin);
+    along_length = (n_double)((along.x * along.x) + (along.y * along.y));
+    across_length = (n_double)((across.x * across.x) + (across.y * across.y));
+    if ((along_length == 0) || (across_length == 0))
+    {
+        return;
+    }
+    while (loop < (building->roomcount * 4))
+    {
+        n_vect2 * corner = &building->room[loop >> 2].points[4 + (loop & 3)];
+        n_double  x = (n_double)(corner->x - origin->x);
+        n_double  y = (n_double)(corner->y - origin->y);
+        n_double  on_along = ((x * along.x) + (y * along.y)) / along_length;
+        n_double  on_across = ((x * across.x) + (y * across.y)) / across_length;
+        if (on_along < low_along) low_along = on_along;
+        if (on_along > high_along) high_along = on_along;
+        if (on_across < low_across) low_across = on_across;
+        if (on_across > high_across) high_across = on_across;
+        loop++;
+    }
+    loop = 0;
+    while (loop < 4)
+    {
+        n_double on_along = ((loop == 1) || (loop == 2)) ? high_along : low_along;
+        n_double on_across = (loop > 1) ? high_across : low_across;
+        footprint[loop].x = origin->x + (n_int)((on_along * along.x) + (on_across * across.x));
+        footprint[loop].y = origin->y + (n_int)((on_along * along.y) + (on_across * across.y));
+        loop++;
+    }
+    glrender_detail(GLR_DETAIL_FAR);
+    glrender_color(WALL_COLOR);
+    glrender_quads(footprint, 1);
+    glrender_thin_line();
+    glrender_detail(GLR_DETAIL_ALL);
+}
+
 static void draw_each_house(simulated_building * building)
 {
     n_int   loop = 0;
+    if (building->roomcount > 0)
+    {
+        draw_house_footprint(building);
+    }
     while (loop < building->roomcount)
     {
         draw_house_room(&building->room[loop], loop);
@@ -352,55 +452,57 @@ void draw_neighborhood(void)
     count = 0;
     while (count < fence_count)
     {
-        draw_fence(&fences[count++]);
+        draw_each_fence(&fences[count++]);
     }
 }
 
 static void draw_city(void)
 {
-//    simulated_being *beings = city_beings();
-//    n_uint beings_number = city_beings_number();
-//    n_uint loop = 0;
-    /*n_int  line_count = 0;
-    matrix_plane * span_values;*/
+    int_list * beings = int_list_new(256);
+    n_int loop = 0;
+    
+    if (beings == 0L)
+    {
+        return;
+    }
+    
+    population_nearby(agent_location(), POPULATION_DRAW_RADIUS, beings);
     
     glrender_color(ENTITY_COLOR);
     
     glrender_wide_line();
-//    while (loop < beings_number)
-//    {
-//        n_vect2 line_start;
-//        n_vect2 line_end;
-//        n_vect2 facing;
-//        
-////        line_start.x = line_end.x = being_location_x(&beings[loop]);
-////        line_start.y = line_end.y = being_location_y(&beings[loop]);
-////        
-////        being_facing_vector(&beings[loop], &facing, 50);
-////        
-//        city_translate(&line_start);
-//        city_translate(&line_end);
-//        
-//        vect2_add(&facing, &line_start, &facing);
-//        
-//        glrender_line(&line_start, &facing);
-//        
-//        line_start.x -= 5;
-//        line_end.x += 5;
-//        
-//        glrender_line(&line_start, &line_end);
-//        
-//        line_start.x += 5;
-//        line_end.x -= 5;
-//        
-//        line_start.y -= 5;
-//        line_end.y += 5;
-//        
-//        glrender_line(&line_start, &line_end);
-//        
-//        loop++;
-//    }
-
+    while (loop < (n_int)beings->count)
+    {
+        n_int   being = ((n_int *)beings->data)[loop];
+        n_vect2 line_start;
+        n_vect2 line_end;
+        n_vect2 facing;
+        
+        population_location(being, &line_start);
+        vect2_copy(&line_end, &line_start);
+        
+        vect2_direction(&facing, (128 + 64 + 256 - population_facing(being)) & 255, 26880 / 50);
+        vect2_add(&facing, &line_start, &facing);
+        
+        glrender_line(&line_start, &facing);
+        
+        line_start.x -= 5;
+        line_end.x += 5;
+        
+        glrender_line(&line_start, &line_end);
+        
+        line_start.x += 5;
+        line_end.x -= 5;
+        
+        line_start.y -= 5;
+        line_end.y += 5;
+        
+        glrender_line(&line_start, &line_end);
+        
+        loop++;
+    }
+    
+    int_list_free(&beings);
 }
 
 void draw_game_color(n_byte2 * fit)
@@ -433,23 +535,30 @@ n_int draw_game_scene(n_int dim_x, n_int dim_y)
     return draw_game_scene_done;
 }
 
-void draw_render(n_byte * buffer, n_int dim_x, n_int dim_y)
+/// Rebuilds the display list on the next scene, used when the resident cells change.
+void draw_game_refresh(void)
+{
+    glrender_scene_reset();
+}
+
+/// Returns 0 when the buffer already holds this frame.
+n_int draw_render(n_byte * buffer, n_int dim_x, n_int dim_y)
 {
     glrender_set_size(dim_x, dim_y);
-    printf("%ld, %ld", dim_x, dim_y);
     // like buffer == 0
-    if (buffer)
+    if (buffer == 0L)
     {
-        glrender_render_display(buffer);
+        return 0;
     }
-    if (buffer)
-    {
-        glrender_render_active(buffer);
 #ifdef DEBUG_BLOCKING_BOUNDARIES
-        glrender_render_lines(buffer, matrix_draw_block());
-        glrender_render_lines(buffer, matrix_draw_identifier());
+    glrender_render_display(buffer);
+    glrender_render_active(buffer);
+    glrender_render_lines(buffer, matrix_draw_block());
+    glrender_render_lines(buffer, matrix_draw_identifier());
+    return 1;
+#else
+    return glrender_render_frame(buffer);
 #endif
-    }
 }
 
 void draw_init(void)
@@ -468,12 +577,12 @@ void draw_init(void)
 //    glrender_color_map_replace((n_byte4*)old_color);
     
     glrender_init();
-    
-    matrix_init();
+#ifdef DRAW_TILE_PYRAMID
+    glrender_tile_budget(DRAW_TILE_BUDGET);
+#endif
 }
 
 void draw_close(void)
 {
     glrender_close();
-    matrix_close();
 }
@@ -47,6 +47,9 @@ static n_byte  key_down = 0;
 static n_byte * outputBuffer = 0L;
 static n_byte * outputBufferOld = 0L;
 static n_int    outputBufferMax = -1;
+static n_byte * outputBufferThree = 0L; // the screen as three byte pixels for saving
+static n_int    outputBufferThreeMax = 0;
+static n_byte   outputBufferThreeStale = 1; // the three byte copy no longer matches the screen
 
 extern n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number);
 
@@ -94,8 +97,27 @@ n_int shared_init(n_int view, n_uint random)
     math_random(seed);
     math_random(seed);
     
-    neighborhood_init(seed);
+#ifdef NEIGHBORHOOD_STREAMING
+    if (neighborhood_stream_init(seed, NEIGHBORHOOD_STREAM_RADIUS) != 0)
+    {
+        return -1;
+    }
+#else
+    if (neighborhood_init(seed, TWO_BLOCK_EDGE, TWO_BLOCK_EDGE) != 0)
+    {
+        return -1;
+    }
+#endif
     agent_init();
+    if (neighborhood_stream_cycle(agent_location()) == -1)
+    {
+        return -1;
+    }
+    
+    if (population_init(seed, MAX_NUMBER_APES, agent_location(), (TWO_BLOCK_EDGE * NEIGHBORHOOD_UNIT_SPACE) / 2) != 0)
+    {
+        return -1;
+    }
     
     return 0;
 }
@@ -112,7 +134,17 @@ void shared_close(void)
         memory_free((void**)&outputBuffer);
     }
     
+    if (outputBufferThree)
+    {
+        memory_free((void**)&outputBufferThree);
+        outputBufferThreeMax = 0;
+        outputBufferThreeStale = 1;
+    }
+    
     draw_close();
+    population_close();
+    neighborhood_close();
+    execute_close();
 }
 
 n_int shared_menu(n_int menuValue)
@@ -209,24 +241,9 @@ static n_byte * shared_output_buffer(n_int width, n_int height)
     return outputBuffer; // Outputbuffer is 0L
 }
 
-n_byte * shared_convert_4_to_3(n_byte * copy_in,  n_uint size)
+void shared_convert_4_to_3(n_byte * copy_in, n_byte * copy_out, n_uint size)
 {
-    n_byte *return_value = memory_new( size * 3 );
-    if (return_value == 0L)
-    {
-        return 0L;
-    }
-    n_uint loop = 0, loop3 = 0, loop4 = 0;
-    while (loop < size)
-    {
-        loop4++;
-
-        return_value[ loop3 ++] = copy_in[ loop4++];
-        return_value[ loop3 ++] = copy_in[ loop4++];
-        return_value[ loop3 ++] = copy_in[ loop4++];
-        loop++;
-    }
-    return return_value;
+    graph_convert_4_to_3(copy_in, copy_out, size);
 }
 
 n_byte * shared_draw(n_int fIdentification, n_int dim_x, n_int dim_y, n_byte size_changed)
@@ -290,17 +307,51 @@ n_byte * shared_draw(n_int fIdentification, n_int dim_x, n_int dim_y, n_byte siz
     agent_turn(turn_delta);
     agent_zoom(zoomed_delta);
     agent_move(move_delta);
+    /* an error is shown by the stream and leaves the resident cells as they were, so nothing is
+       refreshed and the agent's cell is streamed again next frame */
+    if (neighborhood_stream_cycle(agent_location()) == 1)
+    {
+        draw_game_refresh();
+    }
     agent_cycle();
-//    city_cycle();
+    population_cycle();
+    if (size_changed)
+    {
+        outputBufferThreeStale = 1;
+    }
     if (draw_game_scene(dim_x, dim_y))
     {
-        draw_render(outputBuffer, dim_x, dim_y);
+        if (draw_render(outputBuffer, dim_x, dim_y))
+        {
+            outputBufferThreeStale = 1;
+        }
     }
     if (print_screen)
     {
-        n_byte * threebytes = shared_convert_4_to_3(outputBuffer, (dim_x * dim_y));
-        write_png_file("/Users/barbalet/mushroom_output.png", (int)dim_x, (int)dim_y, threebytes);
-        memory_free((void**)&threebytes);
+        if ((outputBufferThree == 0L) || ((dim_x * dim_y * 3) > outputBufferThreeMax))
+        {
+            if (outputBufferThree)
+            {
+                memory_free((void**)&outputBufferThree);
+            }
+            outputBufferThreeMax = 0;
+            outputBufferThree = memory_new(dim_x * dim_y * 3);
+            if (outputBufferThree)
+            {
+                outputBufferThreeMax = dim_x * dim_y * 3;
+            }
+            outputBufferThreeStale = 1;
+        }
+        if (outputBufferThree)
+        {
+            // an unchanged frame keeps the last conversion
+            if (outputBufferThreeStale)
+            {
+                shared_convert_4_to_3(outputBuffer, outputBufferThree, (dim_x * dim_y));
+                outputBufferThreeStale = 0;
+            }
+            write_png_file("/Users/barbalet/mushroom_output.png", (int)dim_x, (int)dim_y, outputBufferThree);
+        }
     }
     
     if (save_neighborhood)
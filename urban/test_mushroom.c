@@ -34,10 +34,11 @@
  ****************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "game/mushroom.h"
-#include "game/city.h"
 
 extern n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number);
 
@@ -67,15 +68,1767 @@ void test_init(n_uint random)
     math_random(seed);
     math_random(seed);
     
-    city_init(seed);
+    if (neighborhood_init(seed, TWO_BLOCK_EDGE, TWO_BLOCK_EDGE) != 0)
+    {
+        exit(1);
+    }
     /*ecomony_init(seed);*/
     agent_init();
+    if (population_init(seed, MAX_NUMBER_APES, agent_location(), (TWO_BLOCK_EDGE * NEIGHBORHOOD_UNIT_SPACE) / 2) != 0)
+    {
+        exit(1);
+    }
+}
+
+/* the indexed searches are checked against every recorded plane, as game_objects.c would find them
+   without the grid */
+
+#define TEST_MOVE_MARGIN    (4) /* as MATRIX_MOVE_MARGIN in game_objects.c */
+
+static n_vect2 test_low, test_high;
+
+/* the corners of the recorded planes, the checks pick their locations inside them */
+void test_extent(void)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          loop = 0;
+    
+    test_low = planes[0].start;
+    test_high = planes[0].start;
+    while (loop < (n_int)matrix_draw_block()->count)
+    {
+        n_vect2 * ends[2];
+        n_int     each = 0;
+        ends[0] = &planes[loop].start;
+        ends[1] = &planes[loop].end;
+        while (each < 2)
+        {
+            if (ends[each]->x < test_low.x) test_low.x = ends[each]->x;
+            if (ends[each]->y < test_low.y) test_low.y = ends[each]->y;
+            if (ends[each]->x > test_high.x) test_high.x = ends[each]->x;
+            if (ends[each]->y > test_high.y) test_high.y = ends[each]->y;
+            each++;
+        }
+        loop++;
+    }
+}
+
+void test_location(n_byte2 * local, n_vect2 * location)
+{
+    location->x = test_low.x + (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)(test_high.x - test_low.x + 1));
+    location->y = test_low.y + (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)(test_high.y - test_low.y + 1));
+}
+
+/* windows are seen through */
+n_byte test_sight(n_int index)
+{
+    return matrix_draw_type()->data[index] != MT_WINDOW;
+}
+
+n_double test_length(n_double x, n_double y)
+{
+    n_double squared = (x * x) + (y * y);
+    n_double scale = 1;
+    while (squared >= 281474976710656.0)
+    {
+        squared /= 65536;
+        scale *= 256;
+    }
+    return ((n_double)math_root((n_uint)(squared * 65536)) / 256) * scale;
+}
+
+n_int check_matrix_open(n_byte2 * local)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          blocked = 0;
+    n_int          loop = 0;
+    
+    while (loop < 2000)
+    {
+        n_vect2 origin, end;
+        n_byte  expected = 1;
+        n_int   each = 0;
+        
+        test_location(local, &origin);
+        end.x = origin.x + (math_random(local) & 4095) - 2048;
+        end.y = origin.y + (math_random(local) & 4095) - 2048;
+        
+        while (each < (n_int)matrix_draw_block()->count)
+        {
+            if (test_sight(each) && math_do_intersect(&origin, &end, &planes[each].start, &planes[each].end))
+            {
+                expected = 0;
+                break;
+            }
+            each++;
+        }
+        if (matrix_visually_open(&origin, &end) != expected)
+        {
+            printf("visually open (%ld, %ld) to (%ld, %ld) expecting %d\n", origin.x, origin.y, end.x, end.y, expected);
+            return -1;
+        }
+        blocked += (expected == 0);
+        matrix_draw_identifier_clear();
+        loop++;
+    }
+    printf("visually open %ld of 2000 blocked\n", blocked);
+    return 0;
+}
+
+/* the batch runs on the execute threads, each line of sight has to match matrix_visually_open */
+n_int check_matrix_open_batch(n_byte2 * local)
+{
+    n_vect2 * origins = (n_vect2 *)memory_new(sizeof(n_vect2) * 2000);
+    n_vect2 * ends = (n_vect2 *)memory_new(sizeof(n_vect2) * 2000);
+    n_byte  * results = (n_byte *)memory_new(2000);
+    n_int     blocked = 0;
+    n_int     result = 0;
+    n_int     loop = 0;
+    
+    if ((origins == 0L) || (ends == 0L) || (results == 0L))
+    {
+        printf("visually open batch not allocated\n");
+        result = -1;
+    }
+    while ((loop < 2000) && (result == 0))
+    {
+        test_location(local, &origins[loop]);
+        ends[loop].x = origins[loop].x + (math_random(local) & 4095) - 2048;
+        ends[loop].y = origins[loop].y + (math_random(local) & 4095) - 2048;
+        results[loop] = 2;
+        loop++;
+    }
+    if (result == 0)
+    {
+        matrix_visually_open_batch(origins, ends, 2000, results);
+    }
+    loop = 0;
+    while ((loop < 2000) && (result == 0))
+    {
+        n_byte expected = matrix_visually_open(&origins[loop], &ends[loop]);
+        matrix_draw_identifier_clear();
+        if (results[loop] != expected)
+        {
+            printf("visually open batch (%ld, %ld) to (%ld, %ld) gives %d expecting %d\n",
+                   origins[loop].x, origins[loop].y, ends[loop].x, ends[loop].y, results[loop], expected);
+            result = -1;
+        }
+        blocked += (expected == 0);
+        loop++;
+    }
+    memory_free((void **)&results);
+    memory_free((void **)&ends);
+    memory_free((void **)&origins);
+    if (result == 0)
+    {
+        printf("visually open batch %ld of 2000 blocked\n", blocked);
+    }
+    return result;
+}
+
+/* the ray is walked with math_do_intersect in 1/TEST_RAY_SCALE units, so the distance to a plane
+   doesn't depend on the intersection formula in game_objects.c */
+
+#define TEST_RAY_SCALE      (1024)
+
+typedef struct
+{
+    n_vect2  start;
+    n_double dx, dy;
+    n_int    steps;
+} test_ray;
+
+/* the ray moved to one side by two steps, or not moved when the side is zero */
+void test_ray_set(test_ray * ray, n_vect2 * origin, n_vect2 * direction, n_int max_distance, n_int side)
+{
+    n_double length = (n_double)math_root((n_uint)(((direction->x * direction->x) + (direction->y * direction->y)) * 65536)) / 256;
+    n_double across_x = (-2 * side * (n_double)direction->y) / length;
+    n_double across_y = (2 * side * (n_double)direction->x) / length;
+    ray->start.x = (origin->x * TEST_RAY_SCALE) + (n_int)(across_x + ((across_x < 0) ? -0.5 : 0.5));
+    ray->start.y = (origin->y * TEST_RAY_SCALE) + (n_int)(across_y + ((across_y < 0) ? -0.5 : 0.5));
+    ray->dx = ((n_double)direction->x * (n_double)max_distance * TEST_RAY_SCALE) / length;
+    ray->dy = ((n_double)direction->y * (n_double)max_distance * TEST_RAY_SCALE) / length;
+    ray->steps = max_distance * TEST_RAY_SCALE;
+}
+
+n_byte test_ray_crosses(test_ray * ray, n_int along, matrix_plane * wall)
+{
+    n_vect2  end, wall_start, wall_end;
+    n_double x = (ray->dx * (n_double)along) / (n_double)ray->steps;
+    n_double y = (ray->dy * (n_double)along) / (n_double)ray->steps;
+    end.x = ray->start.x + (n_int)(x + ((x < 0) ? -0.5 : 0.5));
+    end.y = ray->start.y + (n_int)(y + ((y < 0) ? -0.5 : 0.5));
+    wall_start.x = wall->start.x * TEST_RAY_SCALE;
+    wall_start.y = wall->start.y * TEST_RAY_SCALE;
+    wall_end.x = wall->end.x * TEST_RAY_SCALE;
+    wall_end.y = wall->end.y * TEST_RAY_SCALE;
+    return math_do_intersect(&ray->start, &end, &wall_start, &wall_end);
+}
+
+/* the distance along the ray to the plane found by bisection, or -1 if the ray misses it */
+n_double test_ray_distance(test_ray * ray, matrix_plane * wall)
+{
+    n_int low = 0;
+    n_int high = ray->steps;
+    
+    if (test_ray_crosses(ray, high, wall) == 0)
+    {
+        return -1;
+    }
+    if (test_ray_crosses(ray, 0, wall))
+    {
+        return 0;
+    }
+    /* the ray to low misses and the ray to high crosses */
+    while ((high - low) > 1)
+    {
+        n_int middle = (low + high) / 2;
+        if (test_ray_crosses(ray, middle, wall))
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle;
+        }
+    }
+    return (n_double)high / TEST_RAY_SCALE;
+}
+
+/* the ray either side decides whether the ray grazes the plane, when they differ it can go either way */
+n_byte test_ray_grazes(test_ray * sides, matrix_plane * wall)
+{
+    n_byte left = test_ray_crosses(&sides[0], sides[0].steps, wall);
+    n_byte middle = test_ray_crosses(&sides[1], sides[1].steps, wall);
+    n_byte right = test_ray_crosses(&sides[2], sides[2].steps, wall);
+    return (left != middle) || (middle != right);
+}
+
+n_int check_matrix_raycast(n_byte2 * local)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          hits = 0, grazed = 0;
+    n_int          loop = 0;
+    
+    while (loop < 2000)
+    {
+        n_vect2    origin, direction, low, high;
+        matrix_hit hit;
+        test_ray   sides[3];
+        n_double   best = -1;
+        n_int      max_distance = 1 + (math_random(local) & 4095);
+        n_int      each = 0;
+        n_byte     result;
+        
+        test_location(local, &origin);
+        direction.x = (math_random(local) & 255) - 128;
+        direction.y = (math_random(local) & 255) - 128;
+        if ((direction.x == 0) && (direction.y == 0))
+        {
+            direction.x = 1;
+        }
+        while (each < 3)
+        {
+            test_ray_set(&sides[each], &origin, &direction, max_distance, each - 1);
+            each++;
+        }
+        
+        /* the nearest plane the ray clearly crosses, planes away from the box around the ray miss it */
+        low.x = origin.x + ((sides[1].dx < 0) ? (n_int)(sides[1].dx / TEST_RAY_SCALE) : 0) - 2;
+        low.y = origin.y + ((sides[1].dy < 0) ? (n_int)(sides[1].dy / TEST_RAY_SCALE) : 0) - 2;
+        high.x = origin.x + ((sides[1].dx > 0) ? (n_int)(sides[1].dx / TEST_RAY_SCALE) : 0) + 2;
+        high.y = origin.y + ((sides[1].dy > 0) ? (n_int)(sides[1].dy / TEST_RAY_SCALE) : 0) + 2;
+        each = 0;
+        while (each < (n_int)matrix_draw_block()->count)
+        {
+            matrix_plane * wall = &planes[each];
+            if (((wall->start.x < low.x) && (wall->end.x < low.x)) || ((wall->start.x > high.x) && (wall->end.x > high.x)) ||
+                ((wall->start.y < low.y) && (wall->end.y < low.y)) || ((wall->start.y > high.y) && (wall->end.y > high.y)))
+            {
+                each++;
+                continue;
+            }
+            if (test_sight(each) && (test_ray_grazes(sides, wall) == 0))
+            {
+                n_double distance = test_ray_distance(&sides[1], wall);
+                if ((distance >= 0) && ((best < 0) || (distance < best)))
+                {
+                    best = distance;
+                }
+            }
+            each++;
+        }
+        result = matrix_raycast(&origin, &direction, max_distance, &hit);
+        
+        /* a plane met at the very end of the ray can fall either side of it */
+        if (result == 0)
+        {
+            if ((best >= 0) && (best < (n_double)(max_distance - 1)))
+            {
+                printf("raycast from (%ld, %ld) missed a plane at %f\n", origin.x, origin.y, best);
+                return -1;
+            }
+        }
+        else
+        {
+            matrix_plane * wall = &planes[hit.identifier];
+            if ((hit.type != matrix_draw_type()->data[hit.identifier]) || (test_sight(hit.identifier) == 0))
+            {
+                printf("raycast from (%ld, %ld) hit %ld of type %d\n", origin.x, origin.y, hit.identifier, hit.type);
+                return -1;
+            }
+            /* nothing clearly crossed is nearer than the hit */
+            if ((best >= 0) && ((n_double)hit.distance > (best + 1)))
+            {
+                printf("raycast from (%ld, %ld) hit %ld at %ld beyond a plane at %f\n", origin.x, origin.y, hit.identifier, hit.distance, best);
+                return -1;
+            }
+            if (test_ray_grazes(sides, wall))
+            {
+                grazed++;
+            }
+            else
+            {
+                n_double distance = test_ray_distance(&sides[1], wall);
+                if ((distance < 0) && (hit.distance < (max_distance - 1)))
+                {
+                    printf("raycast from (%ld, %ld) hit %ld at %ld which the ray misses\n", origin.x, origin.y, hit.identifier, hit.distance);
+                    return -1;
+                }
+                if ((distance >= 0) && (((distance - (n_double)hit.distance) > 1) || (((n_double)hit.distance - distance) > 1)))
+                {
+                    printf("raycast from (%ld, %ld) hit %ld at %ld expecting %f\n", origin.x, origin.y, hit.identifier, hit.distance, distance);
+                    return -1;
+                }
+            }
+            hits++;
+        }
+        loop++;
+    }
+    printf("raycast %ld of 2000 hit, %ld grazing\n", hits, grazed);
+    return 0;
+}
+
+/* the side of the line through a and b the point is on, 0 on the line */
+n_int test_side(n_vect2 * a, n_vect2 * b, n_vect2 * point)
+{
+    n_int cross = ((b->x - a->x) * (point->y - a->y)) - ((b->y - a->y) * (point->x - a->x));
+    return (cross > 0) - (cross < 0);
+}
+
+/* whether the segments cross at a point inside both, touching doesn't count */
+n_byte test_properly_crosses(n_vect2 * p, n_vect2 * q, n_vect2 * a, n_vect2 * b)
+{
+    return ((test_side(a, b, p) * test_side(a, b, q)) < 0) && ((test_side(p, q, a) * test_side(p, q, b)) < 0);
+}
+
+n_double test_point_distance(n_vect2 * point, n_vect2 * a, n_vect2 * b)
+{
+    n_double wx = (n_double)(b->x - a->x);
+    n_double wy = (n_double)(b->y - a->y);
+    n_double px = (n_double)(point->x - a->x);
+    n_double py = (n_double)(point->y - a->y);
+    n_double length = (wx * wx) + (wy * wy);
+    n_double along = (length > 0) ? (((px * wx) + (py * wy)) / length) : 0;
+    if (along < 0) along = 0;
+    if (along > 1) along = 1;
+    return test_length(px - (along * wx), py - (along * wy));
+}
+
+n_double test_segment_distance(n_vect2 * p, n_vect2 * q, n_vect2 * a, n_vect2 * b)
+{
+    n_double distance[4];
+    n_double best;
+    n_int    loop = 1;
+    if (math_do_intersect(p, q, a, b))
+    {
+        return 0;
+    }
+    distance[0] = test_point_distance(p, a, b);
+    distance[1] = test_point_distance(q, a, b);
+    distance[2] = test_point_distance(a, p, q);
+    distance[3] = test_point_distance(b, p, q);
+    best = distance[0];
+    while (loop < 4)
+    {
+        if (distance[loop] < best) best = distance[loop];
+        loop++;
+    }
+    return best;
+}
+
+/* the first plane that blocks movement the path properly crosses, or -1 */
+n_int test_move_crosses(n_vect2 * start, n_vect2 * end)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          loop = 0;
+    while (loop < (n_int)matrix_draw_block()->count)
+    {
+        if (test_properly_crosses(start, end, &planes[loop].start, &planes[loop].end))
+        {
+            return loop;
+        }
+        loop++;
+    }
+    return -1;
+}
+
+/* whether every plane is further than the distance from the path, leaving out one plane */
+n_byte test_move_clear(n_vect2 * start, n_vect2 * end, n_double distance, n_int leave_out)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          reach = (n_int)distance + 1;
+    n_int          low_x = ((start->x < end->x) ? start->x : end->x) - reach;
+    n_int          low_y = ((start->y < end->y) ? start->y : end->y) - reach;
+    n_int          high_x = ((start->x < end->x) ? end->x : start->x) + reach;
+    n_int          high_y = ((start->y < end->y) ? end->y : start->y) + reach;
+    n_int          loop = 0;
+    while (loop < (n_int)matrix_draw_block()->count)
+    {
+        matrix_plane * plane = &planes[loop];
+        /* planes outside the box around the path are further away */
+        if ((loop != leave_out) &&
+            !(((plane->start.x < low_x) && (plane->end.x < low_x)) || ((plane->start.x > high_x) && (plane->end.x > high_x)) ||
+              ((plane->start.y < low_y) && (plane->end.y < low_y)) || ((plane->start.y > high_y) && (plane->end.y > high_y))) &&
+            (test_segment_distance(start, end, &plane->start, &plane->end) <= distance))
+        {
+            return 0;
+        }
+        loop++;
+    }
+    return 1;
+}
+
+void test_vect2_round(n_vect2 * value, n_vect2 * base, n_double x, n_double y)
+{
+    value->x = base->x + (n_int)(x + ((x < 0) ? -0.5 : 0.5));
+    value->y = base->y + (n_int)(y + ((y < 0) ? -0.5 : 0.5));
+}
+
+/* walkers keep stepping the same way into walls, fences and windows and are never on the other side
+   of one after a step. The steps are short so the slides along a wall stay close to the step. */
+n_int check_matrix_move_through(n_byte2 * local)
+{
+    n_int stopped = 0;
+    n_int loop = 0;
+    
+    while (loop < 500)
+    {
+        n_vect2 location, step;
+        n_int   each = 0;
+        
+        test_location(local, &location);
+        while (each < 40)
+        {
+            n_vect2 start;
+            n_int   crossed;
+            if ((each & 7) == 0)
+            {
+                step.x = (math_random(local) % 9) - 4;
+                step.y = (math_random(local) % 9) - 4;
+            }
+            vect2_copy(&start, &location);
+            matrix_move(&location, &step);
+            crossed = test_move_crosses(&start, &location);
+            if (crossed != -1)
+            {
+                printf("move from (%ld, %ld) to (%ld, %ld) crosses %ld\n", start.x, start.y, location.x, location.y, crossed);
+                return -1;
+            }
+            stopped += ((location.x != (start.x + step.x)) || (location.y != (start.y + step.y)));
+            each++;
+        }
+        loop++;
+    }
+    printf("move %ld of 20000 steps stopped\n", stopped);
+    return 0;
+}
+
+/* a step straight through the middle of a door, with nothing else near it, is taken in full */
+n_int check_matrix_move_doors(void)
+{
+    memory_list  * types;
+    memory_list  * openings = matrix_opening(&types);
+    matrix_plane * doors = (matrix_plane *)openings->data;
+    n_int          walked = 0;
+    n_int          loop = 0;
+    
+    while ((loop < (n_int)openings->count) && (walked < 200))
+    {
+        matrix_plane * door = &doors[loop];
+        n_double       wx = (n_double)(door->end.x - door->start.x);
+        n_double       wy = (n_double)(door->end.y - door->start.y);
+        n_double       length = test_length(wx, wy);
+        n_vect2        middle, start, end, step, location;
+        
+        if ((types->data[loop] != MT_DOOR) || (length == 0))
+        {
+            loop++;
+            continue;
+        }
+        middle.x = (door->start.x + door->end.x) / 2;
+        middle.y = (door->start.y + door->end.y) / 2;
+        test_vect2_round(&start, &middle, (wy * 24) / length, (-wx * 24) / length);
+        test_vect2_round(&end, &middle, (-wy * 24) / length, (wx * 24) / length);
+        if (test_move_clear(&start, &end, TEST_MOVE_MARGIN + 1, -1))
+        {
+            n_int direction = 0;
+            while (direction < 2)
+            {
+                n_vect2 * from = direction ? &end : &start;
+                n_vect2 * to = direction ? &start : &end;
+                vect2_copy(&location, from);
+                vect2_subtract(&step, to, from);
+                matrix_move(&location, &step);
+                if ((location.x != to->x) || (location.y != to->y))
+                {
+                    printf("move through door %ld from (%ld, %ld) stopped at (%ld, %ld)\n", loop, from->x, from->y, location.x, location.y);
+                    return -1;
+                }
+                direction++;
+            }
+            walked++;
+        }
+        loop++;
+    }
+    if (walked == 0)
+    {
+        printf("move found no clear door to walk through\n");
+        return -1;
+    }
+    printf("move through %ld doors\n", walked);
+    return 0;
+}
+
+/* a step into the middle of a wall at an angle, with nothing else near it, stops at the wall and
+   slides along it. Going straight the step would stop before it was 12 along the wall. */
+n_int check_matrix_move_slides(void)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          slid = 0;
+    n_int          loop = 0;
+    
+    while ((loop < (n_int)matrix_draw_block()->count) && (slid < 200))
+    {
+        matrix_plane * wall = &planes[loop];
+        n_double       wx = (n_double)(wall->end.x - wall->start.x);
+        n_double       wy = (n_double)(wall->end.y - wall->start.y);
+        n_double       length = test_length(wx, wy);
+        n_double       side = (loop & 1) ? 1 : -1;
+        n_double       ux, uy, nx, ny;
+        n_vect2        middle, start, step, location;
+        
+        if ((matrix_draw_type()->data[loop] != MT_WALL) || (length < 120))
+        {
+            loop++;
+            continue;
+        }
+        ux = wx / length;
+        uy = wy / length;
+        nx = -uy * side;
+        ny = ux * side;
+        middle.x = (wall->start.x + wall->end.x) / 2;
+        middle.y = (wall->start.y + wall->end.y) / 2;
+        test_vect2_round(&start, &middle, nx * 12, ny * 12);
+        step.x = 0;
+        step.y = 0;
+        test_vect2_round(&step, &step, (ux - nx) * 40, (uy - ny) * 40);
+        if (test_move_clear(&middle, &middle, 60, loop))
+        {
+            n_double along, away;
+            vect2_copy(&location, &start);
+            matrix_move(&location, &step);
+            along = ((n_double)(location.x - start.x) * ux) + ((n_double)(location.y - start.y) * uy);
+            away = ((n_double)(location.x - middle.x) * nx) + ((n_double)(location.y - middle.y) * ny);
+            if (((location.x == (start.x + step.x)) && (location.y == (start.y + step.y))) || (along < 24) || (away <= 0) ||
+                (test_move_crosses(&start, &location) != -1))
+            {
+                printf("move into wall %ld from (%ld, %ld) by (%ld, %ld) ends at (%ld, %ld)\n", loop, start.x, start.y, step.x, step.y, location.x, location.y);
+                return -1;
+            }
+            slid++;
+        }
+        loop++;
+    }
+    if (slid == 0)
+    {
+        printf("move found no clear wall to slide along\n");
+        return -1;
+    }
+    printf("move along %ld walls\n", slid);
+    return 0;
+}
+
+n_int check_matrix_move(n_byte2 * local)
+{
+    if (check_matrix_move_through(local) != 0)
+    {
+        return -1;
+    }
+    if (check_matrix_move_doors() != 0)
+    {
+        return -1;
+    }
+    return check_matrix_move_slides();
+}
+
+n_int check_matrix(void)
+{
+    n_byte2 local[2] = {0x3a7e, 0x91c4};
+    
+    test_extent();
+    
+    /* first, so the execute threads are the first to test the wall segments */
+    if (check_matrix_open_batch(local) != 0)
+    {
+        return -1;
+    }
+    if (check_matrix_open(local) != 0)
+    {
+        return -1;
+    }
+    if (check_matrix_raycast(local) != 0)
+    {
+        return -1;
+    }
+    if (check_matrix_move(local) != 0)
+    {
+        return -1;
+    }
+    printf("Matrix passed fine!\n");
+    return 0;
+}
+
+/* whether the segment crosses the wall, 0 when it misses, touches or lies along the wall, 2 when it
+   passes within the margin of an end of the wall or ends within the margin of the wall and 1 otherwise */
+n_int test_crossing(n_double px, n_double py, n_double qx, n_double qy, matrix_plane * wall, n_double margin)
+{
+    n_double wx = (n_double)(wall->end.x - wall->start.x);
+    n_double wy = (n_double)(wall->end.y - wall->start.y);
+    n_double sx = qx - px;
+    n_double sy = qy - py;
+    n_double side_start = (sx * (wall->start.y - py)) - (sy * (wall->start.x - px));
+    n_double side_end = (sx * (wall->end.y - py)) - (sy * (wall->end.x - px));
+    n_double side_p = (wx * (py - wall->start.y)) - (wy * (px - wall->start.x));
+    n_double side_q = (wx * (qy - wall->start.y)) - (wy * (qx - wall->start.x));
+    
+    if ((((side_start < 0) && (side_end > 0)) || ((side_start > 0) && (side_end < 0))) &&
+        (((side_p < 0) && (side_q > 0)) || ((side_p > 0) && (side_q < 0))))
+    {
+        n_double reach = margin * test_length(sx, sy);
+        /* the sides are the distances of the wall ends from the line of the segment times its length */
+        if ((side_start < reach) && (side_start > -reach))
+        {
+            return 2;
+        }
+        if ((side_end < reach) && (side_end > -reach))
+        {
+            return 2;
+        }
+        reach = margin * test_length(wx, wy);
+        if ((side_q < reach) && (side_q > -reach))
+        {
+            return 2;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* the walls and fences that reach the square around the origin that the agent can see */
+void test_seen_planes(n_vect2 * origin, int_list * seen)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_int          loop = 0;
+    
+    seen->count = 0;
+    while (loop < (n_int)matrix_draw_block()->count)
+    {
+        matrix_plane * wall = &planes[loop];
+        if (test_sight(loop) &&
+            (((wall->start.x < wall->end.x) ? wall->end.x : wall->start.x) >= (origin->x - VISIBILITY_RADIUS)) &&
+            (((wall->start.x < wall->end.x) ? wall->start.x : wall->end.x) <= (origin->x + VISIBILITY_RADIUS)) &&
+            (((wall->start.y < wall->end.y) ? wall->end.y : wall->start.y) >= (origin->y - VISIBILITY_RADIUS)) &&
+            (((wall->start.y < wall->end.y) ? wall->start.y : wall->end.y) <= (origin->y + VISIBILITY_RADIUS)))
+        {
+            int_list_copy(seen, loop);
+        }
+        loop++;
+    }
+}
+
+/* 0 not crossed, 1 crossed and 2 when a wall is only touched or passed within the couple of units
+   the polygon corners round to, so the answer is left open */
+n_int test_seen_crossed(int_list * seen, n_vect2 * origin, n_double qx, n_double qy)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_vect2        end;
+    n_int          touched = 0;
+    n_int          loop = 0;
+    
+    end.x = (n_int)qx;
+    end.y = (n_int)qy;
+    while (loop < (n_int)seen->count)
+    {
+        matrix_plane * wall = &planes[((n_int *)seen->data)[loop]];
+        n_int          crossing = test_crossing((n_double)origin->x, (n_double)origin->y, qx, qy, wall, 2);
+        if (crossing == 1)
+        {
+            return 1;
+        }
+        if (crossing == 2)
+        {
+            touched = 1;
+        }
+        else if (((n_double)end.x == qx) && ((n_double)end.y == qy) && math_do_intersect(origin, &end, &wall->start, &wall->end))
+        {
+            touched = 1;
+        }
+        loop++;
+    }
+    return touched ? 2 : 0;
+}
+
+n_int check_visibility_point(int_list * seen, n_vect2 * origin, n_byte2 * local)
+{
+    n_int loop = 0;
+    
+    while (loop < 500)
+    {
+        n_vect2 point;
+        n_int   crossed;
+        
+        point.x = origin->x + ((n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (VISIBILITY_RADIUS * 2)) - VISIBILITY_RADIUS);
+        point.y = origin->y + ((n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (VISIBILITY_RADIUS * 2)) - VISIBILITY_RADIUS);
+        crossed = test_seen_crossed(seen, origin, (n_double)point.x, (n_double)point.y);
+        
+        if (((point.x - origin->x) * (point.x - origin->x)) + ((point.y - origin->y) * (point.y - origin->y)) >
+            (VISIBILITY_RADIUS * VISIBILITY_RADIUS))
+        {
+            crossed = 1;
+        }
+        if ((crossed != 2) && (visibility_point(&point) != (crossed == 0)))
+        {
+            printf("visibility from (%ld, %ld) of (%ld, %ld) expecting %d\n", origin->x, origin->y, point.x, point.y, (crossed == 0));
+            return -1;
+        }
+        loop++;
+    }
+    return 0;
+}
+
+/* the corners of the polygon are in front of the walls */
+n_int check_visibility_corners(int_list * seen, n_vect2 * origin, n_byte2 * local, n_vect2 * polygon, n_int count)
+{
+    n_int loop = 0;
+    
+    while (loop < 1000)
+    {
+        n_int     corner = (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)count);
+        n_vect2 * point = &polygon[corner];
+        
+        if ((test_length((n_double)(point->x - origin->x), (n_double)(point->y - origin->y)) > (VISIBILITY_RADIUS + 2)) ||
+            (test_seen_crossed(seen, origin, (n_double)point->x, (n_double)point->y) == 1))
+        {
+            printf("visibility polygon from (%ld, %ld) sees through a wall at %ld\n", origin->x, origin->y, corner);
+            return -1;
+        }
+        loop++;
+    }
+    return 0;
+}
+
+/* the edges inside the view lie on a wall, edges out at the edge of the view, edges too short to be
+   clear of the ends of their wall and edges nearly in line with the agent are left out */
+n_int check_visibility_edges(int_list * seen, n_vect2 * origin, n_vect2 * polygon, n_int count, n_int * edges)
+{
+    n_int loop = 0;
+    n_int checked = 0;
+    
+    while ((loop < count) && (checked < 200))
+    {
+        n_vect2 * first = &polygon[loop];
+        n_vect2 * second = &polygon[loop + 1];
+        n_double  edge_x = (n_double)(second->x - first->x);
+        n_double  edge_y = (n_double)(second->y - first->y);
+        n_double  middle_x = ((n_double)(first->x + second->x) / 2) - origin->x;
+        n_double  middle_y = ((n_double)(first->y + second->y) / 2) - origin->y;
+        n_double  edge = test_length(edge_x, edge_y);
+        n_double  middle = test_length(middle_x, middle_y);
+        n_double  across = (edge_x * middle_y) - (edge_y * middle_x);
+        
+        if (across < 0)
+        {
+            across = -across;
+        }
+        if ((test_length((n_double)(first->x - origin->x), (n_double)(first->y - origin->y)) < (VISIBILITY_RADIUS - 2)) &&
+            (test_length((n_double)(second->x - origin->x), (n_double)(second->y - origin->y)) < (VISIBILITY_RADIUS - 2)) &&
+            (edge > 20) && (middle > 2) && (across > ((edge * middle * 3) / 10)))
+        {
+            /* the rounded corners turn the edge by up to a tenth or so, far enough past the edge to be
+               clear of the rounding at the angles kept */
+            if (test_seen_crossed(seen, origin, origin->x + ((middle_x * (middle + 40)) / middle),
+                                  origin->y + ((middle_y * (middle + 40)) / middle)) != 1)
+            {
+                printf("visibility polygon from (%ld, %ld) edge %ld is short of a wall\n", origin->x, origin->y, loop);
+                return -1;
+            }
+            checked++;
+        }
+        loop += 2;
+    }
+    *edges += checked;
+    return 0;
+}
+
+n_int check_visibility_polygon(int_list * seen, n_vect2 * origin, n_byte2 * local, n_int * edges)
+{
+    n_int     count;
+    n_vect2 * polygon = visibility_polygon(&count);
+    
+    if ((polygon == 0L) || (count < 2) || (count & 1))
+    {
+        printf("visibility polygon from (%ld, %ld) has %ld points\n", origin->x, origin->y, count);
+        return -1;
+    }
+    if (check_visibility_corners(seen, origin, local, polygon, count) != 0)
+    {
+        return -1;
+    }
+    return check_visibility_edges(seen, origin, polygon, count, edges);
+}
+
+n_int check_visibility(void)
+{
+    n_byte2    local[2] = {0x5d21, 0x0e6b};
+    int_list * seen = int_list_new(1024);
+    n_vect2    agent;
+    n_int      edges = 0;
+    n_int      loop = 0;
+    n_int      result = 0;
+    
+    vect2_copy(&agent, agent_location());
+    while ((loop < 10) && (result == 0))
+    {
+        n_vect2 origin;
+        test_location(local, &origin);
+        vect2_copy(agent_location(), &origin);
+        visibility_invalidate();
+        test_seen_planes(&origin, seen);
+        
+        result = check_visibility_point(seen, &origin, local);
+        if (result == 0)
+        {
+            result = check_visibility_polygon(seen, &origin, local, &edges);
+        }
+        loop++;
+    }
+    vect2_copy(agent_location(), &agent);
+    visibility_invalidate();
+    int_list_free(&seen);
+    
+    if (result == 0)
+    {
+        printf("visibility %ld polygon edges on walls\n", edges);
+        printf("Visibility passed fine!\n");
+    }
+    return result;
+}
+
+/* the road routes are checked against a plain search that takes the nearest unfinished node from
+   every node in turn */
+
+#define TEST_ROAD_UNREACHED (0x7fffffff)
+
+void test_road_costs(n_int start, n_int * cost, n_byte * done)
+{
+    n_int nodes = road_graph_nodes();
+    n_int loop = 0;
+    
+    while (loop < nodes)
+    {
+        cost[loop] = TEST_ROAD_UNREACHED;
+        done[loop] = 0;
+        loop++;
+    }
+    cost[start] = 0;
+    while (1)
+    {
+        n_int nearest = -1;
+        n_int edge = 0;
+        loop = 0;
+        while (loop < nodes)
+        {
+            if ((done[loop] == 0) && (cost[loop] != TEST_ROAD_UNREACHED) &&
+                ((nearest == -1) || (cost[loop] < cost[nearest])))
+            {
+                nearest = loop;
+            }
+            loop++;
+        }
+        if (nearest == -1)
+        {
+            return;
+        }
+        done[nearest] = 1;
+        while (edge < road_graph_edges(nearest))
+        {
+            n_int edge_cost;
+            n_int to = road_graph_edge(nearest, edge, &edge_cost);
+            if ((cost[nearest] + edge_cost) < cost[to])
+            {
+                cost[to] = cost[nearest] + edge_cost;
+            }
+            edge++;
+        }
+    }
+}
+
+/* the cheapest edge from one node to the other, or -1 when they are not joined */
+n_int test_road_edge(n_int from, n_int to)
+{
+    n_int best = -1;
+    n_int edge = 0;
+    while (edge < road_graph_edges(from))
+    {
+        n_int edge_cost;
+        if ((road_graph_edge(from, edge, &edge_cost) == to) && ((best == -1) || (edge_cost < best)))
+        {
+            best = edge_cost;
+        }
+        edge++;
+    }
+    return best;
+}
+
+/* a planned road is found whenever a route is and is never shorter than it */
+
+n_int check_road_route(road_search * search, int_list * route, n_int start, n_int end, n_int expected, n_byte plan)
+{
+    n_int   cost;
+    n_int   sum = 0;
+    n_int * nodes;
+    n_uint  loop = 1;
+    
+    route->count = 0;
+    cost = plan ? road_plan(search, start, end, route) : road_route(search, start, end, route);
+    if (expected == TEST_ROAD_UNREACHED)
+    {
+        if (cost != -1)
+        {
+            printf("road from %ld to %ld found at %ld without a route\n", start, end, cost);
+            return -1;
+        }
+        return 0;
+    }
+    if (plan ? (cost < expected) : (cost != expected))
+    {
+        printf("road from %ld to %ld at %ld expecting %ld\n", start, end, cost, expected);
+        return -1;
+    }
+    nodes = (n_int *)route->data;
+    if ((route->count == 0) || (nodes[0] != start) || (nodes[route->count - 1] != end))
+    {
+        printf("road from %ld to %ld does not run from the start to the end\n", start, end);
+        return -1;
+    }
+    while (loop < route->count)
+    {
+        n_int edge_cost = test_road_edge(nodes[loop - 1], nodes[loop]);
+        if (edge_cost == -1)
+        {
+            printf("road from %ld to %ld jumps from %ld to %ld\n", start, end, nodes[loop - 1], nodes[loop]);
+            return -1;
+        }
+        sum += edge_cost;
+        loop++;
+    }
+    if (sum != cost)
+    {
+        printf("road from %ld to %ld at %ld has edges adding to %ld\n", start, end, cost, sum);
+        return -1;
+    }
+    return 0;
+}
+
+n_int check_road(void)
+{
+    n_byte2       local[2] = {0x62b9, 0xc3d5};
+    n_int         nodes = road_graph_nodes();
+    n_int       * cost = (n_int *)memory_new(sizeof(n_int) * (n_uint)(nodes + 1));
+    n_byte      * done = (n_byte *)memory_new((n_uint)(nodes + 1));
+    road_search * search = road_search_new();
+    int_list    * route = int_list_new(256);
+    n_int         found = 0, routes = 0;
+    n_int         loop = 0;
+    n_int         result = 0;
+    
+    if ((nodes == 0) || (cost == 0L) || (done == 0L) || (search == 0L) || (route == 0L))
+    {
+        printf("road not set up to check\n");
+        result = -1;
+    }
+    while ((loop < 4) && (result == 0))
+    {
+        n_int start = (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)nodes);
+        n_int each = 0;
+        test_road_costs(start, cost, done);
+        while ((each < 100) && (result == 0))
+        {
+            /* the first route goes nowhere */
+            n_int end = (each == 0) ? start : (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)nodes);
+            result = check_road_route(search, route, start, end, cost[end], 0);
+            if (result == 0)
+            {
+                result = check_road_route(search, route, start, end, cost[end], 1);
+            }
+            found += (cost[end] != TEST_ROAD_UNREACHED);
+            routes++;
+            each++;
+        }
+        loop++;
+    }
+    int_list_free(&route);
+    road_search_free(&search);
+    memory_free((void **)&done);
+    memory_free((void **)&cost);
+    
+    if (result == 0)
+    {
+        printf("road %ld of %ld routes found in %ld nodes\n", found, routes, nodes);
+        printf("Road passed fine!\n");
+    }
+    return result;
+}
+
+/* the house routes are checked against a search of the doors found again from the rooms, each walk
+   is room center to door middle to room center and outside is only ever the end of a walk */
+
+typedef struct
+{
+    n_vect2 middle;
+    n_int   room[2];
+    n_int   cost;
+} test_door;
+
+n_byte test_room_contains(simulated_room * room, n_vect2 * point)
+{
+    n_int positive = 0, negative = 0;
+    n_int loop = 0;
+    while (loop < 4)
+    {
+        n_vect2 * start = &room->points[loop];
+        n_vect2 * end = &room->points[(loop + 1) & 3];
+        n_int cross = ((end->x - start->x) * (point->y - start->y)) - ((end->y - start->y) * (point->x - start->x));
+        positive |= (cross > 0);
+        negative |= (cross < 0);
+        loop++;
+    }
+    return !(positive && negative);
+}
+
+n_int test_walk(n_vect2 * start, n_vect2 * end)
+{
+    n_int dx = end->x - start->x;
+    n_int dy = end->y - start->y;
+    return (n_int)math_root((n_uint)((dx * dx) + (dy * dy)));
+}
+
+n_int test_house_doors(simulated_building * building, test_door * doors)
+{
+    n_vect2 center[MAX_ROOMS];
+    n_int   count = 0;
+    n_int   room = 0;
+    
+    while (room < building->roomcount)
+    {
+        vect2_center(&center[room], &building->room[room].points[0], &building->room[room].points[2]);
+        room++;
+    }
+    room = 0;
+    while (room < building->roomcount)
+    {
+        n_int loop = 0;
+        while (loop < 4)
+        {
+            n_vect2 * door = &building->room[room].points[16 + (loop * 4)];
+            if (house_door_present(door))
+            {
+                n_vect2 inside, outside;
+                n_int   other = 0;
+                vect2_center(&inside, &door[0], &door[1]);
+                vect2_center(&outside, &door[2], &door[3]);
+                vect2_center(&doors[count].middle, &inside, &outside);
+                while ((other < building->roomcount) &&
+                       ((other == room) || (test_room_contains(&building->room[other], &outside) == 0)))
+                {
+                    other++;
+                }
+                if (other == building->roomcount)
+                {
+                    other = HOUSE_OUTSIDE;
+                }
+                doors[count].room[0] = room;
+                doors[count].room[1] = other;
+                doors[count].cost = test_walk(&center[room], &doors[count].middle);
+                if (other != HOUSE_OUTSIDE)
+                {
+                    doors[count].cost += test_walk(&doors[count].middle, &center[other]);
+                }
+                count++;
+            }
+            loop++;
+        }
+        room++;
+    }
+    return count;
+}
+
+/* every door is tried until no walk gets cheaper */
+void test_house_costs(test_door * doors, n_int count, n_int from, n_int * cost)
+{
+    n_byte changed = 1;
+    n_int  loop = 0;
+    
+    while (loop <= MAX_ROOMS)
+    {
+        cost[loop] = (loop == from) ? 0 : HOUSE_UNREACHED;
+        loop++;
+    }
+    while (changed)
+    {
+        changed = 0;
+        loop = 0;
+        while (loop < (count * 2))
+        {
+            n_int side = doors[loop / 2].room[loop & 1];
+            n_int other = doors[loop / 2].room[(loop & 1) ^ 1];
+            if ((cost[side] != HOUSE_UNREACHED) && ((side != HOUSE_OUTSIDE) || (side == from)) &&
+                ((cost[side] + doors[loop / 2].cost) < cost[other]))
+            {
+                cost[other] = cost[side] + doors[loop / 2].cost;
+                changed = 1;
+            }
+            loop++;
+        }
+    }
+}
+
+n_int check_house_route(simulated_building * building, test_door * doors, n_int count, n_int from, n_int to, n_int expected)
+{
+    n_vect2 route[HOUSE_DOORS_MAX];
+    n_vect2 leaving[HOUSE_DOORS_MAX];
+    n_int   length = house_route(building, from, to, route, HOUSE_DOORS_MAX);
+    n_int   room = from;
+    n_int   sum = 0;
+    n_int   loop = 0;
+    
+    if (to == HOUSE_OUTSIDE)
+    {
+        n_int leaving_length = house_exit(building, from, leaving, HOUSE_DOORS_MAX);
+        n_int each = 0;
+        if (leaving_length != length)
+        {
+            printf("house exit from %ld through %ld doors expecting %ld\n", from, leaving_length, length);
+            return -1;
+        }
+        while (each < length)
+        {
+            if ((leaving[each].x != route[each].x) || (leaving[each].y != route[each].y))
+            {
+                printf("house exit from %ld leaves by another door\n", from);
+                return -1;
+            }
+            each++;
+        }
+    }
+    if (house_route_cost(building, from, to) != expected)
+    {
+        printf("house from %ld to %ld at %ld expecting %ld\n", from, to, house_route_cost(building, from, to), expected);
+        return -1;
+    }
+    if (expected == HOUSE_UNREACHED)
+    {
+        if (length != -1)
+        {
+            printf("house from %ld to %ld found without a walk\n", from, to);
+            return -1;
+        }
+        return 0;
+    }
+    if ((length < 0) || (length > HOUSE_DOORS_MAX))
+    {
+        printf("house from %ld to %ld through %ld doors\n", from, to, length);
+        return -1;
+    }
+    while (loop < length)
+    {
+        n_int door = 0;
+        /* the door out of this room at the point */
+        while ((door < count) &&
+               ((doors[door].middle.x != route[loop].x) || (doors[door].middle.y != route[loop].y) ||
+                ((doors[door].room[0] != room) && (doors[door].room[1] != room))))
+        {
+            door++;
+        }
+        if ((door == count) || ((room == HOUSE_OUTSIDE) && (loop != 0)))
+        {
+            printf("house from %ld to %ld has no door from room %ld\n", from, to, room);
+            return -1;
+        }
+        room = (doors[door].room[0] == room) ? doors[door].room[1] : doors[door].room[0];
+        sum += doors[door].cost;
+        loop++;
+    }
+    if ((room != to) || (sum != expected))
+    {
+        printf("house from %ld to %ld ends in %ld at %ld\n", from, to, room, sum);
+        return -1;
+    }
+    return 0;
+}
+
+n_int check_house(void)
+{
+    n_int                twoblock_count;
+    simulated_twoblock * twoblocks = neighborhoood_twoblock(&twoblock_count);
+    test_door            doors[HOUSE_DOORS_MAX];
+    n_int                walks = 0, unreached = 0;
+    n_int                loop = 0;
+    
+    while (loop < (twoblock_count * 16))
+    {
+        simulated_building * building = &twoblocks[loop / 16].house[loop & 15];
+        n_int                count = test_house_doors(building, doors);
+        n_int                from = 0;
+        
+        if (count != building->graph.count)
+        {
+            printf("house %ld with %ld doors expecting %ld\n", loop, (n_int)building->graph.count, count);
+            return -1;
+        }
+        while (from <= MAX_ROOMS)
+        {
+            n_int cost[MAX_ROOMS + 1];
+            n_int to = 0;
+            if ((from >= building->roomcount) && (from != HOUSE_OUTSIDE))
+            {
+                from++;
+                continue;
+            }
+            test_house_costs(doors, count, from, cost);
+            while (to <= MAX_ROOMS)
+            {
+                if ((to < building->roomcount) || (to == HOUSE_OUTSIDE))
+                {
+                    if (check_house_route(building, doors, count, from, to, cost[to]) != 0)
+                    {
+                        printf("house %ld\n", loop);
+                        return -1;
+                    }
+                    unreached += (cost[to] == HOUSE_UNREACHED);
+                    walks++;
+                }
+                to++;
+            }
+            from++;
+        }
+        loop++;
+    }
+    printf("house %ld of %ld walks unreached\n", unreached, walks);
+    printf("House passed fine!\n");
+    return 0;
+}
+
+/* the population is checked against every agent's location, with one thread and with many, and
+   against every plane that blocks movement */
+
+#define TEST_POPULATION_MANY (8192) /* several chunks of agents, so the cycle is spread over the threads */
+
+n_int check_population_nearby(n_byte2 * local)
+{
+    int_list * found = int_list_new(256);
+    n_int      total = 0;
+    n_int      loop = 0;
+    n_int      result = 0;
+    
+    if (found == 0L)
+    {
+        printf("population nearby not allocated\n");
+        return -1;
+    }
+    while ((loop < 500) && (result == 0))
+    {
+        n_vect2 center;
+        n_int   radius = math_random(local) & 2047;
+        n_int   agent = 0;
+        n_int   expected = 0;
+        
+        /* half the centers are on an agent, a quarter have an agent on the edge of the radius */
+        if (loop & 1)
+        {
+            population_location(math_random(local) % population_number(), &center);
+            if (loop & 2)
+            {
+                center.x -= radius;
+            }
+        }
+        else
+        {
+            test_location(local, &center);
+        }
+        found->count = 0;
+        population_nearby(&center, radius, found);
+        
+        while ((agent < population_number()) && (result == 0))
+        {
+            n_vect2 location;
+            n_int   dx, dy, times = 0;
+            n_uint  each = 0;
+            population_location(agent, &location);
+            dx = location.x - center.x;
+            dy = location.y - center.y;
+            while (each < found->count)
+            {
+                times += (((n_int *)found->data)[each] == agent);
+                each++;
+            }
+            if (times != ((((dx * dx) + (dy * dy)) <= (radius * radius)) ? 1 : 0))
+            {
+                printf("population nearby (%ld, %ld) within %ld has agent %ld %ld times\n", center.x, center.y, radius, agent, times);
+                result = -1;
+            }
+            expected += (times != 0);
+            agent++;
+        }
+        if ((result == 0) && ((n_int)found->count != expected))
+        {
+            printf("population nearby (%ld, %ld) within %ld found %ld expecting %ld\n", center.x, center.y, radius, (n_int)found->count, expected);
+            result = -1;
+        }
+        total += expected;
+        loop++;
+    }
+    int_list_free(&found);
+    if (result == 0)
+    {
+        printf("population nearby found %ld agents\n", total);
+    }
+    return result;
+}
+
+/* no agent's step in a cycle crosses a plane that blocks movement */
+n_int check_population_walls(void)
+{
+    matrix_plane * planes = (matrix_plane *)matrix_draw_block()->data;
+    n_vect2      * before = (n_vect2 *)memory_new(sizeof(n_vect2) * (n_uint)population_number());
+    n_int          moved = 0;
+    n_int          cycle = 0;
+    
+    if (before == 0L)
+    {
+        printf("population walls not allocated\n");
+        return -1;
+    }
+    while (cycle < 100)
+    {
+        n_int agent = 0;
+        while (agent < population_number())
+        {
+            population_location(agent, &before[agent]);
+            agent++;
+        }
+        population_cycle();
+        agent = 0;
+        while (agent < population_number())
+        {
+            n_vect2 after, delta;
+            n_int   each = 0;
+            population_location(agent, &after);
+            population_delta(agent, &delta);
+            if (((before[agent].x + delta.x) != after.x) || ((before[agent].y + delta.y) != after.y))
+            {
+                printf("population agent %ld moved from (%ld, %ld) to (%ld, %ld) by (%ld, %ld)\n", agent,
+                       before[agent].x, before[agent].y, after.x, after.y, delta.x, delta.y);
+                memory_free((void **)&before);
+                return -1;
+            }
+            while (each < (n_int)matrix_draw_block()->count)
+            {
+                matrix_plane * plane = &planes[each];
+                /* a plane to one side of both ends of the step can't cross it */
+                if (((plane->start.x < before[agent].x) && (plane->end.x < before[agent].x) &&
+                     (plane->start.x < after.x) && (plane->end.x < after.x)) ||
+                    ((plane->start.x > before[agent].x) && (plane->end.x > before[agent].x) &&
+                     (plane->start.x > after.x) && (plane->end.x > after.x)))
+                {
+                    each++;
+                    continue;
+                }
+                if (test_properly_crosses(&before[agent], &after, &plane->start, &plane->end))
+                {
+                    printf("population agent %ld moved from (%ld, %ld) to (%ld, %ld) across %ld\n", agent,
+                           before[agent].x, before[agent].y, after.x, after.y, each);
+                    memory_free((void **)&before);
+                    return -1;
+                }
+                each++;
+            }
+            moved += ((delta.x != 0) || (delta.y != 0));
+            agent++;
+        }
+        cycle++;
+    }
+    memory_free((void **)&before);
+    printf("population %ld agent steps cross no wall\n", moved);
+    return 0;
+}
+
+/* the same population walked with one thread and with eight ends in the same places */
+n_int check_population_threads(n_byte2 * seed, n_vect2 * center, n_int radius)
+{
+    n_vect2 * ends = (n_vect2 *)memory_new(sizeof(n_vect2) * TEST_POPULATION_MANY);
+    n_int     threads[2] = {1, 8};
+    n_int     pass = 0;
+    n_int     result = 0;
+    
+    if (ends == 0L)
+    {
+        printf("population threads not allocated\n");
+        return -1;
+    }
+    while ((pass < 2) && (result == 0))
+    {
+        n_int cycle = 0;
+        n_int agent = 0;
+        execute_threads(threads[pass]);
+        if (population_init(seed, TEST_POPULATION_MANY, center, radius) != 0)
+        {
+            result = -1;
+            break;
+        }
+        while (cycle < 50)
+        {
+            population_cycle();
+            cycle++;
+        }
+        while ((agent < TEST_POPULATION_MANY) && (result == 0))
+        {
+            n_vect2 location;
+            population_location(agent, &location);
+            if (pass == 0)
+            {
+                vect2_copy(&ends[agent], &location);
+            }
+            else if ((location.x != ends[agent].x) || (location.y != ends[agent].y))
+            {
+                printf("population agent %ld at (%ld, %ld) with %ld threads and (%ld, %ld) with one\n", agent,
+                       location.x, location.y, threads[pass], ends[agent].x, ends[agent].y);
+                result = -1;
+            }
+            agent++;
+        }
+        pass++;
+    }
+    execute_threads(0);
+    memory_free((void **)&ends);
+    if (result == 0)
+    {
+        printf("population of %d walks the same with 1 and 8 threads\n", TEST_POPULATION_MANY);
+    }
+    return result;
+}
+
+n_int check_population(void)
+{
+    n_byte2 local[2] = {0x2f4d, 0x7b13};
+    n_byte2 seed[2] = {0x4c91, 0x1d6e};
+    n_vect2 center;
+    n_int   radius = (TWO_BLOCK_EDGE * NEIGHBORHOOD_UNIT_SPACE) / 2;
+    
+    vect2_copy(&center, agent_location());
+    
+    if (check_population_walls() != 0)
+    {
+        return -1;
+    }
+    if (check_population_nearby(local) != 0)
+    {
+        return -1;
+    }
+    if (check_population_threads(seed, &center, radius) != 0)
+    {
+        return -1;
+    }
+    /* back to the population the cycles walk */
+    if (population_init(seed, MAX_NUMBER_APES, &center, radius) != 0)
+    {
+        return -1;
+    }
+    printf("Population passed fine!\n");
+    return 0;
+}
+
+/* the streaming neighborhood is walked away past its capacity and back, every resident cell is
+   checked against the cell generated directly from its grid location */
+
+#define TEST_STREAM_RADIUS  (2)
+#define TEST_STREAM_WALK    (40) /* cells walked along x, far more two blocks than the capacity */
+#define TEST_STREAM_EDGE    ((TEST_STREAM_RADIUS * 2) + 1)
+#define TEST_STREAM_SPAN    (TEST_STREAM_WALK + TEST_STREAM_EDGE)
+
+typedef struct
+{
+    simulated_twoblock twoblock;
+    simulated_park     park;
+    n_byte             is_park;
+} test_stream_cell;
+
+/* as neighborhood_cell_seed and neighborhood_cell_execute in neighborhood.c */
+void test_stream_generate(n_byte2 * city_seed, n_int px, n_int py, test_stream_cell * cell)
+{
+    n_byte2 seed[2];
+    n_vect2 location;
+    
+    neighborhood_seed(city_seed, px, py, seed);
+    
+    location.x = NEIGHBORHOOD_CELL_OFFSET + (px * NEIGHBORHOOD_UNIT_SPACE);
+    location.y = NEIGHBORHOOD_CELL_OFFSET + (py * NEIGHBORHOOD_UNIT_SPACE);
+    
+    memory_erase((n_byte *)cell, sizeof(test_stream_cell));
+    cell->is_park = ((math_random(seed) & 255) > PARK_PROBABILITY);
+    if (cell->is_park)
+    {
+        park_init(seed, &location, &cell->park);
+    }
+    else
+    {
+        twoblock_init(seed, &location, &cell->twoblock);
+    }
+}
+
+test_stream_cell * test_stream_at(test_stream_cell * cells, n_int px, n_int py)
+{
+    return &cells[((py + TEST_STREAM_RADIUS) * TEST_STREAM_SPAN) + (px + TEST_STREAM_RADIUS)];
+}
+
+/* the number of resident cells matching the cell, -1 if it isn't generated from a cell of the walk */
+n_int test_stream_resident(test_stream_cell * cell)
+{
+    n_int count = 0, found = 0, loop = 0;
+    if (cell->is_park)
+    {
+        simulated_park * park = neighborhoood_park(&count);
+        while (loop < count)
+        {
+            found += (memcmp(&park[loop], &cell->park, sizeof(simulated_park)) == 0);
+            loop++;
+        }
+    }
+    else
+    {
+        simulated_twoblock * twoblock = neighborhoood_twoblock(&count);
+        while (loop < count)
+        {
+            found += (memcmp(&twoblock[loop], &cell->twoblock, sizeof(simulated_twoblock)) == 0);
+            loop++;
+        }
+    }
+    return found;
+}
+
+n_int test_stream_walked(test_stream_cell * cells, n_byte is_park, void * resident)
+{
+    n_int loop = 0;
+    while (loop < (TEST_STREAM_SPAN * TEST_STREAM_EDGE))
+    {
+        test_stream_cell * cell = &cells[loop++];
+        if (cell->is_park != is_park)
+        {
+            continue;
+        }
+        if (is_park)
+        {
+            if (memcmp(resident, &cell->park, sizeof(simulated_park)) == 0)
+            {
+                return 1;
+            }
+        }
+        else if (memcmp(resident, &cell->twoblock, sizeof(simulated_twoblock)) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+n_int check_stream_cells(test_stream_cell * cells, n_int cx)
+{
+    n_int capacity = TEST_STREAM_EDGE * TEST_STREAM_EDGE * 2;
+    n_int twoblock_count = 0, park_count = 0;
+    simulated_twoblock * twoblock = neighborhoood_twoblock(&twoblock_count);
+    simulated_park * park = neighborhoood_park(&park_count);
+    n_int px, py, loop;
+    
+    if ((twoblock_count > capacity) || (park_count > capacity))
+    {
+        printf("stream at %ld holds %ld two blocks and %ld parks past %ld\n", cx, twoblock_count, park_count, capacity);
+        return -1;
+    }
+    for (py = 0 - TEST_STREAM_RADIUS; py <= TEST_STREAM_RADIUS; py++)
+    {
+        for (px = cx - TEST_STREAM_RADIUS; px <= (cx + TEST_STREAM_RADIUS); px++)
+        {
+            n_int found = test_stream_resident(test_stream_at(cells, px, py));
+            if (found != 1)
+            {
+                printf("stream at %ld holds cell (%ld, %ld) %ld times\n", cx, px, py, found);
+                return -1;
+            }
+        }
+    }
+    for (loop = 0; loop < twoblock_count; loop++)
+    {
+        if (test_stream_walked(cells, 0, &twoblock[loop]) == 0)
+        {
+            printf("stream at %ld two block %ld is no cell of the walk\n", cx, loop);
+            return -1;
+        }
+    }
+    for (loop = 0; loop < park_count; loop++)
+    {
+        if (test_stream_walked(cells, 1, &park[loop]) == 0)
+        {
+            printf("stream at %ld park %ld is no cell of the walk\n", cx, loop);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* steps to the cell, the resident cells change only when a cell around it wasn't resident */
+n_int check_stream_step(test_stream_cell * cells, n_int cx, n_int * changed)
+{
+    n_vect2 location;
+    n_int   missing = 0;
+    n_int   result;
+    n_int   px, py;
+    
+    for (py = 0 - TEST_STREAM_RADIUS; py <= TEST_STREAM_RADIUS; py++)
+    {
+        for (px = cx - TEST_STREAM_RADIUS; px <= (cx + TEST_STREAM_RADIUS); px++)
+        {
+            missing += (test_stream_resident(test_stream_at(cells, px, py)) == 0);
+        }
+    }
+    
+    location.x = NEIGHBORHOOD_CELL_OFFSET + (cx * NEIGHBORHOOD_UNIT_SPACE) + (NEIGHBORHOOD_UNIT_SPACE / 2);
+    location.y = NEIGHBORHOOD_CELL_OFFSET + (NEIGHBORHOOD_UNIT_SPACE / 2);
+    
+    result = neighborhood_stream_cycle(&location);
+    if (result != (missing > 0))
+    {
+        printf("stream cycle at %ld gave %ld with %ld cells missing\n", cx, result, missing);
+        return -1;
+    }
+    *changed = result;
+    /* moving within the cell changes nothing */
+    location.x += NEIGHBORHOOD_UNIT_SPACE / 4;
+    location.y -= NEIGHBORHOOD_UNIT_SPACE / 4;
+    result = neighborhood_stream_cycle(&location);
+    if (result != 0)
+    {
+        printf("stream cycle within cell %ld gave %ld\n", cx, result);
+        return -1;
+    }
+    return check_stream_cells(cells, cx);
+}
+
+n_int check_stream_walk(n_byte2 * seed, test_stream_cell * cells)
+{
+    n_int evicted = 0, regenerated = 0;
+    n_int px, py, cx;
+    
+    if (neighborhood_stream_init(seed, TEST_STREAM_RADIUS) != 0)
+    {
+        return -1;
+    }
+    for (cx = 0; cx <= TEST_STREAM_WALK; cx++)
+    {
+        n_int changed;
+        if (check_stream_step(cells, cx, &changed) != 0)
+        {
+            return -1;
+        }
+        if (changed == 0)
+        {
+            printf("stream cycle at %ld found no new cells\n", cx);
+            return -1;
+        }
+    }
+    /* far away, some of the first cells have been evicted */
+    for (py = 0 - TEST_STREAM_RADIUS; py <= TEST_STREAM_RADIUS; py++)
+    {
+        for (px = 0 - TEST_STREAM_RADIUS; px <= TEST_STREAM_RADIUS; px++)
+        {
+            evicted += (test_stream_resident(test_stream_at(cells, px, py)) == 0);
+        }
+    }
+    if (evicted == 0)
+    {
+        printf("stream walk never evicted the first cells\n");
+        return -1;
+    }
+    /* and back, the evicted cells are generated again */
+    for (cx = TEST_STREAM_WALK - 1; cx >= 0; cx--)
+    {
+        n_int changed;
+        if (check_stream_step(cells, cx, &changed) != 0)
+        {
+            return -1;
+        }
+        regenerated += changed;
+    }
+    if (regenerated == 0)
+    {
+        printf("stream walk back found no new cells\n");
+        return -1;
+    }
+    return 0;
+}
+
+n_int check_stream(void)
+{
+    n_byte2 seed[2] = {0x6a3b, 0x51c7};
+    test_stream_cell * cells = memory_new(sizeof(test_stream_cell) * TEST_STREAM_SPAN * TEST_STREAM_EDGE);
+    n_int   result;
+    n_int   px, py;
+    
+    if (cells == 0L)
+    {
+        return -1;
+    }
+    for (py = 0 - TEST_STREAM_RADIUS; py <= TEST_STREAM_RADIUS; py++)
+    {
+        for (px = 0 - TEST_STREAM_RADIUS; px < (TEST_STREAM_SPAN - TEST_STREAM_RADIUS); px++)
+        {
+            test_stream_generate(seed, px, py, test_stream_at(cells, px, py));
+        }
+    }
+    result = check_stream_walk(seed, cells);
+    neighborhood_close();
+    memory_free((void **)&cells);
+    if (result == 0)
+    {
+        printf("Stream passed fine!\n");
+    }
+    return result;
 }
 
 void test_cycle(void)
 {
     agent_cycle();
-    city_cycle();
+    population_cycle();
 }
 
 int main(int argc, const char * argv[])
@@ -84,6 +1837,27 @@ int main(int argc, const char * argv[])
     printf(" --- test mushroom --- start -----------------------------------------------\n");
     
     test_init(0x12738291);
+    
+    if (check_matrix() != 0)
+    {
+        return 1;
+    }
+    if (check_visibility() != 0)
+    {
+        return 1;
+    }
+    if (check_road() != 0)
+    {
+        return 1;
+    }
+    if (check_house() != 0)
+    {
+        return 1;
+    }
+    if (check_population() != 0)
+    {
+        return 1;
+    }
 
     while (loop < 2000)
     {
@@ -91,9 +1865,17 @@ int main(int argc, const char * argv[])
 
         loop++;
     }
+    
+    population_close();
+    
+    if (check_stream() != 0)
+    {
+        return 1;
+    }
+    neighborhood_close();
         
     printf(" --- test mushroom ---  end  -----------------------------------------------\n");
     
-    return 1;
+    return 0;
 }
 
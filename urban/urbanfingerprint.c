@@ -0,0 +1,285 @@
+/****************************************************************
+
+ urbanfingerprint.c
+
+ =============================================================
+
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+
+ ****************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../apesdk/toolkit/toolkit.h"
+#include "game/mushroom.h"
+
+/*
+ Generates the same city from a fixed seed a number of times, on 1, 2 and 8 threads in turn. Prints a hash of every two block,
+ park and fence so changes to generation can be shown not to change the city, and how many
+ buildings and cells are generated a second.
+
+ test_fingerprint [runs] [edge_x edge_y]
+ */
+
+#define FINGERPRINT_SEED    (0x12738291)
+#define FINGERPRINT_RUNS    (5)
+
+/* runs take these thread counts in turn so a city that depends on the thread count fails */
+static n_int fingerprint_threads[3] = {1, 2, 8};
+
+extern n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number);
+
+n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number)
+{
+    printf("ERROR: %s, %s line: %ld\n", error_text, location, line_number);
+    return -1;
+}
+
+static double fingerprint_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+/* FNV-1a over the eight bytes of each value, low byte first, so the hash doesn't depend on the
+   structure layout or the size of n_int */
+static void fingerprint_value(unsigned long long * hash, n_int value)
+{
+    unsigned long long bits = (unsigned long long)(long long)value;
+    n_int loop = 0;
+    while (loop < 8)
+    {
+        *hash ^= (bits >> (loop * 8)) & 255;
+        *hash *= 1099511628211ULL;
+        loop++;
+    }
+}
+
+static void fingerprint_points(unsigned long long * hash, n_vect2 * points, n_int number)
+{
+    n_int loop = 0;
+    while (loop < number)
+    {
+        fingerprint_value(hash, points[loop].x);
+        fingerprint_value(hash, points[loop].y);
+        loop++;
+    }
+}
+
+/* trees that aren't there only have the center and radius cleared */
+static void fingerprint_tree(unsigned long long * hash, simulated_tree * tree)
+{
+    n_int loop = 0;
+    fingerprint_value(hash, tree_populated(tree));
+    if (tree_populated(tree) == 0)
+    {
+        return;
+    }
+    while (loop < POINTS_PER_TREE)
+    {
+        fingerprint_value(hash, tree->points[loop++]);
+    }
+    fingerprint_value(hash, tree->radius);
+    fingerprint_points(hash, &tree->center, 1);
+}
+
+static void fingerprint_path_group(unsigned long long * hash, simulated_path_group * group)
+{
+    n_int loop = 0;
+    fingerprint_value(hash, group->number);
+    while (loop < group->number)
+    {
+        fingerprint_points(hash, group->paths[loop++].points, POINTS_PER_PATH);
+    }
+}
+
+/* only the generated values, the room graph is found from the rooms and the house genetics and
+   rotation aren't set by generation */
+static void fingerprint_building(unsigned long long * hash, simulated_building * building)
+{
+    n_int loop = 0;
+    fingerprint_value(hash, building->roomcount);
+    while (loop < building->roomcount)
+    {
+        fingerprint_points(hash, building->room[loop++].points, POINTS_PER_ROOM);
+    }
+    loop = 0;
+    while (loop < 4)
+    {
+        fingerprint_tree(hash, &building->trees[loop++]);
+    }
+}
+
+static unsigned long long fingerprint_city(n_int * buildings)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    n_int twoblock_count, park_count, fence_count;
+    simulated_twoblock * twoblocks = neighborhoood_twoblock(&twoblock_count);
+    simulated_park * parks = neighborhoood_park(&park_count);
+    simulated_fence * fences = neighborhoood_fence(&fence_count);
+    n_int loop = 0;
+
+    *buildings = 0;
+    fingerprint_value(&hash, twoblock_count);
+    while (loop < twoblock_count)
+    {
+        simulated_twoblock * twoblock = &twoblocks[loop++];
+        n_int count = 0;
+        fingerprint_value(&hash, twoblock->rotation);
+        while (count < 16)
+        {
+            *buildings += (twoblock->house[count].roomcount > 0);
+            fingerprint_building(&hash, &twoblock->house[count++]);
+        }
+        count = 0;
+        while (count < 8)
+        {
+            fingerprint_points(&hash, twoblock->fence[count++].points, POINTS_PER_FENCE);
+        }
+        /* the footpath group isn't filled by generation, the footpaths are part of the road */
+        fingerprint_path_group(&hash, &twoblock->road);
+    }
+
+    loop = 0;
+    fingerprint_value(&hash, park_count);
+    while (loop < park_count)
+    {
+        simulated_park * park = &parks[loop++];
+        n_int count = 0;
+        fingerprint_path_group(&hash, &park->road);
+        while (count < (16 * 4))
+        {
+            fingerprint_tree(&hash, &park->trees[count / 4][count % 4]);
+            count++;
+        }
+    }
+
+    loop = 0;
+    fingerprint_value(&hash, fence_count);
+    while (loop < fence_count)
+    {
+        fingerprint_points(&hash, fences[loop++].points, POINTS_PER_FENCE);
+    }
+    return hash;
+}
+
+int main(int argc, const char * argv[])
+{
+    n_int  runs = FINGERPRINT_RUNS;
+    n_int  edge_x = TWO_BLOCK_EDGE;
+    n_int  edge_y = TWO_BLOCK_EDGE;
+    n_int  run = 0;
+    n_int  buildings = 0;
+    n_int  differs = 0;
+    double best = 0, total = 0;
+    unsigned long long first_hash = 0;
+
+    if (argc == 2 || argc == 4)
+    {
+        runs = atol(argv[1]);
+    }
+    if (argc == 4)
+    {
+        edge_x = atol(argv[2]);
+        edge_y = atol(argv[3]);
+    }
+    if ((argc != 1 && argc != 2 && argc != 4) || (runs < 1))
+    {
+        printf("test_fingerprint [runs] [edge_x edge_y]\n");
+        return 1;
+    }
+
+    while (run < runs)
+    {
+        n_byte2 seed[4];
+        n_uint  random = FINGERPRINT_SEED;
+        n_int   threads = fingerprint_threads[run % 3];
+        unsigned long long hash;
+        double  start, elapsed;
+
+        seed[3] = (random >>  0) & 0xffff;
+        seed[2] = (random >> 16) & 0xffff;
+        seed[1] = ((random >> 16) >> 16) & 0xffff;
+        seed[0] = ((random >> 16) >> 32) & 0xffff;
+
+        seed[0] ^= seed[2];
+        seed[1] ^= seed[3];
+
+        math_random(seed);
+        math_random(seed);
+        math_random(seed);
+        math_random(seed);
+        math_random(seed);
+
+        execute_threads(threads);
+
+        start = fingerprint_seconds();
+        if (neighborhood_init(seed, edge_x, edge_y) != 0)
+        {
+            return 1;
+        }
+        elapsed = fingerprint_seconds() - start;
+
+        hash = fingerprint_city(&buildings);
+        if (run == 0)
+        {
+            first_hash = hash;
+        }
+        else if (hash != first_hash)
+        {
+            differs++;
+        }
+        printf("run %ld: %ld threads, %.3f s, fingerprint %016llx\n", run, threads, elapsed, hash);
+
+        if ((run == 0) || (elapsed < best))
+        {
+            best = elapsed;
+        }
+        total += elapsed;
+        run++;
+    }
+
+    printf("city %ld x %ld, %ld cells, %ld buildings\n", edge_x, edge_y, edge_x * edge_y, buildings);
+    printf("fingerprint %016llx\n", first_hash);
+    printf("best %.1f buildings/s %.1f cells/s\n", (double)buildings / best, (double)(edge_x * edge_y) / best);
+    printf("mean %.1f buildings/s %.1f cells/s\n", (double)(buildings * runs) / total, (double)(edge_x * edge_y * runs) / total);
+
+    neighborhood_close();
+    execute_threads(0);
+
+    if (differs)
+    {
+        printf("ERROR: %ld runs gave a different fingerprint\n", differs);
+        return 1;
+    }
+    return 0;
+}
@@ -42,7 +42,6 @@
 #include "../apesdk/toolkit/toolkit.h"
 #include "../apesdk/render/glrender.h"
 #include "game/mushroom.h"
-#include "game/city.h"
 
 extern n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number);
 
@@ -55,9 +54,15 @@ n_int draw_error(n_constant_string error_text, n_constant_string location, n_int
 int main(int argc, const char * argv[]) {
     n_byte2   seed[4];
     n_uint random;
+    n_int  edge_x = TWO_BLOCK_EDGE;
+    n_int  edge_y = TWO_BLOCK_EDGE;
     
-    
-    if ( argc != 2 )
+    if ( argc == 4 )
+    {
+        edge_x = atol( argv[2] );
+        edge_y = atol( argv[3] );
+    }
+    else if ( argc != 2 )
     {
         return 0;
     }
@@ -83,7 +88,10 @@ int main(int argc, const char * argv[]) {
     math_random(seed);
     math_random(seed);
     
-    neighborhood_init(seed);
+    if ( neighborhood_init(seed, edge_x, edge_y) != 0 )
+    {
+        return 1;
+    }
 
     neighborhood_object(( n_string )argv[1]);
     
@@ -0,0 +1,281 @@
+/****************************************************************
+
+ urbanroute.c
+
+ =============================================================
+
+ Copyright 1996-2025 Tom Barbalet. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person
+ obtaining a copy of this software and associated documentation
+ files (the "Software"), to deal in the Software without
+ restriction, including without limitation the rights to use,
+ copy, modify, merge, publish, distribute, sublicense, and/or
+ sell copies of the Software, and to permit persons to whom the
+ Software is furnished to do so, subject to the following
+ conditions:
+
+ The above copyright notice and this permission notice shall be
+ included in all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+ This software is a continuing work of Tom Barbalet, begun on
+ 13 June 1996. No apes or cats were harmed in the writing of
+ this software.
+
+ ****************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../apesdk/toolkit/toolkit.h"
+#include "game/mushroom.h"
+
+/*
+ Routes random pairs of road nodes across a city with road_route, the A* over every node, and with
+ road_plan, the search over the portals between the blocks. Checks every planned route walks the
+ graph from the start to the end at the cost given, no cheaper than road_route, and prints how long
+ each takes and how much longer the planned routes are.
+
+ test_route [routes] [edge_x edge_y]
+ */
+
+#define ROUTE_SEED      (0x12738291)
+#define ROUTE_PAIRS     (2000)
+#define ROUTE_EDGE      (128)
+
+extern n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number);
+
+n_int draw_error(n_constant_string error_text, n_constant_string location, n_int line_number)
+{
+    printf("ERROR: %s, %s line: %ld\n", error_text, location, line_number);
+    return -1;
+}
+
+static double route_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + ((double)now.tv_nsec / 1000000000.0);
+}
+
+/* the cost of the edge between the nodes, -1 if they aren't joined */
+static n_int route_edge(n_int from, n_int to)
+{
+    n_int edges = road_graph_edges(from);
+    n_int loop = 0;
+    while (loop < edges)
+    {
+        n_int cost;
+        if (road_graph_edge(from, loop, &cost) == to)
+        {
+            return cost;
+        }
+        loop++;
+    }
+    return -1;
+}
+
+static n_int route_check(int_list * route, n_int start, n_int end, n_int cost)
+{
+    n_int * nodes = (n_int *)route->data;
+    n_int   sum = 0;
+    n_uint  loop = 1;
+    if ((route->count == 0) || (nodes[0] != start) || (nodes[route->count - 1] != end))
+    {
+        printf("plan from %ld to %ld does not run from the start to the end\n", start, end);
+        return -1;
+    }
+    while (loop < route->count)
+    {
+        n_int edge_cost = route_edge(nodes[loop - 1], nodes[loop]);
+        if (edge_cost == -1)
+        {
+            printf("plan from %ld to %ld jumps from %ld to %ld\n", start, end, nodes[loop - 1], nodes[loop]);
+            return -1;
+        }
+        sum += edge_cost;
+        loop++;
+    }
+    if (sum != cost)
+    {
+        printf("plan from %ld to %ld at %ld has edges adding to %ld\n", start, end, cost, sum);
+        return -1;
+    }
+    return 0;
+}
+
+/* routes every pair with road_plan, checking each against the cost road_route found */
+static n_int route_plan(road_search * search, int_list * route, n_int * pairs, n_int * costs, n_int count,
+                        double * seconds, double * extra, double * worst)
+{
+    double start_time = route_seconds();
+    n_int  loop = 0;
+    *extra = 0;
+    *worst = 0;
+    while (loop < count)
+    {
+        n_int start = pairs[loop * 2];
+        n_int end = pairs[(loop * 2) + 1];
+        n_int cost;
+        route->count = 0;
+        cost = road_plan(search, start, end, route);
+        if ((cost == -1) != (costs[loop] == -1))
+        {
+            printf("plan from %ld to %ld found %ld where road_route found %ld\n", start, end, cost, costs[loop]);
+            return -1;
+        }
+        if (cost != -1)
+        {
+            if ((cost < costs[loop]) || (route_check(route, start, end, cost) != 0))
+            {
+                printf("plan from %ld to %ld at %ld against %ld\n", start, end, cost, costs[loop]);
+                return -1;
+            }
+            if (costs[loop] > 0)
+            {
+                double longer = (double)(cost - costs[loop]) / (double)costs[loop];
+                *extra += longer;
+                if (longer > *worst)
+                {
+                    *worst = longer;
+                }
+            }
+        }
+        loop++;
+    }
+    *seconds = route_seconds() - start_time;
+    *extra /= (double)count;
+    return 0;
+}
+
+int main(int argc, const char * argv[])
+{
+    n_int    count = ROUTE_PAIRS;
+    n_int    edge_x = ROUTE_EDGE;
+    n_int    edge_y = ROUTE_EDGE;
+    n_byte2  seed[4];
+    n_byte2  local[2] = {0x3b71, 0x8c25};
+    n_uint   random = ROUTE_SEED;
+    n_int  * pairs;
+    n_int  * costs;
+    n_int    nodes, found = 0, loop = 0;
+    road_search * search;
+    int_list * route;
+    double   start_time, route_time, cold_time, prepare_time, warm_time, built_time;
+    double   extra, worst;
+    n_int    result = 0;
+
+    if (argc == 2 || argc == 4)
+    {
+        count = atol(argv[1]);
+    }
+    if (argc == 4)
+    {
+        edge_x = atol(argv[2]);
+        edge_y = atol(argv[3]);
+    }
+    if ((argc != 1 && argc != 2 && argc != 4) || (count < 1))
+    {
+        printf("test_route [routes] [edge_x edge_y]\n");
+        return 1;
+    }
+
+    seed[3] = (random >>  0) & 0xffff;
+    seed[2] = (random >> 16) & 0xffff;
+    seed[1] = ((random >> 16) >> 16) & 0xffff;
+    seed[0] = ((random >> 16) >> 32) & 0xffff;
+
+    seed[0] ^= seed[2];
+    seed[1] ^= seed[3];
+
+    math_random(seed);
+    math_random(seed);
+    math_random(seed);
+    math_random(seed);
+    math_random(seed);
+
+    start_time = route_seconds();
+    if (neighborhood_init(seed, edge_x, edge_y) != 0)
+    {
+        return 1;
+    }
+    printf("city %ld x %ld generated in %.1f s\n", edge_x, edge_y, route_seconds() - start_time);
+
+    nodes = road_graph_nodes();
+    pairs = (n_int *)memory_new(sizeof(n_int) * 2 * (n_uint)count);
+    costs = (n_int *)memory_new(sizeof(n_int) * (n_uint)count);
+    search = road_search_new();
+    route = int_list_new(1024);
+    if ((nodes == 0) || (pairs == 0L) || (costs == 0L) || (search == 0L) || (route == 0L))
+    {
+        printf("routes not set up\n");
+        return 1;
+    }
+    while (loop < (count * 2))
+    {
+        pairs[loop++] = (n_int)(((n_uint)math_random(local) * 65536 + math_random(local)) % (n_uint)nodes);
+    }
+
+    start_time = route_seconds();
+    loop = 0;
+    while (loop < count)
+    {
+        route->count = 0;
+        costs[loop] = road_route(search, pairs[loop * 2], pairs[(loop * 2) + 1], route);
+        found += (costs[loop] != -1);
+        loop++;
+    }
+    route_time = route_seconds() - start_time;
+
+    /* the portal costs are found as the first plans reach them */
+    result = route_plan(search, route, pairs, costs, count, &cold_time, &extra, &worst);
+
+    if (result == 0)
+    {
+        road_plan_close();
+        start_time = route_seconds();
+        result = road_plan_prepare();
+        prepare_time = route_seconds() - start_time;
+    }
+    if (result == 0)
+    {
+        result = route_plan(search, route, pairs, costs, count, &warm_time, &extra, &worst);
+    }
+    /* the kept costs outlast the graph built again */
+    if (result == 0)
+    {
+        result = road_graph_build();
+    }
+    if (result == 0)
+    {
+        result = route_plan(search, route, pairs, costs, count, &built_time, &extra, &worst);
+    }
+
+    if (result == 0)
+    {
+        printf("%ld nodes, %ld of %ld routes found\n", nodes, found, count);
+        printf("road_route %.3f ms a route\n", (route_time * 1000.0) / (double)count);
+        printf("road_plan  %.3f ms a route finding the portal costs as it goes\n", (cold_time * 1000.0) / (double)count);
+        printf("road_plan  %.3f ms a route with the portal costs prepared in %.1f s\n", (warm_time * 1000.0) / (double)count, prepare_time);
+        printf("road_plan  %.3f ms a route after the graph is built again\n", (built_time * 1000.0) / (double)count);
+        printf("planned routes %.1f%% longer on average, %.1f%% at most\n", extra * 100.0, worst * 100.0);
+    }
+
+    int_list_free(&route);
+    road_search_free(&search);
+    memory_free((void **)&costs);
+    memory_free((void **)&pairs);
+    neighborhood_close();
+
+    return (result == 0) ? 0 : 1;
+}